@@ -0,0 +1,641 @@
+// bench/load_bench.c - Load generator: many framed clients replaying a command mix against ./server
+//starts ./server (or attaches to a running one), spreads --clients connections over --threads
+//generator threads, each multiplexing its connections on epoll, and replays a weighted mix of
+//commands for --duration seconds:
+//  closed loop (default): every client keeps one command in flight, sending the next on END
+//  open loop (--rate R): commands arrive as a Poisson process of R/s over all clients, whether
+//                        or not earlier ones finished; latency counts from the scheduled arrival,
+//                        so a stalled server is not hidden by the generator waiting for it
+//reports throughput and p50/p99/p99.9 latency per mix entry, and how evenly the clients were
+//served (Jain's fairness index over per-client completions and mean latencies)
+//usage: bench/load_bench [--clients N] [--threads N] [--duration S] [--drain S] [--rate R] [--mix W:CMD,...]
+//                        [--seed N] [--per-client] [--attach] [--server PATH] [-- SERVER ARGS...]
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "../include/client.h"
+#include "../include/protocol.h"
+
+#define LOAD_DEFAULT_CLIENTS 256
+#define LOAD_DEFAULT_THREADS 4
+#define LOAD_DEFAULT_DURATION_S 10
+#define LOAD_DEFAULT_MIX "99:echo load,1:./demo 1"
+#define LOAD_MAX_CLIENTS 65536
+#define LOAD_MAX_THREADS 64
+#define LOAD_MAX_MIX 16                 //entries in --mix
+#define LOAD_COMMAND_MAX 256            //bytes of one mix command
+#define LOAD_MAX_INFLIGHT 64            //open loop: commands in flight per client before arrivals are skipped
+#define LOAD_DEFAULT_DRAIN_S 10         //how long commands in flight at the end may take to finish
+#define LOAD_CONNECT_RETRIES 100        //connect attempts per client (10ms apart)
+#define LOAD_EVENTS 256                 //epoll events handled per wake-up
+#define LOAD_RECV_BUFFER 65536
+
+typedef struct {
+    int weight;
+    char command[LOAD_COMMAND_MAX];
+} MixEntry;
+
+//a command waiting for its END frame
+typedef struct {
+    uint32_t request_id;
+    int mix;                            //index into the mix
+    int failed;                         //an ERROR frame arrived for it
+    long long sent_ns;                  //when it was sent (open loop: when it was due)
+} Pending;
+
+typedef struct {
+    int sock;                           //-1 once the server closed the connection
+    FrameDecoder decoder;
+    uint32_t next_id;
+    Pending pending[LOAD_MAX_INFLIGHT];
+    int inflight;
+    long long completed;                //commands answered with END and no ERROR
+    long long errors;                   //commands answered with an ERROR frame
+    long long latency_sum_ns;
+    long long latency_max_ns;
+} LoadClient;
+
+//latencies of one mix entry, in nanoseconds
+typedef struct {
+    long long* values;
+    size_t count;
+    size_t capacity;
+} Samples;
+
+typedef struct {
+    int index;
+    LoadClient* clients;
+    int client_count;
+    int next_client;                    //open loop: round robin over the thread's clients
+    unsigned long long rng;
+    Samples samples[LOAD_MAX_MIX];
+    long long sent[LOAD_MAX_MIX];
+    long long errors[LOAD_MAX_MIX];
+    long long in_window[LOAD_MAX_MIX];  //answered before sending stopped: the throughput
+    long long skipped;                  //open loop: arrivals dropped because their client was saturated
+    long long lost;                     //commands never answered (connection closed or drain timed out)
+    long long elapsed_ns;               //start of sending to the last answer (sending and drain)
+    int connect_failed;
+    pthread_barrier_t* start;
+} LoadThread;
+
+//run settings shared by every generator thread
+static struct {
+    MixEntry mix[LOAD_MAX_MIX];
+    int mix_count;
+    int total_weight;
+    double rate;                        //open loop arrivals per second over all clients, 0 = closed loop
+    int threads;
+    long long duration_ns;
+    long long drain_ns;
+} load;
+
+
+static long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//xorshift64*: cheap per-thread randomness, reproducible with --seed
+static unsigned long long next_random(unsigned long long* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+//uniform in (0, 1]
+static double random_unit(unsigned long long* state) {
+    return ((next_random(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static int pick_mix(unsigned long long* state) {
+    int ticket = (int)(next_random(state) % (unsigned long long)load.total_weight);
+    for (int i = 0; i < load.mix_count; i++) {
+        ticket -= load.mix[i].weight;
+        if (ticket < 0) return i;
+    }
+    return load.mix_count - 1;
+}
+
+//parse "W:CMD,W:CMD,..." into load.mix; -1 on a malformed spec
+static int parse_mix(const char* spec) {
+    load.mix_count = 0;
+    load.total_weight = 0;
+    const char* entry = spec;
+    while (*entry) {
+        const char* end = strchr(entry, ',');
+        size_t length = end ? (size_t)(end - entry) : strlen(entry);
+        char* colon = NULL;
+        long weight = strtol(entry, &colon, 10);
+        if (load.mix_count == LOAD_MAX_MIX || colon == entry || *colon != ':' || weight < 1 || weight > 1000000) {
+            return -1;
+        }
+        size_t command_length = length - (size_t)(colon + 1 - entry);
+        if (command_length == 0 || command_length >= LOAD_COMMAND_MAX) return -1;
+
+        MixEntry* mix = &load.mix[load.mix_count++];
+        mix->weight = (int)weight;
+        memcpy(mix->command, colon + 1, command_length);
+        mix->command[command_length] = '\0';
+        load.total_weight += mix->weight;
+        entry += length + (end ? 1 : 0);
+    }
+    return load.mix_count > 0 ? 0 : -1;
+}
+
+static int samples_add(Samples* samples, long long value) {
+    if (samples->count == samples->capacity) {
+        size_t capacity = samples->capacity ? samples->capacity * 2 : 1024;
+        long long* grown = (long long*)realloc(samples->values, capacity * sizeof(long long));
+        if (grown == NULL) return -1;
+        samples->values = grown;
+        samples->capacity = capacity;
+    }
+    samples->values[samples->count++] = value;
+    return 0;
+}
+
+static int compare_ll(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+//nearest-rank quantile of sorted values
+static long long quantile(const long long* sorted, size_t count, double q) {
+    if (count == 0) return 0;
+    size_t rank = (size_t)ceil(q * (double)count);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+//1 when every value is equal, 1/n when one client got everything
+static double jain_index(const double* values, int count) {
+    double sum = 0, squares = 0;
+    for (int i = 0; i < count; i++) {
+        sum += values[i];
+        squares += values[i] * values[i];
+    }
+    return squares > 0 ? (sum * sum) / (count * squares) : 1.0;
+}
+
+static int connect_server() {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SERVER_PORT);
+    inet_pton(AF_INET, SERVER_IP, &addr.sin_addr);
+
+    int sock = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return -1;
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+//send one command from the mix on a client; 0 on success
+static int send_command(LoadThread* thread, LoadClient* client, long long sent_ns) {
+    int mix = pick_mix(&thread->rng);
+    const char* command = load.mix[mix].command;
+    Pending* pending = &client->pending[client->inflight];
+    pending->request_id = client->next_id++;
+    pending->mix = mix;
+    pending->failed = 0;
+    pending->sent_ns = sent_ns;
+    if (frame_write(client->sock, FRAME_COMMAND, pending->request_id, command, (uint32_t)strlen(command)) != 0) {
+        return -1;
+    }
+    client->inflight++;
+    thread->sent[mix]++;
+    return 0;
+}
+
+static void close_client(LoadThread* thread, LoadClient* client) {
+    thread->lost += client->inflight;
+    client->inflight = 0;
+    close(client->sock);
+    client->sock = -1;
+}
+
+//handle everything the server sent to one client
+static void read_client(LoadThread* thread, LoadClient* client, long long stop_ns) {
+    char buffer[LOAD_RECV_BUFFER];
+    ssize_t bytes = recv(client->sock, buffer, sizeof(buffer), 0);
+    if (bytes <= 0 || frame_decoder_append(&client->decoder, buffer, (size_t)bytes) != 0) {
+        close_client(thread, client);
+        return;
+    }
+    long long now = now_ns();
+
+    FrameHeader header;
+    const char* payload;
+    int result;
+    while ((result = frame_decoder_next(&client->decoder, &header, &payload)) > 0) {
+        if (header.type != FRAME_END && header.type != FRAME_ERROR) continue;
+        int slot = -1;
+        for (int i = 0; i < client->inflight; i++) {
+            if (client->pending[i].request_id == header.request_id) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0) continue;
+        Pending* pending = &client->pending[slot];
+        if (header.type == FRAME_ERROR) {
+            pending->failed = 1;
+            continue;
+        }
+
+        //END: the command is done
+        if (pending->failed) {
+            client->errors++;
+            thread->errors[pending->mix]++;
+        } else {
+            long long latency = now - pending->sent_ns;
+            client->completed++;
+            client->latency_sum_ns += latency;
+            if (latency > client->latency_max_ns) client->latency_max_ns = latency;
+            samples_add(&thread->samples[pending->mix], latency);
+            if (now < stop_ns) thread->in_window[pending->mix]++;
+        }
+        client->pending[slot] = client->pending[--client->inflight];
+
+        //closed loop: the answer releases the next command
+        if (load.rate <= 0 && now < stop_ns && send_command(thread, client, now_ns()) != 0) {
+            close_client(thread, client);
+            return;
+        }
+    }
+    if (result < 0) close_client(thread, client);
+}
+
+static void* load_thread_main(void* arg) {
+    LoadThread* thread = (LoadThread*)arg;
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    //connect everyone before the clock starts
+    for (int i = 0; i < thread->client_count; i++) {
+        LoadClient* client = &thread->clients[i];
+        client->sock = -1;
+        for (int attempt = 0; attempt < LOAD_CONNECT_RETRIES && client->sock < 0; attempt++) {
+            client->sock = connect_server();
+            if (client->sock < 0) usleep(10000);
+        }
+        frame_decoder_init(&client->decoder, PROTOCOL_FRAMED);
+        struct epoll_event event = { .events = EPOLLIN, .data.ptr = client };
+        if (client->sock < 0 || protocol_send_hello(client->sock) != 0 ||
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client->sock, &event) != 0) {
+            if (client->sock >= 0) close(client->sock);
+            client->sock = -1;
+            thread->connect_failed++;
+        }
+    }
+    pthread_barrier_wait(thread->start);
+
+    long long begin = now_ns();
+    long long stop = begin + load.duration_ns;
+    long long deadline = stop + load.drain_ns;
+    long long last_answer = begin;
+
+    //open loop: this thread's share of the arrivals, exponentially spaced
+    double mean_gap_ns = load.rate > 0 ? 1e9 * load.threads / load.rate : 0;
+    long long next_arrival = begin + (long long)(-log(random_unit(&thread->rng)) * mean_gap_ns);
+
+    if (load.rate <= 0) {
+        for (int i = 0; i < thread->client_count; i++) {
+            LoadClient* client = &thread->clients[i];
+            if (client->sock >= 0 && send_command(thread, client, now_ns()) != 0) close_client(thread, client);
+        }
+    }
+
+    struct epoll_event events[LOAD_EVENTS];
+    for (;;) {
+        long long now = now_ns();
+
+        //send every arrival that is due, each to the next client in turn
+        while (load.rate > 0 && next_arrival <= now && next_arrival < stop) {
+            LoadClient* client = &thread->clients[thread->next_client];
+            thread->next_client = (thread->next_client + 1) % thread->client_count;
+            if (client->sock < 0 || client->inflight == LOAD_MAX_INFLIGHT) {
+                thread->skipped++;
+            } else if (send_command(thread, client, next_arrival) != 0) {
+                close_client(thread, client);
+            }
+            next_arrival += (long long)(-log(random_unit(&thread->rng)) * mean_gap_ns);
+        }
+
+        int inflight = 0;
+        for (int i = 0; i < thread->client_count; i++) inflight += thread->clients[i].inflight;
+        if ((now >= stop && inflight == 0) || now >= deadline) break;
+
+        //sleep until an answer, the next arrival or the end of the run
+        long long wake = now >= stop ? deadline : (load.rate > 0 && next_arrival < stop ? next_arrival : stop);
+        long long wait_ns = wake - now;
+        int timeout_ms = wait_ns > 100000000LL ? 100 : (int)((wait_ns + 999999) / 1000000);
+        int ready = epoll_wait(epoll_fd, events, LOAD_EVENTS, timeout_ms);
+        for (int i = 0; i < ready; i++) {
+            LoadClient* client = (LoadClient*)events[i].data.ptr;
+            if (client->sock < 0) continue;
+            read_client(thread, client, stop);
+            last_answer = now_ns();
+        }
+    }
+    thread->elapsed_ns = last_answer - begin;
+
+    for (int i = 0; i < thread->client_count; i++) {
+        LoadClient* client = &thread->clients[i];
+        thread->lost += client->inflight;
+        if (client->sock >= 0) close(client->sock);
+        frame_decoder_free(&client->decoder);
+    }
+    close(epoll_fd);
+    return NULL;
+}
+
+//merge the threads' samples of one mix entry (mix < 0: every entry) and print its row
+static void report_row(LoadThread* threads, int thread_count, int mix, const char* name) {
+    size_t count = 0;
+    long long sent = 0, errors = 0, in_window = 0;
+    for (int t = 0; t < thread_count; t++) {
+        for (int m = 0; m < load.mix_count; m++) {
+            if (mix >= 0 && m != mix) continue;
+            count += threads[t].samples[m].count;
+            sent += threads[t].sent[m];
+            errors += threads[t].errors[m];
+            in_window += threads[t].in_window[m];
+        }
+    }
+    long long* sorted = (long long*)malloc((count ? count : 1) * sizeof(long long));
+    if (sorted == NULL) return;
+    size_t used = 0;
+    for (int t = 0; t < thread_count; t++) {
+        for (int m = 0; m < load.mix_count; m++) {
+            if (mix >= 0 && m != mix) continue;
+            memcpy(sorted + used, threads[t].samples[m].values, threads[t].samples[m].count * sizeof(long long));
+            used += threads[t].samples[m].count;
+        }
+    }
+    qsort(sorted, count, sizeof(long long), compare_ll);
+
+    printf("  %-20.20s %9lld %9zu %7lld %10.1f %9.3f %9.3f %9.3f %9.3f\n", name, sent, count, errors,
+           in_window / (load.duration_ns / 1e9), quantile(sorted, count, 0.50) / 1e6,
+           quantile(sorted, count, 0.99) / 1e6, quantile(sorted, count, 0.999) / 1e6,
+           count ? sorted[count - 1] / 1e6 : 0.0);
+    free(sorted);
+}
+
+//min / median / max of values (sorted in place)
+static void spread(double* values, int count, double* low, double* median, double* high) {
+    *low = *median = *high = 0;
+    if (count == 0) return;
+    for (int i = 1; i < count; i++) {
+        double value = values[i];
+        int j = i - 1;
+        for (; j >= 0 && values[j] > value; j--) values[j + 1] = values[j];
+        values[j + 1] = value;
+    }
+    *low = values[0];
+    *median = values[count / 2];
+    *high = values[count - 1];
+}
+
+static void report(LoadThread* threads, int thread_count, LoadClient* clients, int client_count, int per_client) {
+    long long elapsed_ns = 0, skipped = 0, lost = 0;
+    int connect_failed = 0;
+    for (int t = 0; t < thread_count; t++) {
+        if (threads[t].elapsed_ns > elapsed_ns) elapsed_ns = threads[t].elapsed_ns;
+        skipped += threads[t].skipped;
+        lost += threads[t].lost;
+        connect_failed += threads[t].connect_failed;
+    }
+
+    printf("  %-20s %9s %9s %7s %10s %9s %9s %9s %9s\n", "command", "sent", "done", "errors", "cmds/sec",
+           "p50 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (int m = 0; m < load.mix_count; m++) {
+        report_row(threads, thread_count, m, load.mix[m].command);
+    }
+    report_row(threads, thread_count, -1, "all");
+    printf("  cmds/sec counts answers within the %.0f s of sending; the last answer came after %.3f s\n",
+           load.duration_ns / 1e9, elapsed_ns / 1e9);
+    printf("  %lld unanswered after the drain, %lld arrivals skipped (client saturated), %d clients failed to connect\n",
+           lost, skipped, connect_failed);
+
+    //fairness: did every client get the same service?
+    double* done = (double*)malloc((size_t)client_count * sizeof(double));
+    double* mean_ms = (double*)malloc((size_t)client_count * sizeof(double));
+    if (done == NULL || mean_ms == NULL) {
+        free(done);
+        free(mean_ms);
+        return;
+    }
+    int answered = 0;
+    for (int i = 0; i < client_count; i++) {
+        done[i] = (double)clients[i].completed;
+        if (clients[i].completed > 0) {
+            mean_ms[answered++] = clients[i].latency_sum_ns / 1e6 / clients[i].completed;
+        }
+    }
+    double done_jain = jain_index(done, client_count);
+    double latency_jain = jain_index(mean_ms, answered);
+    double low, median, high;
+    spread(done, client_count, &low, &median, &high);
+    printf("  fairness over %d clients (Jain index, 1 = equal):\n", client_count);
+    printf("    completed per client  %.4f  min %.0f  median %.0f  max %.0f\n", done_jain, low, median, high);
+    spread(mean_ms, answered, &low, &median, &high);
+    printf("    mean latency (ms)     %.4f  min %.3f  median %.3f  max %.3f\n", latency_jain, low, median, high);
+    free(done);
+    free(mean_ms);
+
+    if (per_client) {
+        printf("  %7s %9s %7s %10s %10s\n", "client", "done", "errors", "mean ms", "max ms");
+        for (int i = 0; i < client_count; i++) {
+            LoadClient* client = &clients[i];
+            printf("  %7d %9lld %7lld %10.3f %10.3f\n", i, client->completed, client->errors,
+                   client->completed ? client->latency_sum_ns / 1e6 / client->completed : 0.0,
+                   client->latency_max_ns / 1e6);
+        }
+    }
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--clients N] [--threads N] [--duration S] [--drain S] [--rate R] [--mix W:CMD,...] [--seed N] [--per-client] [--attach] [--server PATH] [-- SERVER ARGS...]\n", prog);
+    fprintf(stderr, "  --clients N   connections (default %d, max %d)\n", LOAD_DEFAULT_CLIENTS, LOAD_MAX_CLIENTS);
+    fprintf(stderr, "  --threads N   generator threads sharing the connections (default %d, max %d)\n",
+            LOAD_DEFAULT_THREADS, LOAD_MAX_THREADS);
+    fprintf(stderr, "  --duration S  seconds of sending (default %d)\n", LOAD_DEFAULT_DURATION_S);
+    fprintf(stderr, "  --drain S     seconds commands still in flight may take afterwards (default %d)\n",
+            LOAD_DEFAULT_DRAIN_S);
+    fprintf(stderr, "  --rate R      open loop: R commands/sec over all clients (default closed loop)\n");
+    fprintf(stderr, "  --mix SPEC    weighted commands (default \"%s\")\n", LOAD_DEFAULT_MIX);
+    fprintf(stderr, "  --per-client  print a row per client\n");
+    fprintf(stderr, "  --attach      use the server already listening instead of starting one\n");
+    fprintf(stderr, "  -- ARGS       server arguments (default --epoll --log-level warn)\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_path = "./server";
+    int client_count = LOAD_DEFAULT_CLIENTS;
+    int thread_count = LOAD_DEFAULT_THREADS;
+    int duration_s = LOAD_DEFAULT_DURATION_S;
+    int drain_s = LOAD_DEFAULT_DRAIN_S;
+    unsigned long long seed = 1;
+    int per_client = 0, attach = 0;
+    const char* mix = LOAD_DEFAULT_MIX;
+    char* server_argv[32];
+    int server_argc = 0;
+
+    server_argv[server_argc++] = (char*)server_path;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            client_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            duration_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--drain") == 0 && i + 1 < argc) {
+            drain_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            load.rate = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) {
+            mix = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--per-client") == 0) {
+            per_client = 1;
+        } else if (strcmp(argv[i], "--attach") == 0) {
+            attach = 1;
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server_path = argv[++i];
+            server_argv[0] = (char*)server_path;
+        } else if (strcmp(argv[i], "--") == 0) {
+            while (++i < argc && server_argc < 31) server_argv[server_argc++] = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (server_argc == 1) {
+        server_argv[server_argc++] = "--epoll";
+        server_argv[server_argc++] = "--log-level";
+        server_argv[server_argc++] = "warn";
+    }
+    server_argv[server_argc] = NULL;
+    if (client_count < 1 || client_count > LOAD_MAX_CLIENTS || thread_count < 1 || thread_count > LOAD_MAX_THREADS ||
+        duration_s < 1 || drain_s < 0 || load.rate < 0 || parse_mix(mix) != 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (thread_count > client_count) thread_count = client_count;
+    load.threads = thread_count;
+    load.duration_ns = duration_s * 1000000000LL;
+    load.drain_ns = drain_s * 1000000000LL;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    //thousands of connections need more descriptors than the usual soft limit
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    //start the server with its log discarded
+    pid_t server = -1;
+    if (!attach) {
+        server = fork();
+        if (server < 0) {
+            perror("fork failed");
+            return 1;
+        }
+        if (server == 0) {
+            int devnull = open("/dev/null", O_WRONLY);
+            dup2(devnull, STDOUT_FILENO);
+            dup2(devnull, STDERR_FILENO);
+            execv(server_path, server_argv);
+            _exit(127);
+        }
+    }
+
+    //wait until it accepts connections
+    int probe = -1;
+    for (int i = 0; i < LOAD_CONNECT_RETRIES && probe < 0; i++) {
+        probe = connect_server();
+        if (probe < 0) usleep(10000);
+    }
+    if (probe < 0) {
+        fprintf(stderr, "Server did not start (%s)\n", server_path);
+        if (server > 0) {
+            kill(server, SIGKILL);
+            waitpid(server, NULL, 0);
+        }
+        return 1;
+    }
+    close(probe);
+
+    LoadClient* clients = (LoadClient*)calloc((size_t)client_count, sizeof(LoadClient));
+    LoadThread* threads = (LoadThread*)calloc((size_t)thread_count, sizeof(LoadThread));
+    pthread_t* ids = (pthread_t*)malloc((size_t)thread_count * sizeof(pthread_t));
+    if (clients == NULL || threads == NULL || ids == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, (unsigned)thread_count);
+
+    printf("%d clients on %d threads, %s, %d s, mix:", client_count, thread_count,
+           load.rate > 0 ? "open loop" : "closed loop", duration_s);
+    for (int m = 0; m < load.mix_count; m++) {
+        printf(" %d%% \"%s\"", load.mix[m].weight * 100 / load.total_weight, load.mix[m].command);
+    }
+    if (load.rate > 0) printf(", %.1f cmds/sec offered", load.rate);
+    printf("\n");
+    fflush(stdout);
+
+    //contiguous slices of the clients, one per thread
+    for (int t = 0; t < thread_count; t++) {
+        int first = (int)((long long)client_count * t / thread_count);
+        int last = (int)((long long)client_count * (t + 1) / thread_count);
+        threads[t].index = t;
+        threads[t].clients = clients + first;
+        threads[t].client_count = last - first;
+        threads[t].rng = (seed + (unsigned long long)t + 1) * 0x9E3779B97F4A7C15ULL;
+        threads[t].start = &start;
+        pthread_create(&ids[t], NULL, load_thread_main, &threads[t]);
+    }
+    for (int t = 0; t < thread_count; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    pthread_barrier_destroy(&start);
+
+    report(threads, thread_count, clients, client_count, per_client);
+
+    for (int t = 0; t < thread_count; t++) {
+        for (int m = 0; m < load.mix_count; m++) free(threads[t].samples[m].values);
+    }
+    free(clients);
+    free(threads);
+    free(ids);
+
+    if (server > 0) {
+        kill(server, SIGTERM);
+        waitpid(server, NULL, 0);
+    }
+    return 0;
+}
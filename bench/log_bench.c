@@ -0,0 +1,153 @@
+// bench/log_bench.c - Logging cost on the calling thread: mutex + printf + fflush vs per-thread log rings
+//N threads each log task state lines, first the way the server used to (format and flush to the
+//stream under one mutex), then through log_event, whose writer thread formats and writev()s them;
+//both write to /dev/null so only the cost seen by the logging threads differs. Ring records are
+//logged in bursts that fit the ring, with an untimed flush in between, so none is dropped
+//usage: bench/log_bench [--records N] [--max-threads N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "logger.h"
+
+#define BENCH_DEFAULT_RECORDS 200000    //records per thread per run
+#define BENCH_DEFAULT_MAX_THREADS 8
+#define BENCH_BURST (LOG_RING_RECORDS / 2)   //ring records logged between flushes
+
+typedef struct {
+    int use_logger;
+    long long records;
+    FILE* stream;
+    pthread_mutex_t mutex;
+    atomic_int go;
+} Bench;
+
+typedef struct {
+    Bench* bench;
+    int index;
+    long long elapsed_ns;
+} Logger;
+
+
+static long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//what log_task_state did before: format, print and flush under the log mutex
+static void locked_log(Bench* bench, int client_num, long long remaining_us) {
+    char line[512];
+    snprintf(line, sizeof(line), "[%d]--- %s%s%s (%lld.%03lld)", client_num, "\033[1;35m", "running",
+             "\033[0m", remaining_us / 1000000, (remaining_us % 1000000) / 1000);
+    pthread_mutex_lock(&bench->mutex);
+    fprintf(bench->stream, "%s\n", line);
+    fflush(bench->stream);
+    pthread_mutex_unlock(&bench->mutex);
+}
+
+static void* logger_main(void* arg) {
+    Logger* logger = (Logger*)arg;
+    Bench* bench = logger->bench;
+    while (!atomic_load(&bench->go)) sched_yield();
+
+    logger->elapsed_ns = 0;
+    if (!bench->use_logger) {
+        long long begin = now_ns();
+        for (long long i = 0; i < bench->records; i++) {
+            locked_log(bench, logger->index + 1, i * 1000);
+        }
+        logger->elapsed_ns = now_ns() - begin;
+        return NULL;
+    }
+
+    for (long long i = 0; i < bench->records; ) {
+        long long end = i + BENCH_BURST < bench->records ? i + BENCH_BURST : bench->records;
+        long long begin = now_ns();
+        for (; i < end; i++) {
+            log_event(LOG_LEVEL_DEBUG, LOG_EVENT_TASK_STATE, logger->index + 1, (int)i, i * 1000, "running", 7);
+        }
+        logger->elapsed_ns += now_ns() - begin;
+        logger_flush();
+    }
+    return NULL;
+}
+
+//one run; mean ns per call as seen by the logging threads
+static double run(Bench* bench, int threads) {
+    atomic_store(&bench->go, 0);
+    pthread_t* ids = (pthread_t*)malloc((size_t)threads * sizeof(pthread_t));
+    Logger* args = (Logger*)malloc((size_t)threads * sizeof(Logger));
+    if (ids == NULL || args == NULL) return -1;
+    for (int t = 0; t < threads; t++) {
+        args[t].bench = bench;
+        args[t].index = t;
+        pthread_create(&ids[t], NULL, logger_main, &args[t]);
+    }
+    atomic_store(&bench->go, 1);
+
+    long long total_ns = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(ids[t], NULL);
+        total_ns += args[t].elapsed_ns;
+    }
+    free(ids);
+    free(args);
+    return (double)total_ns / (double)(bench->records * threads);
+}
+
+int main(int argc, char* argv[]) {
+    long long records = BENCH_DEFAULT_RECORDS;
+    int max_threads = BENCH_DEFAULT_MAX_THREADS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--records") == 0 && i + 1 < argc) {
+            records = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) {
+            max_threads = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--records N] [--max-threads N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (records < 1) records = 1;
+    if (max_threads < 1) max_threads = 1;
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    static Bench bench;
+    bench.records = records;
+    bench.stream = fdopen(dup(null_fd), "w");
+    if (null_fd < 0 || bench.stream == NULL) {
+        perror("/dev/null");
+        return 1;
+    }
+    pthread_mutex_init(&bench.mutex, NULL);
+    if (logger_start(LOG_LEVEL_DEBUG, LOG_FORMAT_TEXT, null_fd) != 0) {
+        fprintf(stderr, "Failed to start log writer\n");
+        return 1;
+    }
+
+    printf("%lld task state records per thread, written to /dev/null\n", records);
+    printf("%7s %15s %15s %9s %12s\n", "threads", "mutex ns/call", "ring ns/call", "speedup", "ring drops");
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        bench.use_logger = 0;
+        double mutex_ns = run(&bench, threads);
+        unsigned long long dropped_before = logger_dropped();
+        bench.use_logger = 1;
+        double ring_ns = run(&bench, threads);
+        logger_flush();
+        if (mutex_ns < 0 || ring_ns < 0) return 1;
+        printf("%7d %15.1f %15.1f %8.2fx %12llu\n", threads, mutex_ns, ring_ns, mutex_ns / ring_ns,
+               logger_dropped() - dropped_before);
+    }
+
+    logger_stop();
+    fclose(bench.stream);
+    close(null_fd);
+    return 0;
+}
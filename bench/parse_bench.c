@@ -0,0 +1,273 @@
+// bench/parse_bench.c - Parser microbenchmark: malloc-based parse_input vs the arena parser
+//first fuzzes the arena parser against parse_input (the scalar reference) in every tokenizer
+//mode, on short lines and on lines long enough for whole SIMD blocks; then parses generated
+//pipelines of 1..256 stages with both parsers and reports ns/parse and allocations/parse;
+//finally times both parsers (and every tokenizer) on lines with thousands of arguments
+//usage: bench/parse_bench [--iterations N] [--fuzz N] [--seed N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+//count every allocation the parser makes: it is compiled into this file with these hooks
+static long long allocations = 0;
+
+static void *counted_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+static char *counted_strdup(const char *s) {
+    allocations++;
+    return strdup(s);
+}
+
+#define malloc(size) counted_malloc(size)
+#define strdup(s) counted_strdup(s)
+#include "../src/parser.c"
+#undef malloc
+#undef strdup
+
+#define BENCH_DEFAULT_ITERATIONS 20000 //parses per parser per pipeline length
+#define BENCH_DEFAULT_FUZZ 20000       //short/long random line pairs fuzzed
+#define BENCH_MAX_LINE 65536           //longest generated pipeline
+#define FUZZ_SHORT_LINE 60             //short fuzz lines hit the scalar tails
+#define FUZZ_LONG_LINE 4096            //long fuzz lines exercise whole SIMD blocks
+
+static const int STAGES[] = { 1, 4, 16, 64, 256 };
+static const int ARGUMENTS[] = { 1000, 5000, 20000 };
+static const TokenizerMode MODES[] = { TOKENIZER_SCALAR, TOKENIZER_SSE2, TOKENIZER_AVX2 };
+static const char *MODE_NAMES[] = { "auto", "scalar", "sse2", "avx2" };
+
+//fuzz alphabet: plenty of separators, quotes and redirection characters
+static const char FUZZ_ALPHABET[] = "ab2c<>|\"' \t\n-x.";
+
+static unsigned long long rng_state = 88172645463325252ULL;
+
+
+//monotonic clock in nanoseconds
+static long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+//xorshift64
+static unsigned long long next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void random_line(char *line, size_t max_length) {
+    size_t length = (size_t)(next_random() % (max_length + 1));
+    for (size_t i = 0; i < length; i++) {
+        line[i] = FUZZ_ALPHABET[next_random() % (sizeof(FUZZ_ALPHABET) - 1)];
+    }
+    line[length] = '\0';
+}
+
+//build a pipeline of the given number of stages, with quoting and redirections
+static void build_line(char *line, size_t size, int stages) {
+    size_t used = (size_t)snprintf(line, size, "cat < input.txt");
+    for (int s = 1; s < stages; s++) {
+        used += (size_t)snprintf(line + used, size - used,
+                                 " | grep -v \"stage %d\" --color=never -e 'x y'", s);
+    }
+    snprintf(line + used, size - used, " > output.txt 2> errors.log");
+}
+
+//an xargs-style command line with the given number of arguments
+static char *build_long_line(int arguments) {
+    size_t size = (size_t)arguments * 24 + 64;
+    char *line = (char *)malloc(size);
+    if (line == NULL) return NULL;
+    size_t used = (size_t)snprintf(line, size, "rm -f");
+    for (int i = 0; i < arguments; i++) {
+        used += (size_t)snprintf(line + used, size - used,
+                                 (i % 8 == 7) ? " 'build dir/obj_%d.o'" : " build/obj_%d.o", i);
+    }
+    return line;
+}
+
+static int same_string(const char *a, const char *b) {
+    if (a == NULL || b == NULL) return a == b;
+    return strcmp(a, b) == 0;
+}
+
+//1 if both parses produced the same commands, arguments and redirections
+static int same_command_list(const CommandList *a, const CommandList *b) {
+    if (a == NULL || b == NULL) return a == b;
+    if (a->count != b->count) return 0;
+    for (int c = 0; c < a->count; c++) {
+        const Command *x = &a->commands[c], *y = &b->commands[c];
+        int i = 0;
+        for (; x->argv[i] && y->argv[i]; i++) {
+            if (strcmp(x->argv[i], y->argv[i]) != 0) return 0;
+        }
+        if (x->argv[i] || y->argv[i]) return 0;
+        if (!same_string(x->input_file, y->input_file) ||
+            !same_string(x->output_file, y->output_file) ||
+            !same_string(x->error_file, y->error_file)) return 0;
+    }
+    return 1;
+}
+
+//parse line into a fresh arena sized for it with the given tokenizer
+static CommandList *parse_with(TokenizerMode mode, const char *line, ParseArena *arena) {
+    size_t size = parse_arena_bytes(line);
+    void *buffer = malloc(size);
+    arena->base = NULL;
+    if (buffer == NULL) return NULL;
+    parse_arena_init(arena, buffer, size);
+    tokenizer_set_mode(mode);
+    return parse_input_arena(arena, line);
+}
+
+//differential fuzzing; 0 when every parse agreed
+static int fuzz(int rounds) {
+    static char line[FUZZ_LONG_LINE + 1];
+    //parse errors are expected on random input
+    fflush(stderr);
+    int saved_stderr = dup(STDERR_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDERR_FILENO);
+        close(null_fd);
+    }
+
+    int failures = 0;
+    for (int r = 0; r < 2 * rounds && failures == 0; r++) {
+        //alternate short and long lines; the arena parser in every mode against parse_input
+        random_line(line, (r & 1) ? FUZZ_LONG_LINE : FUZZ_SHORT_LINE);
+        CommandList *expected = parse_input(line);
+        for (size_t m = 0; m < sizeof(MODES) / sizeof(MODES[0]); m++) {
+            ParseArena arena;
+            CommandList *actual = parse_with(MODES[m], line, &arena);
+            if (!same_command_list(expected, actual)) {
+                if (strlen(line) <= FUZZ_SHORT_LINE) {
+                    printf("arena/%s disagrees with parse_input on: \"%s\"\n", MODE_NAMES[MODES[m]], line);
+                } else {
+                    printf("arena/%s disagrees with parse_input on a %zu-byte line\n", MODE_NAMES[MODES[m]], strlen(line));
+                }
+                failures++;
+            }
+            free(arena.base);
+        }
+        free_command_list(expected);
+    }
+
+    fflush(stderr);
+    if (saved_stderr >= 0) {
+        dup2(saved_stderr, STDERR_FILENO);
+        close(saved_stderr);
+    }
+    tokenizer_set_mode(TOKENIZER_AUTO);
+    return failures;
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = BENCH_DEFAULT_ITERATIONS;
+    int fuzz_rounds = BENCH_DEFAULT_FUZZ;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc) {
+            fuzz_rounds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            rng_state = strtoull(argv[++i], NULL, 10) | 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--iterations N] [--fuzz N] [--seed N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (iterations < 1) iterations = 1;
+
+    if (fuzz(fuzz_rounds) != 0) return 1;
+    printf("fuzz: %d random lines agree across parse_input and scalar/sse2/avx2 (tokenizer in use: %s)\n\n",
+           2 * fuzz_rounds, MODE_NAMES[tokenizer_mode()]);
+
+    static char line[BENCH_MAX_LINE];
+    static char arena_buffer[4 * BENCH_MAX_LINE];
+    ParseArena arena;
+    parse_arena_init(&arena, arena_buffer, sizeof(arena_buffer));
+
+    printf("%7s %7s %14s %14s %14s %14s\n", "stages", "bytes",
+           "malloc ns", "malloc allocs", "arena ns", "arena allocs");
+
+    for (size_t s = 0; s < sizeof(STAGES) / sizeof(STAGES[0]); s++) {
+        build_line(line, sizeof(line), STAGES[s]);
+        size_t length = strlen(line);
+
+        //both parsers must agree before their speed means anything
+        CommandList *expected = parse_input(line);
+        CommandList *actual = parse_input_arena(&arena, line);
+        if (!same_command_list(expected, actual)) {
+            fprintf(stderr, "parsers disagree on: %s\n", line);
+            return 1;
+        }
+        free_command_list(expected);
+        parse_arena_reset(&arena);
+
+        allocations = 0;
+        long long begin = now_ns();
+        for (int i = 0; i < iterations; i++) {
+            free_command_list(parse_input(line));
+        }
+        double malloc_ns = (double)(now_ns() - begin) / iterations;
+        double malloc_allocs = (double)allocations / iterations;
+
+        allocations = 0;
+        begin = now_ns();
+        for (int i = 0; i < iterations; i++) {
+            parse_input_arena(&arena, line);
+            parse_arena_reset(&arena);
+        }
+        double arena_ns = (double)(now_ns() - begin) / iterations;
+        double arena_allocs = (double)allocations / iterations;
+
+        printf("%7d %7zu %14.0f %14.1f %14.0f %14.1f\n", STAGES[s], length,
+               malloc_ns, malloc_allocs, arena_ns, arena_allocs);
+    }
+
+    //xargs-style argument lists: both parsers, and the arena parser with every tokenizer
+    printf("\n%9s %9s %14s %14s %14s %14s\n", "arguments", "bytes", "malloc ns", "scalar ns", "sse2 ns", "avx2 ns");
+    for (size_t a = 0; a < sizeof(ARGUMENTS) / sizeof(ARGUMENTS[0]); a++) {
+        char *long_line = build_long_line(ARGUMENTS[a]);
+        if (long_line == NULL) return 1;
+        size_t size = parse_arena_bytes(long_line);
+        void *buffer = malloc(size);
+        if (buffer == NULL) return 1;
+        ParseArena long_arena;
+        parse_arena_init(&long_arena, buffer, size);
+
+        int repeats = iterations / 100 > 0 ? iterations / 100 : 1;
+        long long begin = now_ns();
+        for (int i = 0; i < repeats; i++) {
+            free_command_list(parse_input(long_line));
+        }
+        double malloc_ns = (double)(now_ns() - begin) / repeats;
+
+        double mode_ns[3];
+        for (size_t m = 0; m < sizeof(MODES) / sizeof(MODES[0]); m++) {
+            tokenizer_set_mode(MODES[m]);
+            begin = now_ns();
+            for (int i = 0; i < repeats; i++) {
+                parse_input_arena(&long_arena, long_line);
+                parse_arena_reset(&long_arena);
+            }
+            mode_ns[m] = (double)(now_ns() - begin) / repeats;
+        }
+        tokenizer_set_mode(TOKENIZER_AUTO);
+
+        printf("%9d %9zu %14.0f %14.0f %14.0f %14.0f\n", ARGUMENTS[a], strlen(long_line),
+               malloc_ns, mode_ns[0], mode_ns[1], mode_ns[2]);
+        free(buffer);
+        free(long_line);
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+// bench/ring_bench.c - Submission contention benchmark: mutex-guarded queue vs lock-free MPSC ring
+//N producer threads publish items to one consumer that drains them in batches, first through a
+//bounded queue behind a mutex (what add_task_to_queue used to take), then through the MpscRing the
+//scheduler workers use as their inbox; both consumers poll, so only the submission path differs
+//usage: bench/ring_bench [--items N] [--max-producers N]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "mpscring.h"
+
+#define BENCH_DEFAULT_ITEMS 2000000     //items published per run, split across the producers
+#define BENCH_DEFAULT_MAX_PRODUCERS 128
+#define BENCH_CAPACITY 4096             //slots in both queues (SUBMIT_RING_CAPACITY)
+#define BENCH_BATCH 64                  //items taken per consumer pass (SUBMIT_DRAIN_BATCH)
+
+//bounded queue behind one mutex
+typedef struct {
+    void** items;
+    size_t head, count;
+    pthread_mutex_t mutex;
+} LockedQueue;
+
+typedef struct {
+    int use_ring;
+    MpscRing ring;
+    LockedQueue locked;
+    long long per_producer;
+    atomic_int go;
+} Bench;
+
+typedef struct {
+    Bench* bench;
+    int index;
+} Producer;
+
+
+static long long now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int locked_push(LockedQueue* queue, void* item) {
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->count == BENCH_CAPACITY) {
+        pthread_mutex_unlock(&queue->mutex);
+        return -1;
+    }
+    queue->items[(queue->head + queue->count) % BENCH_CAPACITY] = item;
+    queue->count++;
+    pthread_mutex_unlock(&queue->mutex);
+    return 0;
+}
+
+static size_t locked_drain(LockedQueue* queue, void** items, size_t max) {
+    pthread_mutex_lock(&queue->mutex);
+    size_t count = queue->count < max ? queue->count : max;
+    for (size_t i = 0; i < count; i++) {
+        items[i] = queue->items[queue->head];
+        queue->head = (queue->head + 1) % BENCH_CAPACITY;
+    }
+    queue->count -= count;
+    pthread_mutex_unlock(&queue->mutex);
+    return count;
+}
+
+static void* producer_main(void* arg) {
+    Producer* producer = (Producer*)arg;
+    Bench* bench = producer->bench;
+    while (!atomic_load(&bench->go)) sched_yield();
+
+    //item values are 1..n so the consumer can checksum them
+    long long first = (long long)producer->index * bench->per_producer + 1;
+    for (long long i = 0; i < bench->per_producer; i++) {
+        void* item = (void*)(uintptr_t)(first + i);
+        while ((bench->use_ring ? mpsc_ring_push(&bench->ring, item) : locked_push(&bench->locked, item)) != 0) {
+            sched_yield(); //full: let the consumer catch up
+        }
+    }
+    return NULL;
+}
+
+//one run; ns per published item, or -1 if items went missing
+static double run(Bench* bench, int producers, long long items) {
+    bench->per_producer = items / producers;
+    long long total = bench->per_producer * producers;
+    atomic_store(&bench->go, 0);
+
+    pthread_t* threads = (pthread_t*)malloc((size_t)producers * sizeof(pthread_t));
+    Producer* args = (Producer*)malloc((size_t)producers * sizeof(Producer));
+    if (threads == NULL || args == NULL) return -1;
+    for (int p = 0; p < producers; p++) {
+        args[p].bench = bench;
+        args[p].index = p;
+        pthread_create(&threads[p], NULL, producer_main, &args[p]);
+    }
+
+    long long begin = now_ns();
+    atomic_store(&bench->go, 1);
+    long long received = 0;
+    unsigned long long checksum = 0;
+    void* batch[BENCH_BATCH];
+    while (received < total) {
+        size_t count = bench->use_ring ? mpsc_ring_drain(&bench->ring, batch, BENCH_BATCH)
+                                       : locked_drain(&bench->locked, batch, BENCH_BATCH);
+        if (count == 0) {
+            sched_yield();
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) checksum += (uintptr_t)batch[i];
+        received += (long long)count;
+    }
+    long long elapsed = now_ns() - begin;
+
+    for (int p = 0; p < producers; p++) pthread_join(threads[p], NULL);
+    free(threads);
+    free(args);
+
+    unsigned long long expected = (unsigned long long)total * (unsigned long long)(total + 1) / 2;
+    return checksum == expected ? (double)elapsed / (double)total : -1;
+}
+
+int main(int argc, char* argv[]) {
+    long long items = BENCH_DEFAULT_ITEMS;
+    int max_producers = BENCH_DEFAULT_MAX_PRODUCERS;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+            items = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--max-producers") == 0 && i + 1 < argc) {
+            max_producers = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "Usage: %s [--items N] [--max-producers N]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (items < 1) items = 1;
+    if (max_producers < 1) max_producers = 1;
+
+    static Bench bench;
+    if (mpsc_ring_init(&bench.ring, BENCH_CAPACITY) != 0) return 1;
+    bench.locked.items = (void**)malloc(BENCH_CAPACITY * sizeof(void*));
+    if (bench.locked.items == NULL) return 1;
+    pthread_mutex_init(&bench.locked.mutex, NULL);
+
+    printf("%d items through a %d-slot queue, consumer drains %d at a time\n",
+           (int)items, BENCH_CAPACITY, BENCH_BATCH);
+    printf("%9s %14s %14s %14s %14s %9s\n", "producers", "mutex ns/item", "mutex Mitem/s",
+           "ring ns/item", "ring Mitem/s", "speedup");
+    for (int producers = 1; producers <= max_producers; producers *= 2) {
+        bench.use_ring = 0;
+        double mutex_ns = run(&bench, producers, items);
+        bench.use_ring = 1;
+        double ring_ns = run(&bench, producers, items);
+        if (mutex_ns < 0 || ring_ns < 0) {
+            fprintf(stderr, "items lost or duplicated with %d producers\n", producers);
+            return 1;
+        }
+        printf("%9d %14.1f %14.2f %14.1f %14.2f %8.2fx\n", producers, mutex_ns, 1000.0 / mutex_ns,
+               ring_ns, 1000.0 / ring_ns, mutex_ns / ring_ns);
+    }
+
+    mpsc_ring_destroy(&bench.ring);
+    free(bench.locked.items);
+    return 0;
+}
@@ -0,0 +1,574 @@
+// bench/sched_sim.c - Discrete-event simulator for the scheduling policies
+//replays program arrivals through the scheduler's own run queue (runqueue.c) and policy code
+//(policy.c) on a virtual clock: a program "runs" by advancing the clock, so a trace of millions
+//of multi-second programs takes seconds. Workers, placement on the least loaded worker, stealing
+//by idle workers, quanta and arrival-driven preemption follow scheduler.c; what is not modeled is
+//the cost of a dispatch itself (fork, SIGSTOP/SIGCONT, output forwarding) and the up to
+//STEAL_RETRY_MS an idle worker may take to notice a busy peer
+//trace lines: "<arrival_ms> <client> <burst_ms> [<estimate_ms> [<deadline_ms>]]" with non-decreasing
+//arrivals, '#' starts a comment; the estimate is what the scheduler is told (the burst model's
+//prediction), the burst is how long the program really runs (default: the estimate is exact), the
+//deadline is relative to the arrival (default or 0: none)
+//prints the schedule in the server's ScheduleSummary format with --schedule, and the scheduler
+//metrics (the stats table) plus throughput, utilisation, slowdown and per-client fairness, and
+//with --client-weight each client's share of the worker time (bench/weighted_clients.trace)
+//usage: bench/sched_sim [--trace FILE | --generate N] [--policy NAME] [--workers N] [--quantum-ms F[,R]]
+//                       [--clients N] [--load RHO] [--burst-ms MEAN] [--estimate-error E] [--deadline-factor F]
+//                       [--client-weight C=W] [--seed N] [--schedule]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <math.h>
+#include "policy.h"
+#include "fairshare.h"
+#include "histogram.h"
+
+#define SIM_DEFAULT_TASKS 100000
+#define SIM_DEFAULT_CLIENTS 16
+#define SIM_DEFAULT_LOAD 0.9            //offered load per worker for generated traces
+#define SIM_DEFAULT_BURST_MS 2000       //mean program burst of generated traces
+#define SIM_LINE_MAX 512
+#define SIM_EPOCH_US 1                  //virtual time of a trace's 0: Task.start_us 0 means "never dispatched"
+
+//a program in the simulation: the scheduler's Task plus how long it really runs
+typedef struct {
+    Task task;
+    long long actual_us;
+} SimTask;
+
+typedef struct {
+    WaitingQueue queue;
+    SimTask* running;                   //NULL while idle
+    long long slice_start_us;
+    long long slice_end_us;             //when the running slice ends unless preempted
+    long long run_before_us;            //the running task's run time before this slice
+} SimWorker;
+
+typedef struct {
+    long long arrival_us;
+    int client;
+    long long burst_us;
+    long long estimate_us;
+    long long deadline_us;              //absolute, 0 for none
+} Arrival;
+
+//where arrivals come from: a trace file or the generator
+typedef struct {
+    FILE* file;
+    int line_number;
+    long long remaining;                //generator: arrivals left
+    long long clock_us;                 //generator: last arrival
+    int clients;
+    double mean_gap_us;
+    double mean_burst_us;
+    double estimate_error;
+    double deadline_factor;             //generator: deadline after this many bursts, 0 for none
+    unsigned long long rng;
+} ArrivalSource;
+
+typedef struct {
+    long long completed;
+    long long turnaround_us;
+    double slowdown;                    //sum of turnaround / burst
+    long long run_us;                   //worker time the client's programs got
+    long long last_end_us;              //when its last program completed
+} ClientStats;
+
+//everything the simulation measures
+typedef struct {
+    Histogram queue_wait_us;
+    Histogram response_us;
+    Histogram turnaround_us;
+    Histogram slowdown_percent;         //turnaround as a percentage of the burst
+    Histogram quantum_use_percent;
+    Histogram queue_depth;
+    long long submitted, completed, rejected, slices, preemptions;
+    long long deadlines_met, deadlines_missed;
+    long long busy_us;                  //worker time spent running programs
+    ClientStats* clients;
+    int client_capacity;
+} SimStats;
+
+static const SchedPolicy* policy;
+static SimWorker* workers;
+static int worker_count;
+static int next_start;                  //rotating start of the least loaded search
+static int in_system;                   //tasks queued or running
+static long long schedule_start_us;     //arrival that started the current schedule
+static int schedule_entries;            //entries printed on the current schedule line
+static int print_schedule;
+static int client_weights;              //1 if --client-weight was given: report the clients' shares
+static SimStats stats;
+
+
+//the run queue frees tasks it still holds when destroyed; nothing else of scheduler.c is linked
+void destroy_task(Task* task) {
+    fair_share_task_destroyed(task->client_num);
+    free((SimTask*)((char*)task - offsetof(SimTask, task)));
+}
+
+//xorshift64*: reproducible with --seed
+static unsigned long long next_random(unsigned long long* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+//uniform in (0, 1]
+static double random_unit(unsigned long long* state) {
+    return ((next_random(state) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//next arrival; 1 if there is one, 0 at the end, -1 on a malformed trace line
+static int next_arrival(ArrivalSource* source, Arrival* arrival) {
+    if (source->file == NULL) {
+        if (source->remaining == 0) return 0;
+        source->remaining--;
+        source->clock_us += (long long)(-log(random_unit(&source->rng)) * source->mean_gap_us);
+        arrival->arrival_us = SIM_EPOCH_US + source->clock_us;
+        arrival->client = 1 + (int)(next_random(&source->rng) % (unsigned long long)source->clients);
+        arrival->burst_us = (long long)(-log(random_unit(&source->rng)) * source->mean_burst_us);
+        if (arrival->burst_us < 1000) arrival->burst_us = 1000;
+        double error = source->estimate_error * (2 * random_unit(&source->rng) - 1);
+        arrival->estimate_us = (long long)(arrival->burst_us * (1 + error));
+        arrival->deadline_us = source->deadline_factor > 0 ?
+            arrival->arrival_us + (long long)(arrival->burst_us * source->deadline_factor) : 0;
+        return 1;
+    }
+
+    char line[SIM_LINE_MAX];
+    while (fgets(line, sizeof(line), source->file) != NULL) {
+        source->line_number++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) *comment = '\0';
+        double arrival_ms, burst_ms, estimate_ms, deadline_ms;
+        int client;
+        int fields = sscanf(line, "%lf %d %lf %lf %lf", &arrival_ms, &client, &burst_ms, &estimate_ms, &deadline_ms);
+        if (fields <= 0) continue;
+        if (fields < 3 || client < 1 || burst_ms <= 0 || arrival_ms * 1000 < source->clock_us ||
+            (fields == 5 && deadline_ms < 0)) return -1;
+        arrival->arrival_us = SIM_EPOCH_US + (long long)(arrival_ms * 1000);
+        arrival->client = client;
+        arrival->burst_us = (long long)(burst_ms * 1000);
+        arrival->estimate_us = fields >= 4 ? (long long)(estimate_ms * 1000) : arrival->burst_us;
+        arrival->deadline_us = (fields == 5 && deadline_ms > 0) ?
+            arrival->arrival_us + (long long)(deadline_ms * 1000) : 0;
+        source->clock_us = (long long)(arrival_ms * 1000);
+        return 1;
+    }
+    return 0;
+}
+
+static ClientStats* client_stats(int client) {
+    if (client >= stats.client_capacity) {
+        int capacity = stats.client_capacity ? stats.client_capacity : 64;
+        while (capacity <= client) capacity *= 2;
+        ClientStats* grown = (ClientStats*)realloc(stats.clients, (size_t)capacity * sizeof(ClientStats));
+        if (grown == NULL) {
+            perror("Out of memory");
+            exit(EXIT_FAILURE);
+        }
+        memset(grown + stats.client_capacity, 0, (size_t)(capacity - stats.client_capacity) * sizeof(ClientStats));
+        stats.clients = grown;
+        stats.client_capacity = capacity;
+    }
+    return &stats.clients[client];
+}
+
+//one ScheduleSummary entry; the line ends when the system drains, as the server logs it
+static void schedule_entry(int task_id, long long now_us) {
+    if (!print_schedule) return;
+    ScheduleEntry entry = { task_id, now_us - schedule_start_us };
+    char text[64];
+    schedule_entry_format(text, sizeof(text), &entry, schedule_entries++ == 0);
+    fputs(text, stdout);
+}
+
+static void schedule_end() {
+    if (print_schedule && schedule_entries > 0) fputc('\n', stdout);
+    schedule_entries = 0;
+}
+
+//least loaded worker, a running task counting as load, ties rotating like scheduler.c
+static SimWorker* least_loaded_worker() {
+    int start = next_start++ % worker_count;
+    SimWorker* best = NULL;
+    int best_load = 0;
+    for (int i = 0; i < worker_count; i++) {
+        SimWorker* worker = &workers[(start + i) % worker_count];
+        int load = worker->queue.count + (worker->running != NULL ? 1 : 0);
+        if (best == NULL || load < best_load) {
+            best = worker;
+            best_load = load;
+            if (load == 0) break;
+        }
+    }
+    return best;
+}
+
+//the top of a busy peer's queue, for an idle worker
+static Task* steal_from_peer(SimWorker* thief) {
+    int thief_index = (int)(thief - workers);
+    for (int i = 1; i < worker_count; i++) {
+        SimWorker* victim = &workers[(thief_index + i) % worker_count];
+        if (victim->queue.count > 0 && victim->running != NULL) return runqueue_pop_next(&victim->queue, -1);
+    }
+    return NULL;
+}
+
+static void dispatch(SimWorker* worker, long long now_us);
+
+//idle workers take spare work from peers, as wake_idle_worker makes them do
+static void wake_idle_workers(long long now_us) {
+    for (int i = 0; i < worker_count; i++) {
+        if (workers[i].running == NULL) dispatch(&workers[i], now_us);
+    }
+}
+
+//start the next slice on a worker, if it has or can steal a task
+static void dispatch(SimWorker* worker, long long now_us) {
+    Task* task = policy_select(policy, &worker->queue);
+    if (task == NULL) task = steal_from_peer(worker);
+    if (task == NULL) return;
+    SimTask* sim = (SimTask*)((char*)task - offsetof(SimTask, task));
+
+    int surplus = worker->queue.count;
+    histogram_record(&stats.queue_depth, surplus);
+    histogram_record(&stats.queue_wait_us, now_us - task->ready_us);
+    if (task->start_us == 0) {
+        task->start_us = now_us;
+        histogram_record(&stats.response_us, now_us - task->arrival_us);
+    }
+
+    task->state = TASK_RUNNING;
+    task->quantum_us = policy->quantum_us(&worker->queue, task);
+    long long left_us = sim->actual_us - task->run_time_us;
+    worker->running = sim;
+    worker->slice_start_us = now_us;
+    worker->run_before_us = task->run_time_us;
+    worker->slice_end_us = now_us + (left_us < task->quantum_us ? left_us : task->quantum_us);
+
+    if (surplus > 0) wake_idle_workers(now_us);
+}
+
+//end the running slice: the program exited, used its quantum or was preempted
+static void end_slice(SimWorker* worker, long long now_us) {
+    SimTask* sim = worker->running;
+    Task* task = &sim->task;
+    long long slice_us = now_us - worker->slice_start_us;
+    worker->running = NULL;
+
+    task_account_run_time(task, worker->run_before_us + slice_us);
+    policy_slice_end(policy, task, slice_us);
+    fair_share_charge(task->client_num, slice_us);
+    client_stats(task->client_num)->run_us += slice_us;
+    stats.slices++;
+    stats.busy_us += slice_us;
+    histogram_record(&stats.quantum_use_percent, slice_us * 100 / task->quantum_us);
+    schedule_entry(task->task_id, now_us);
+
+    if (task->run_time_us >= sim->actual_us) {
+        long long turnaround_us = now_us - task->arrival_us;
+        histogram_record(&stats.turnaround_us, turnaround_us);
+        histogram_record(&stats.slowdown_percent, turnaround_us * 100 / sim->actual_us);
+        ClientStats* client = client_stats(task->client_num);
+        client->completed++;
+        client->turnaround_us += turnaround_us;
+        client->slowdown += (double)turnaround_us / (double)sim->actual_us;
+        client->last_end_us = now_us;
+        if (task->deadline_us != 0) {
+            if (now_us <= task->deadline_us) stats.deadlines_met++;
+            else stats.deadlines_missed++;
+        }
+        stats.completed++;
+        fair_share_completed(task->client_num);
+        in_system--;
+        destroy_task(task);
+    } else {
+        task->state = TASK_WAITING;
+        task->ready_us = now_us;
+        stats.preemptions++;
+        if (runqueue_push(&worker->queue, task) != 0) {
+            stats.rejected++;
+            in_system--;
+            destroy_task(task);
+        }
+    }
+
+    if (in_system == 0) schedule_end();
+    dispatch(worker, now_us);
+}
+
+//a program is submitted: queue it on the least loaded worker, which may preempt for it
+static void arrive(const Arrival* arrival) {
+    SimTask* sim = (SimTask*)calloc(1, sizeof(SimTask));
+    if (sim == NULL) {
+        perror("Out of memory");
+        exit(EXIT_FAILURE);
+    }
+    Task* task = &sim->task;
+    sim->actual_us = arrival->burst_us;
+    task->task_id = arrival->client;
+    task->client_num = arrival->client;
+    task->type = TASK_TYPE_PROGRAM;
+    task->state = TASK_WAITING;
+    task->total_burst_us = arrival->estimate_us;
+    task->remaining_burst_us = arrival->estimate_us;
+    task->heap_index = -1;
+    task->arrival_us = arrival->arrival_us;
+    task->ready_us = arrival->arrival_us;
+    task->deadline_us = arrival->deadline_us;
+    task->pid = -1;
+    task->weight = fair_share_task_created(task->client_num);
+
+    long long now_us = arrival->arrival_us;
+    if (in_system == 0) schedule_start_us = now_us;
+    SimWorker* worker = least_loaded_worker();
+    if (runqueue_push(&worker->queue, task) != 0) {
+        stats.rejected++;
+        destroy_task(task);
+        return;
+    }
+    stats.submitted++;
+    in_system++;
+
+    if (worker->running == NULL) {
+        dispatch(worker, now_us);
+        return;
+    }
+    Task* running = &worker->running->task;
+    task_account_run_time(running, worker->run_before_us + (now_us - worker->slice_start_us));
+    if (policy_preempts(policy, runqueue_peek(&worker->queue), running)) {
+        end_slice(worker, now_us);
+    } else {
+        wake_idle_workers(now_us);
+    }
+}
+
+static void summary_row(const char* name, Histogram* histogram, double scale) {
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    unsigned long long count = atomic_load(&histogram->count);
+    printf("  %-22s %9llu", name, count);
+    for (int i = 0; i < 4; i++) printf(" %10.3f", histogram_quantile(histogram, quantiles[i]) / scale);
+    printf(" %10.3f %10.3f\n", count ? (double)atomic_load(&histogram->sum) / count / scale : 0.0,
+           (double)atomic_load(&histogram->max) / scale);
+}
+
+static void report(long long origin_us, long long makespan_us, double wall_sec) {
+    printf("simulated %.3f s of scheduling in %.3f s\n", makespan_us / 1e6, wall_sec);
+    printf("programs: %lld submitted, %lld completed, %lld rejected; %lld slices, %lld preemptions\n",
+           stats.submitted, stats.completed, stats.rejected, stats.slices, stats.preemptions);
+    if (stats.deadlines_met + stats.deadlines_missed > 0) {
+        printf("deadlines: %lld met, %lld missed (%.2f%%)\n", stats.deadlines_met, stats.deadlines_missed,
+               100.0 * stats.deadlines_missed / (stats.deadlines_met + stats.deadlines_missed));
+    }
+    printf("throughput %.3f programs/s, utilisation %.1f%%\n",
+           makespan_us > 0 ? stats.completed / (makespan_us / 1e6) : 0.0,
+           makespan_us > 0 ? 100.0 * stats.busy_us / ((double)makespan_us * worker_count) : 0.0);
+
+    printf("  %-22s %9s %10s %10s %10s %10s %10s %10s\n", "latency (ms)", "count", "p50", "p90", "p99", "p99.9",
+           "mean", "max");
+    summary_row("queue wait program", &stats.queue_wait_us, 1000.0);
+    summary_row("response program", &stats.response_us, 1000.0);
+    summary_row("turnaround program", &stats.turnaround_us, 1000.0);
+    summary_row("slowdown (x)", &stats.slowdown_percent, 100.0);
+    summary_row("quantum use (%)", &stats.quantum_use_percent, 1.0);
+    summary_row("dispatch queue depth", &stats.queue_depth, 1.0);
+
+    //Jain's index over the clients' mean slowdown: 1 when every client is served alike
+    double sum = 0, squares = 0, worst = 0;
+    int clients = 0;
+    for (int c = 0; c < stats.client_capacity; c++) {
+        ClientStats* client = &stats.clients[c];
+        if (client->completed == 0) continue;
+        double slowdown = client->slowdown / client->completed;
+        sum += slowdown;
+        squares += slowdown * slowdown;
+        if (slowdown > worst) worst = slowdown;
+        clients++;
+    }
+    if (clients > 0) {
+        printf("fairness over %d clients: Jain index of mean slowdown %.4f, mean %.3f, worst client %.3f\n",
+               clients, squares > 0 ? sum * sum / (clients * squares) : 1.0, sum / clients, worst);
+    }
+
+    //with weights set, how the workers' time was split and when each client was done
+    if (client_weights && stats.busy_us > 0) {
+        printf("  %-22s %9s %10s %10s %10s %10s\n", "shares", "weight", "completed", "run (s)", "share", "done (s)");
+        for (int c = 0; c < stats.client_capacity; c++) {
+            ClientStats* client = &stats.clients[c];
+            if (client->run_us == 0) continue;
+            printf("  client %-15d %9d %10lld %10.3f %9.1f%% %10.3f\n", c, fair_share_weight(c), client->completed,
+                   client->run_us / 1e6, 100.0 * client->run_us / stats.busy_us,
+                   client->completed ? (client->last_end_us - origin_us) / 1e6 : 0.0);
+        }
+    }
+}
+
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--trace FILE | --generate N] [--policy NAME] [--workers N] [--quantum-ms F[,R]] [--clients N] [--load RHO] [--burst-ms MEAN] [--estimate-error E] [--deadline-factor F] [--client-weight C=W] [--seed N] [--schedule]\n", prog);
+    fprintf(stderr, "  --trace FILE     \"<arrival_ms> <client> <burst_ms> [<estimate_ms> [<deadline_ms>]]\" lines ('-' = stdin)\n");
+    fprintf(stderr, "  --generate N     N Poisson arrivals with exponential bursts instead (default %d)\n",
+            SIM_DEFAULT_TASKS);
+    fprintf(stderr, "  --policy NAME    scheduling policy:");
+    for (int i = 0; scheduling_policies[i] != NULL; i++) fprintf(stderr, " %s", scheduling_policies[i]->name);
+    fprintf(stderr, " (default %s)\n", scheduling_policies[0]->name);
+    fprintf(stderr, "  --workers N      scheduler workers (default %d)\n", DEFAULT_SCHEDULER_WORKERS);
+    fprintf(stderr, "  --quantum-ms F,R quantum for the first and later rounds (default %lld,%lld)\n",
+            FIRST_ROUND_QUANTUM_US / 1000, DEFAULT_QUANTUM_US / 1000);
+    fprintf(stderr, "  --clients N      generated: clients submitting (default %d)\n", SIM_DEFAULT_CLIENTS);
+    fprintf(stderr, "  --load RHO       generated: offered load per worker (default %.2f)\n", SIM_DEFAULT_LOAD);
+    fprintf(stderr, "  --burst-ms MEAN  generated: mean burst (default %d)\n", SIM_DEFAULT_BURST_MS);
+    fprintf(stderr, "  --estimate-error E generated: estimates off by up to +-E of the burst (default 0)\n");
+    fprintf(stderr, "  --deadline-factor F generated: deadline F bursts after arrival (default 0: none)\n");
+    fprintf(stderr, "  --client-weight C=W client C's weight under the fair and cfs policies (default %d; repeatable)\n",
+            TASK_DEFAULT_WEIGHT);
+    fprintf(stderr, "  --schedule       print the schedule in the server's summary format\n");
+}
+
+int main(int argc, char* argv[]) {
+    const char* trace = NULL;
+    long long tasks = SIM_DEFAULT_TASKS;
+    int clients = SIM_DEFAULT_CLIENTS;
+    double load = SIM_DEFAULT_LOAD, burst_ms = SIM_DEFAULT_BURST_MS, estimate_error = 0;
+    double deadline_factor = 0;
+    unsigned long long seed = 1;
+    policy = scheduling_policies[0];
+    worker_count = DEFAULT_SCHEDULER_WORKERS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace = argv[++i];
+        } else if (strcmp(argv[i], "--generate") == 0 && i + 1 < argc) {
+            tasks = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            policy = policy_find(argv[++i]);
+            if (policy == NULL) {
+                fprintf(stderr, "Unknown policy: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            worker_count = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--quantum-ms") == 0 && i + 1 < argc) {
+            char* rest = NULL;
+            long first_ms = strtol(argv[++i], &rest, 10);
+            long rest_ms = (*rest == ',') ? strtol(rest + 1, NULL, 10) : first_ms;
+            if (first_ms <= 0 || rest_ms <= 0) {
+                fprintf(stderr, "Invalid quantum: %s\n", argv[i]);
+                return 1;
+            }
+            first_round_quantum_us = first_ms * 1000LL;
+            default_quantum_us = rest_ms * 1000LL;
+        } else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            clients = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--load") == 0 && i + 1 < argc) {
+            load = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--burst-ms") == 0 && i + 1 < argc) {
+            burst_ms = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--estimate-error") == 0 && i + 1 < argc) {
+            estimate_error = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--deadline-factor") == 0 && i + 1 < argc) {
+            deadline_factor = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--client-weight") == 0 && i + 1 < argc) {
+            char* weight = strchr(argv[++i], '=');
+            if (weight == NULL || atoi(argv[i]) < 1 || fair_share_set_weight(atoi(argv[i]), atoi(weight + 1)) != 0) {
+                fprintf(stderr, "Invalid client weight: %s\n", argv[i]);
+                return 1;
+            }
+            client_weights = 1;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--schedule") == 0) {
+            print_schedule = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (tasks < 0 || clients < 1 || load <= 0 || burst_ms < 1 || estimate_error < 0 || estimate_error >= 1 ||
+        deadline_factor < 0 ||
+        worker_count < 1 || worker_count > MAX_SCHEDULER_WORKERS) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    ArrivalSource source;
+    memset(&source, 0, sizeof(source));
+    if (trace != NULL) {
+        source.file = strcmp(trace, "-") == 0 ? stdin : fopen(trace, "r");
+        if (source.file == NULL) {
+            perror(trace);
+            return 1;
+        }
+    } else {
+        source.remaining = tasks;
+        source.clients = clients;
+        source.mean_burst_us = burst_ms * 1000;
+        source.mean_gap_us = source.mean_burst_us / (load * worker_count);
+        source.estimate_error = estimate_error;
+        source.deadline_factor = deadline_factor;
+        source.rng = (seed + 1) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    workers = (SimWorker*)calloc((size_t)worker_count, sizeof(SimWorker));
+    if (workers == NULL) {
+        perror("Out of memory");
+        return 1;
+    }
+    for (int w = 0; w < worker_count; w++) runqueue_init(&workers[w].queue, policy);
+
+    printf("policy %s, %d worker%s, quanta %lld/%lld ms, %s\n", policy->name, worker_count,
+           worker_count == 1 ? "" : "s", first_round_quantum_us / 1000, default_quantum_us / 1000,
+           trace != NULL ? trace : "generated arrivals");
+    fflush(stdout);
+
+    //next event: the earliest slice end, or the next arrival if it comes first
+    double begin = now_sec();
+    long long now_us = 0;
+    Arrival arrival;
+    int pending = next_arrival(&source, &arrival);
+    long long origin_us = pending > 0 ? arrival.arrival_us : 0;
+    for (;;) {
+        SimWorker* next_end = NULL;
+        for (int w = 0; w < worker_count; w++) {
+            if (workers[w].running != NULL && (next_end == NULL || workers[w].slice_end_us < next_end->slice_end_us)) {
+                next_end = &workers[w];
+            }
+        }
+        if (pending < 0) {
+            fprintf(stderr, "%s:%d: expected \"<arrival_ms> <client> <burst_ms> [<estimate_ms> [<deadline_ms>]]\" in arrival order\n",
+                    trace, source.line_number);
+            return 1;
+        }
+        if (pending > 0 && (next_end == NULL || arrival.arrival_us < next_end->slice_end_us)) {
+            now_us = arrival.arrival_us;
+            arrive(&arrival);
+            pending = next_arrival(&source, &arrival);
+        } else if (next_end != NULL) {
+            now_us = next_end->slice_end_us;
+            end_slice(next_end, now_us);
+        } else {
+            break;
+        }
+    }
+    double wall_sec = now_sec() - begin;
+    schedule_end();
+
+    report(origin_us, now_us - origin_us, wall_sec);
+
+    if (source.file != NULL && source.file != stdin) fclose(source.file);
+    for (int w = 0; w < worker_count; w++) runqueue_destroy(&workers[w].queue);
+    free(workers);
+    free(stats.clients);
+    return 0;
+}
@@ -0,0 +1,190 @@
+// bench/shell_bench.c - Shell command throughput benchmark
+//starts ./server, then for 1..64 concurrent clients sends "echo" commands
+//back to back (each client waits for its reply before sending the next)
+//and reports completed commands per second
+//usage: bench/shell_bench [--server PATH] [--commands N] [-- SERVER ARGS...]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include "../include/client.h"
+
+#define BENCH_MAX_CLIENTS 64          //largest client count measured
+#define BENCH_DEFAULT_COMMANDS 200    //commands per client per run
+#define BENCH_CONNECT_RETRIES 100     //server start-up polls (10ms apart)
+
+typedef struct {
+    int id;                           //client index, part of every echoed token
+    int commands;                     //commands to send
+    int completed;                    //replies received
+    pthread_barrier_t* start;         //all clients start sending together
+} BenchClient;
+
+
+//wall clock in seconds
+static double now_sec() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//connect to the server, -1 if it is not listening
+static int connect_server() {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SERVER_PORT);
+    inet_pton(AF_INET, SERVER_IP, &addr.sin_addr);
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) return -1;
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+//read from sock until the reply contains token; 0 on success
+static int await_reply(int sock, const char* token) {
+    char buffer[CLIENT_BUFFER_SIZE];
+    size_t used = 0;
+    size_t token_len = strlen(token);
+
+    while (1) {
+        ssize_t bytes = recv(sock, buffer + used, sizeof(buffer) - 1 - used, 0);
+        if (bytes <= 0) return -1;
+        used += (size_t)bytes;
+        buffer[used] = '\0';
+        if (strstr(buffer, token) != NULL) return 0;
+
+        //keep only a tail long enough to hold a token split across reads
+        if (used > token_len) {
+            memmove(buffer, buffer + used - token_len, token_len);
+            used = token_len;
+        }
+    }
+}
+
+//one client: send a command, wait for its reply, repeat
+static void* client_main(void* arg) {
+    BenchClient* client = (BenchClient*)arg;
+    int sock = connect_server();
+    pthread_barrier_wait(client->start);
+    if (sock < 0) return NULL;
+
+    char command[64];
+    char token[64];
+    for (int i = 0; i < client->commands; i++) {
+        snprintf(token, sizeof(token), "b%d-%d\n", client->id, i);
+        snprintf(command, sizeof(command), "echo b%d-%d", client->id, i);
+        if (send(sock, command, strlen(command), 0) < 0) break;
+        if (await_reply(sock, token) != 0) break;
+        client->completed++;
+    }
+    close(sock);
+    return NULL;
+}
+
+//run one measurement with client_count concurrent clients
+static void run_round(int client_count, int commands) {
+    pthread_t threads[BENCH_MAX_CLIENTS];
+    BenchClient clients[BENCH_MAX_CLIENTS];
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, client_count + 1);
+
+    for (int i = 0; i < client_count; i++) {
+        clients[i].id = i;
+        clients[i].commands = commands;
+        clients[i].completed = 0;
+        clients[i].start = &start;
+        pthread_create(&threads[i], NULL, client_main, &clients[i]);
+    }
+
+    pthread_barrier_wait(&start);
+    double begin = now_sec();
+    int completed = 0;
+    for (int i = 0; i < client_count; i++) {
+        pthread_join(threads[i], NULL);
+        completed += clients[i].completed;
+    }
+    double elapsed = now_sec() - begin;
+    pthread_barrier_destroy(&start);
+
+    printf("%8d %10d %10.3f %12.1f\n", client_count, completed, elapsed,
+           elapsed > 0 ? completed / elapsed : 0.0);
+    fflush(stdout);
+}
+
+int main(int argc, char* argv[]) {
+    const char* server_path = "./server";
+    int commands = BENCH_DEFAULT_COMMANDS;
+    char* server_argv[32];
+    int server_argc = 0;
+
+    server_argv[server_argc++] = (char*)server_path;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server_path = argv[++i];
+            server_argv[0] = (char*)server_path;
+        } else if (strcmp(argv[i], "--commands") == 0 && i + 1 < argc) {
+            commands = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--") == 0) {
+            while (++i < argc && server_argc < 31) server_argv[server_argc++] = argv[i];
+        } else {
+            fprintf(stderr, "Usage: %s [--server PATH] [--commands N] [-- SERVER ARGS...]\n", argv[0]);
+            return 1;
+        }
+    }
+    server_argv[server_argc] = NULL;
+    if (commands < 1) commands = 1;
+
+    signal(SIGPIPE, SIG_IGN);
+
+    //start the server with its log discarded
+    pid_t server = fork();
+    if (server < 0) {
+        perror("fork failed");
+        return 1;
+    }
+    if (server == 0) {
+        int devnull = open("/dev/null", O_WRONLY);
+        dup2(devnull, STDOUT_FILENO);
+        dup2(devnull, STDERR_FILENO);
+        execv(server_path, server_argv);
+        _exit(127);
+    }
+
+    //wait until it accepts connections
+    int probe = -1;
+    for (int i = 0; i < BENCH_CONNECT_RETRIES && probe < 0; i++) {
+        usleep(10000);
+        probe = connect_server();
+    }
+    if (probe < 0) {
+        fprintf(stderr, "Server did not start (%s)\n", server_path);
+        kill(server, SIGKILL);
+        waitpid(server, NULL, 0);
+        return 1;
+    }
+    close(probe);
+
+    printf("shell command throughput, %d commands per client\n", commands);
+    printf("%8s %10s %10s %12s\n", "clients", "commands", "seconds", "cmds/sec");
+    for (int clients = 1; clients <= BENCH_MAX_CLIENTS; clients *= 2) {
+        run_round(clients, commands);
+    }
+
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    return 0;
+}
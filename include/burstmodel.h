@@ -0,0 +1,60 @@
+//include/burstmodel.h - Burst time prediction from the measured run times of earlier commands
+#ifndef BURSTMODEL_H
+#define BURSTMODEL_H
+
+#define BURST_MODEL_CAPACITY 4096          //signatures remembered; a new one then replaces one not used lately
+#define BURST_MODEL_MAX_USES 3             //recent runs a signature can bank against replacement
+#define BURST_MODEL_WEIGHT_PERCENT 50      //share of the newest run in the average (exponential averaging)
+#define BURST_MODEL_MIN_US 1000            //floor of a prediction, so a predicted job still counts as one
+#define BURST_MODEL_MAGIC 0x31544D42u      //"BMT1", first word of the model file
+
+/**
+ * The model keeps an exponential average of run time per signature:
+ *   - the command signature: executable and arguments, whitespace-normalized
+ *   - the executable signature: first word only, shared by all its argument lists
+ * Run time is the wall time a program spent scheduled (task->run_time_us), the
+ * quantity SJRF orders by. Once the model is full, a new signature replaces one picked
+ * by a clock sweep: every run banks a use (up to BURST_MODEL_MAX_USES), the sweep takes
+ * one from each signature it passes and replaces the first with none left.
+ * All functions are thread-safe
+ */
+
+/**
+ * Loads a model file and remembers it for burst_model_save
+ * Loaded signatures keep half their banked uses, so ones no later run of the server
+ * needs age out of a full model first.
+ * A missing file is not an error: the model starts empty and is created on the first save
+ *
+ * @param path - model file
+ * @return 0 on success, -1 if the file exists but can't be read or is not a model file
+ */
+int burst_model_load(const char* path);
+
+/**
+ * Predicts a program's burst
+ * Order: the command signature's average, then the executable's average when the command
+ * carries no burst of its own (hint_us is the default), then hint_us
+ *
+ * @param command - the command text
+ * @param hint_us - burst implied by the command itself (extract_burst_time)
+ * @return predicted burst in microseconds
+ */
+long long burst_model_predict_us(const char* command, long long hint_us);
+
+/**
+ * Folds a finished program's run time into both of its signatures
+ *
+ * @param command - the command text
+ * @param run_us - time the program spent running
+ */
+void burst_model_record(const char* command, long long run_us);
+
+/**
+ * Writes the model to the loaded file if it changed since the last save
+ * The file is replaced atomically (written next to it, then renamed)
+ *
+ * @return 0 on success or when there is nothing to do, -1 on a write error
+ */
+int burst_model_save();
+
+#endif //BURSTMODEL_H
@@ -0,0 +1,41 @@
+//include/classify.h - Command table deciding whether a command runs as a shell command or a program
+#ifndef CLASSIFY_H
+#define CLASSIFY_H
+
+#include <stddef.h>
+#include "scheduler.h"
+
+/**
+ * The command table maps a command's first word to its TaskType
+ * It starts out with the built-in shell commands (ls, echo, cat, ...) and can be extended
+ * or overridden from a file (--command-table). Names are kept in a trie, so a lookup walks
+ * the first word once, in place, whatever the table size
+ *
+ * Table file format, one entry per line, '#' starts a comment:
+ *     <name> shell|program       first word, or an absolute executable path
+ *     default shell|program      class of commands found nowhere in the table
+ * A first word not in the table is resolved on PATH and the resolved path looked up again,
+ * so "/usr/bin/make program" also catches "make"; tables without any path entry skip that
+ */
+
+/**
+ * Loads entries from a table file on top of the built-in ones
+ * Call before the server starts its threads: lookups read the table without locking
+ *
+ * @param path - table file
+ * @return 0 on success, -1 if the file can't be read or has a malformed line (reported on stderr)
+ */
+int load_command_table(const char* path);
+
+/**
+ * Classifies a command by its first word
+ * Order: table entry for the word, "./" prefix (program), table entry for the word's
+ * PATH resolution (only when some entry names a path), then the table default (shell
+ * unless the table says otherwise)
+ *
+ * @param command - the command text
+ * @return TASK_TYPE_SHELL or TASK_TYPE_PROGRAM
+ */
+TaskType classify_command(const char* command);
+
+#endif //CLASSIFY_H
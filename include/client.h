@@ -6,7 +6,7 @@
 //client configuration constants
 #define SERVER_PORT 8080
 #define SERVER_IP "127.0.0.1"   //localhost, change if server is remote
-#define CLIENT_BUFFER_SIZE 4096 //maximum size for sending/receiving commands
+#define CLIENT_BUFFER_SIZE 4096 //bytes read from the server per recv() (input lines may be any length)
 
 /**
  * Starts the client program
@@ -15,7 +15,12 @@
  * 2. Reads user input
  * 3. Sends command to server
  * 4. Receives output and displays it
+ *
+ * In batch mode all of stdin is read first and sent as BATCH frames; each command's
+ * output is printed once it finishes, every line tagged with the command's line number
+ *
+ * @param batch - nonzero for batch mode
  */
-void start_client();
+void start_client(int batch);
 
 #endif
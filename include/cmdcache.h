@@ -0,0 +1,93 @@
+//include/cmdcache.h - LRU cache of classified or parsed commands keyed by command text
+#ifndef CMDCACHE_H
+#define CMDCACHE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "parser.h"
+#include "scheduler.h"
+
+#define COMMAND_CACHE_DEFAULT_CAPACITY 1024 //entries kept when --command-cache is not given
+#define COMMAND_CACHE_MAX_CAPACITY 1048576  //upper bound on --command-cache
+#define COMMAND_CACHE_MAX_KEY 1024          //longer (generated) commands are never cached
+
+/**
+ * What a process caches about a command: each derives only what it uses
+ */
+typedef enum {
+    COMMAND_CACHE_CLASSIFY,            //server: task type and burst estimate
+    COMMAND_CACHE_PARSE                //zygote: the parsed pipeline it execs
+} CommandCacheContent;
+
+/**
+ * What one process derives from a command's text, computed once
+ * Entries are immutable once published, so holders read them without locking;
+ * the text, the entry and its CommandList live in one allocation
+ */
+typedef struct ParsedCommand {
+    const char* text;                  //the command text (cache key)
+    TaskType type;                     //classify: shell command or program (get_task_type)
+    int burst_seconds;                 //classify: expected run time (extract_burst_time)
+    const CommandList* commands;       //parse: argv and redirections if the line can be exec'ed directly, NULL if it needs /bin/sh
+
+    //cache bookkeeping, guarded by the cache mutex
+    size_t length;                     //strlen(text)
+    uint64_t hash;                     //FNV-1a of text
+    atomic_int refs;                   //holders, plus one while the entry is in the cache
+    int cached;                        //1 while reachable from the table
+    struct ParsedCommand* hash_next;   //bucket chain
+    struct ParsedCommand* lru_prev;    //towards the most recently used entry
+    struct ParsedCommand* lru_next;    //towards the least recently used entry
+} ParsedCommand;
+
+typedef struct {
+    unsigned long long hits;           //lookups answered from the cache
+    unsigned long long misses;         //lookups that had to classify or parse
+    unsigned long long evictions;      //entries dropped to stay within capacity
+    unsigned long long uncached;       //commands too long to cache, left to the caller
+    int entries;                       //entries currently cached
+    int capacity;                      //maximum entries
+} CommandCacheStats;
+
+
+/**
+ * Sizes the cache; call once before any lookup (start_server does, before forking
+ * the zygote, so the helper gets an empty cache of the same size)
+ * Entries hold COMMAND_CACHE_CLASSIFY content until command_cache_set_content changes it
+ *
+ * @param capacity - maximum cached entries, 0 disables caching
+ * @return 0 on success, -1 if out of memory (caching stays disabled)
+ */
+int command_cache_init(int capacity);
+
+/**
+ * Chooses what entries built from now on hold; the zygote switches to
+ * COMMAND_CACHE_PARSE when it starts, before its first lookup
+ */
+void command_cache_set_content(CommandCacheContent content);
+
+/**
+ * Looks a command up, classifying or parsing it on a miss
+ * The most recently used entries are kept; the least recently used one is evicted
+ * once the cache is full. Thread-safe
+ *
+ * @param command - the command text
+ * @return a held entry (release it with command_cache_release), or NULL if the command
+ *         is longer than COMMAND_CACHE_MAX_KEY, caching is disabled or memory ran out;
+ *         the caller then works on the text directly
+ */
+const ParsedCommand* command_cache_get(const char* command);
+
+/**
+ * Drops a hold on an entry; evicted entries are freed with their last holder
+ */
+void command_cache_release(const ParsedCommand* entry);
+
+/**
+ * Copies the hit/miss counters
+ * Each process (server, zygote) has its own cache and counters
+ */
+void command_cache_stats(CommandCacheStats* stats);
+
+#endif //CMDCACHE_H
@@ -0,0 +1,123 @@
+//include/connection.h - Shared, reference-counted client connection
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "protocol.h"
+
+#define OUTPUT_CHUNK_SIZE 65536    //max bytes moved from a task's output pipe per splice() call
+#define CONN_OUTBOX_MAX (8 << 20)  //queued reply bytes an I/O thread holds for a client before dropping it
+
+/**
+ * One client connection as seen by everything that writes to it
+ * The reader (client thread or reactor) and every task of the client hold a
+ * reference; the socket is closed when the last one is released, so a task that
+ * is still running never writes to a descriptor number reused by a new client.
+ * Writers take send_mutex per frame, so frames of concurrently running commands
+ * never interleave.
+ *
+ * I/O threads must not block on one client, so their replies go to the outbox
+ * and are sent without blocking. What the socket does not take stays queued. The
+ * I/O thread sends it when the socket becomes writable, or another writer sends it
+ * first, before writing its own frame
+ */
+typedef struct ClientConn {
+    int socket;                        //client socket, closed on the last release
+    int client_num;                    //sequential client number (1, 2, 3, ...)
+    volatile int framed;               //1 once the client sent the protocol hello
+    atomic_int refs;                   //reader + tasks holding this connection
+    atomic_int closed;                 //1 once conn_shutdown ran; submitted tasks are dropped from then on
+    pthread_mutex_t send_mutex;        //serializes frames written to the socket
+    char* outbox;                      //replies queued by an I/O thread, not yet sent
+    size_t outbox_sent;                //bytes of outbox already sent
+    size_t outbox_used;                //bytes in outbox
+    size_t outbox_capacity;            //allocated size of outbox
+    int outbox_failed;                 //1 once the outbox overflowed or its send failed
+    pthread_mutex_t outbox_mutex;      //protects the outbox; never held across a blocking send
+} ClientConn;
+
+
+/**
+ * Wraps an accepted socket; the caller holds the only reference
+ *
+ * @return the connection, or NULL if out of memory (socket left open)
+ */
+ClientConn* conn_create(int socket, int client_num);
+
+/**
+ * Takes another reference
+ *
+ * @return conn, for chaining
+ */
+ClientConn* conn_retain(ClientConn* conn);
+
+/**
+ * Drops a reference, closing the socket and freeing the connection on the last one
+ */
+void conn_release(ClientConn* conn);
+
+/**
+ * Shuts the socket down in both directions once the reader is done with it
+ * Tasks still holding the connection fail their next send and stop, and tasks
+ * still in a scheduler inbox are dropped instead of queued
+ */
+void conn_shutdown(ClientConn* conn);
+
+/**
+ * Sends one response frame for a command
+ * Legacy clients get OUTPUT and ERROR payloads as raw bytes and no END frames.
+ * On a thread that called conn_defer_sends the frame is queued with
+ * conn_queue_frame instead, so the call never blocks
+ *
+ * @return 0 on success, -1 if the client is gone or stalled
+ */
+int conn_send_frame(ClientConn* conn, FrameType type, uint32_t request_id, const void* data, size_t length);
+
+/**
+ * Reports an error for a command and ends it (ERROR frame followed by END)
+ *
+ * @return 0 on success, -1 if the client is gone or stalled
+ */
+int conn_send_error(ClientConn* conn, uint32_t request_id, const char* message);
+
+/**
+ * Queues one response frame in the outbox and sends what the socket takes without blocking
+ *
+ * @return 0 on success (sent or queued), -1 if the outbox overflowed or the client is gone
+ */
+int conn_queue_frame(ClientConn* conn, FrameType type, uint32_t request_id, const void* data, size_t length);
+
+/**
+ * Sends as much of the outbox as the socket takes without blocking
+ * If another thread holds send_mutex, nothing is sent here: that thread sends
+ * the outbox before it lets go
+ *
+ * @return 0 if the outbox is empty, 1 if bytes are still queued, -1 if the
+ *         outbox overflowed or the client is gone
+ */
+int conn_flush_outbox(ClientConn* conn);
+
+/**
+ * Makes conn_send_frame and conn_send_error queue on the calling thread instead of
+ * blocking, for the reactor's I/O threads
+ */
+void conn_defer_sends();
+
+/**
+ * Moves what is buffered in a non-blocking pipe to the client as OUTPUT frames
+ * Uses splice() so the bytes go pipe -> socket inside the kernel (framed clients
+ * get a header sized with FIONREAD first). The socket blocks, bounded by its
+ * SO_SNDTIMEO, so a slow client pushes back on the pipe's writer
+ *
+ * @param conn - the client
+ * @param request_id - command the output belongs to
+ * @param fd - read end of the pipe (O_NONBLOCK)
+ * @return bytes forwarded (> 0), 0 at EOF, or -1 with errno EAGAIN when the pipe is
+ *         empty and any other errno when the client is gone or stalled
+ */
+ssize_t conn_forward_pipe(ClientConn* conn, uint32_t request_id, int fd);
+
+#endif //CONNECTION_H
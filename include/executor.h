@@ -2,10 +2,37 @@
 #ifndef EXECUTOR_H
 #define EXECUTOR_H
 
+#include <sys/types.h>
 #include "parser.h" //include the parser header to access CommandList and Command structure definitions
 
+#define SPAWN_MAX_PATH 4096   //longest resolved executable path
+
 //execute parsed command(s)
 void execute_commands(CommandList *cmdlist); //serves as the primary execution engine for the shell, taking parsed
 //command information from the parser and executing each command in separate child processes.
 
+//find an executable the way execvp would: 0 and its path in out, -1 if there is none
+int resolve_executable(const char *name, char *out, size_t size);
+
+//start parsed command(s) with posix_spawn, without waiting: same pipes and redirections as
+//execute_commands, stdout/stderr of the pipeline on out_fd, stdin from /dev/null, all stages in
+//one new process group led by the last stage. Returns the leader's pid, or -1 if a program
+//can't be found or started (nothing is left running then)
+pid_t spawn_commands(const CommandList *cmdlist, int out_fd);
+
+//1 if a command line uses shell syntax the parser doesn't understand (;, &, $, globs, >>, a>b ...)
+int command_needs_shell(const char *line);
+
+//start a command line with /bin/sh -c: output and stdin as in spawn_commands, sh leads its own
+//process group. Returns sh's pid, or -1 on failure
+pid_t spawn_shell_command(const char *line, int out_fd);
+
+//start a command line for the server: exec'ed directly through parse_input_arena + spawn_commands when
+//it only uses what the parser understands (words, quotes, |, <, >, 2>), otherwise with /bin/sh -c.
+//Returns the pid of the process group leader, or -1 on failure
+pid_t launch_command(const char *line, int out_fd);
+
+//SIGKILL a process group started by launch_command and reap every member, leader included
+void reap_process_group(pid_t leader);
+
 #endif
@@ -0,0 +1,135 @@
+//include/fairshare.h - Per-client and per-group shares of scheduler time, and their accounting
+#ifndef FAIRSHARE_H
+#define FAIRSHARE_H
+
+#define FAIR_SHARE_MAX_GROUPS 64           //groups defined with --share, including the implicit no-group
+#define FAIR_SHARE_NAME_MAX 32             //longest group name, including the terminator
+#define FAIR_SHARE_MAX_MEMBERS 256         //client addresses mapped to groups with --member
+#define FAIR_SHARE_ADDRESS_MAX 64          //longest client address, including the terminator
+#define FAIR_SHARE_MAX_WEIGHT 1048576      //largest client or group weight (TASK_DEFAULT_WEIGHT is one share)
+#define FAIR_SHARE_CLIENT_BUCKETS 1024     //hash buckets of the client accounts (power of two)
+#define FAIR_SHARE_REPORT_CLIENTS 10       //clients listed in the stats summary, most served first
+#define FAIR_SHARE_NO_GROUP "-"            //name reported for clients that joined no group
+
+/**
+ * Two levels of shares: every client has a weight (TASK_DEFAULT_WEIGHT unless set),
+ * and a client may belong to a group (a tenant) defined with a weight of its own. A
+ * client outside any group competes with its own weight; a group's weight is split
+ * between its active members (clients with tasks in the system) in proportion to
+ * theirs, so a group gets its share however many clients it runs. The operator
+ * decides membership (the client's address) and group weights; clients can only
+ * give up part of their own share.
+ *
+ * Every task is created with its client's effective weight, and the policies weigh
+ * it with that: cfs scales its vruntime by it, and fair (policy.c) advances the
+ * client's start-time fair queueing tags in a run queue by the expected service
+ * divided by it. The tags live in the run queue, under its own lock, so a client
+ * flooding the queue only pushes its own tags further out. Accounting (service, completions) is kept under every policy and
+ * shown by the stats command. All functions are thread-safe
+ */
+
+/**
+ * Usage of one group or client, as reported by stats
+ */
+typedef struct {
+    char group[FAIR_SHARE_NAME_MAX];   //group name, FAIR_SHARE_NO_GROUP for none
+    int client_num;                    //client, or -1 for a group
+    int weight;                        //configured weight
+    int active;                        //group: active members; client: tasks in the system
+    long long run_us;                  //scheduler time received
+    unsigned long long completed;      //tasks completed
+} FairShareUsage;
+
+
+/**
+ * Defines a group, or changes the weight of an existing one
+ *
+ * @param name - group name (not FAIR_SHARE_NO_GROUP)
+ * @param weight - 1..FAIR_SHARE_MAX_WEIGHT
+ * @return 0 on success, -1 if the name or weight is invalid or there are too many groups
+ */
+int fair_share_define_group(const char* name, int weight);
+
+/**
+ * Puts the clients connecting from an address in a defined group
+ *
+ * @param address - the client's address as the server prints it (dotted IPv4)
+ * @return 0 on success, -1 if there is no group of that name, the address is
+ *         invalid or there are too many mappings
+ */
+int fair_share_add_member(const char* address, const char* group);
+
+/**
+ * A client connected: puts it in the group its address is mapped to, if any
+ */
+void fair_share_client_connected(int client_num, const char* address);
+
+/**
+ * Sets a client's weight within its group (or against other ungrouped clients)
+ * Any weight is accepted here; the "weight" builtin only lets a client lower its own
+ *
+ * @param weight - 1..FAIR_SHARE_MAX_WEIGHT
+ * @return 0 on success, -1 if the weight is invalid
+ */
+int fair_share_set_weight(int client_num, int weight);
+
+/**
+ * The client's effective weight: its own outside a group, its part of the group's
+ * weight inside one (split between the active members)
+ *
+ * @return the weight, TASK_DEFAULT_WEIGHT for a client without an account
+ */
+int fair_share_weight(int client_num);
+
+/**
+ * A task of the client entered the system (created); the first makes the client active
+ *
+ * @return the client's effective weight (as fair_share_weight), which the task is
+ *         weighed with by cfs and fair
+ */
+int fair_share_task_created(int client_num);
+
+/**
+ * A task of the client left the system (destroyed); the last makes the client inactive
+ */
+void fair_share_task_destroyed(int client_num);
+
+/**
+ * The client disconnected; its account is dropped once its last task is destroyed
+ * (its usage stays counted in its group)
+ */
+void fair_share_client_closed(int client_num);
+
+/**
+ * Accounts scheduler time given to the client (a program slice)
+ */
+void fair_share_charge(int client_num, long long run_us);
+
+/**
+ * Accounts a completed task of the client
+ */
+void fair_share_completed(int client_num);
+
+/**
+ * Copies the usage of every group that has or had members
+ *
+ * @param out - receives at most capacity entries
+ * @return number of entries written
+ */
+int fair_share_groups(FairShareUsage* out, int capacity);
+
+/**
+ * Copies the usage of the connected clients that received the most scheduler time
+ *
+ * @param out - receives at most capacity entries, most served first
+ * @param clients - set to the number of client accounts
+ * @return number of entries written
+ */
+int fair_share_top_clients(FairShareUsage* out, int capacity, int* clients);
+
+/**
+ * Scheduler time accounted to all clients since the server started
+ */
+long long fair_share_total_run_us();
+
+#endif //FAIRSHARE_H
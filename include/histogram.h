@@ -0,0 +1,46 @@
+//include/histogram.h - Lock-free log-linear (HDR-style) histograms
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdatomic.h>
+
+#define HISTOGRAM_SUB_BITS 4                                   //16 buckets per power of two: <= 6.25% error
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_MAGNITUDE 40                             //values up to 2^41 - 1 (25 days in microseconds)
+#define HISTOGRAM_BUCKETS (HISTOGRAM_SUB_BUCKETS * (HISTOGRAM_MAX_MAGNITUDE - HISTOGRAM_SUB_BITS + 2))
+
+/**
+ * HDR-style histogram of non-negative integers
+ * Values below HISTOGRAM_SUB_BUCKETS get a bucket each; above that every power of
+ * two is split into HISTOGRAM_SUB_BUCKETS equal buckets, so any value is known to
+ * within 1/16 of itself. Recording is a handful of relaxed atomic adds
+ */
+typedef struct {
+    atomic_ullong buckets[HISTOGRAM_BUCKETS];
+    atomic_ullong count;
+    atomic_ullong sum;
+    atomic_ullong max;
+} Histogram;
+
+
+/**
+ * Adds one value (negative values count as 0)
+ */
+void histogram_record(Histogram* histogram, long long value);
+
+/**
+ * Smallest recorded bucket bound below which a fraction q of the values lie
+ *
+ * @param q - quantile in [0, 1]
+ * @return the value (upper bound of its bucket, capped at the maximum seen), 0 if empty
+ */
+long long histogram_quantile(Histogram* histogram, double q);
+
+/**
+ * Number of values recorded at or below bound (a Prometheus "le" bucket)
+ * The bucket holding bound counts as below it, so every value at or below bound is
+ * included, plus those sharing its bucket: at most 1/16 above the bound
+ */
+unsigned long long histogram_count_below(Histogram* histogram, long long bound);
+
+#endif //HISTOGRAM_H
@@ -0,0 +1,141 @@
+//include/logger.h - Asynchronous server log: per-thread lock-free rings drained by one writer thread
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_RING_RECORDS 1024        //records in a thread's first ring (power of two)
+#define LOG_RING_MAX_RECORDS 65536   //a full ring is replaced by one twice the size up to this; then records are dropped
+#define LOG_INLINE_TEXT 88           //text bytes kept inside a record; longer text is copied to the heap
+#define LOG_BATCH_RECORDS 4096       //records the writer takes per pass
+#define LOG_IDLE_SLEEP_MIN_US 1000   //writer's sleep between passes while records keep coming
+#define LOG_IDLE_SLEEP_MAX_US 16000  //writer's sleep doubles up to this while nothing is logged
+
+/**
+ * Levels in increasing severity; records below the configured level cost one load
+ */
+typedef enum {
+    LOG_LEVEL_DEBUG,    //per-quantum task transitions (running, waiting)
+    LOG_LEVEL_INFO,     //connections, commands, task lifetimes, bytes sent, schedules
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+} LogLevel;
+
+/**
+ * Output formats
+ * TEXT    the server's console format, ANSI colors included
+ * JSON    one object per line, no colors
+ * BINARY  LogBinaryRecord headers, each followed by its text bytes
+ */
+typedef enum {
+    LOG_FORMAT_TEXT,
+    LOG_FORMAT_JSON,
+    LOG_FORMAT_BINARY
+} LogFormat;
+
+/**
+ * Color of a MESSAGE record's tag in the TEXT format; the record carries the enum and
+ * the writer owns the escape codes
+ */
+typedef enum {
+    LOG_COLOR_NONE,
+    LOG_COLOR_BLUE,
+    LOG_COLOR_YELLOW,
+    LOG_COLOR_MAGENTA,
+    LOG_COLOR_GREEN,
+    LOG_COLOR_RED,
+    LOG_COLOR_COUNT
+} LogColor;
+
+/**
+ * What a record describes; decides how its fields are printed
+ */
+typedef enum {
+    LOG_EVENT_MESSAGE = 1,      //text = tag '\0' message, value = LogColor of the tag
+    LOG_EVENT_CONNECTED = 2,    //client connected
+    LOG_EVENT_COMMAND = 3,      //text = command received
+    LOG_EVENT_BYTES_SENT = 4,   //value = bytes sent
+    LOG_EVENT_TASK_STATE = 5,   //text = state, value = remaining burst in us or -1 for shell commands
+    LOG_EVENT_SCHEDULE = 6      //text = completion order "P1-(3.000)-P2-(5.000)"
+} LogEvent;
+
+/**
+ * BINARY format record header (native byte order), followed by length - sizeof(LogBinaryRecord)
+ * bytes of text
+ */
+typedef struct {
+    uint32_t length;        //header plus text bytes
+    uint8_t level;          //LogLevel
+    uint8_t event;          //LogEvent
+    uint16_t reserved;
+    int32_t client_num;
+    int32_t task_id;        //0 when the record is not about a task
+    int64_t time_us;        //wall clock, microseconds since the epoch
+    int64_t value;          //event-specific number (the LogColor of a MESSAGE)
+} LogBinaryRecord;
+
+
+/**
+ * Starts the writer thread
+ * Records logged before the start wait in their rings and are written by the first pass
+ *
+ * @param level - records below this level are discarded at the call site
+ * @param format - output format
+ * @param fd - descriptor the writer writes to
+ * @return 0 on success, -1 if the thread can't be created
+ */
+int logger_start(LogLevel level, LogFormat format, int fd);
+
+/**
+ * Writes everything logged so far and stops the writer thread
+ */
+void logger_stop();
+
+/**
+ * Writes everything logged so far before returning (runs a writer pass on the calling thread)
+ */
+void logger_flush();
+
+/**
+ * Records one event; never blocks and makes no system call other than allocating
+ * the thread's ring (on its first record, and larger ones when a burst fills it).
+ * Safe from any thread
+ *
+ * @param level - record's level
+ * @param event - what happened
+ * @param client_num - client the event belongs to, 0 if none
+ * @param task_id - task the event belongs to, 0 if none
+ * @param value - event-specific number
+ * @param text - event-specific text, may be NULL
+ * @param text_length - bytes of text
+ */
+void log_event(LogLevel level, LogEvent event, int client_num, int task_id, long long value,
+               const char* text, size_t text_length);
+
+/**
+ * @return 1 if records of this level are written, 0 if they are discarded
+ */
+int log_enabled(LogLevel level);
+
+/**
+ * Records lost to full rings since the start (also reported in the log itself)
+ */
+unsigned long long logger_dropped();
+
+/**
+ * Parses "debug", "info", "warn", "error" or "off"
+ *
+ * @return 0 on success, -1 for an unknown name
+ */
+int log_level_parse(const char* name, LogLevel* level);
+
+/**
+ * Parses "text", "json" or "binary"
+ *
+ * @return 0 on success, -1 for an unknown name
+ */
+int log_format_parse(const char* name, LogFormat* format);
+
+#endif //LOGGER_H
@@ -0,0 +1,56 @@
+//include/metrics.h - Scheduler metrics: lock-free counters and log-linear latency histograms
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+#include "histogram.h"
+
+#define METRICS_TYPES 2                                        //per-type metrics are indexed by TaskType
+#define METRICS_REQUEST_MAX 4096                               //bytes of an HTTP request read by the endpoint
+
+/**
+ * Everything the scheduler measures; times are in microseconds
+ */
+typedef struct {
+    Histogram queue_wait_us[METRICS_TYPES];    //runnable to dispatched, once per dispatch
+    Histogram response_us[METRICS_TYPES];      //created to first dispatched
+    Histogram turnaround_us[METRICS_TYPES];    //created to completed
+    Histogram quantum_use_percent;             //share of its quantum a program slice used
+    Histogram queue_depth;                     //tasks left in the worker's run queue at each program dispatch
+    atomic_ullong submitted[METRICS_TYPES];    //tasks accepted by the shell pool or a run queue
+    atomic_ullong completed[METRICS_TYPES];
+    atomic_ullong rejected;                    //tasks refused because a queue was full
+    atomic_ullong slices;                      //program quanta started
+    atomic_ullong preemptions;                 //program slices that ended before the program did
+    atomic_ullong deadlines_met;               //tasks with a deadline that completed by it
+    atomic_ullong deadlines_missed;            //tasks with a deadline that completed after it
+} SchedulerMetrics;
+
+typedef enum {
+    METRICS_SUMMARY,       //human-readable table with quantiles, answered to the stats command
+    METRICS_PROMETHEUS     //Prometheus text exposition format
+} MetricsFormat;
+
+extern SchedulerMetrics scheduler_metrics;
+
+
+/**
+ * Renders the metrics, the scheduler's queue depths and the command cache and
+ * log counters
+ *
+ * @param format - summary table or Prometheus text
+ * @param length - receives the text's length
+ * @return malloc'd text (caller frees), NULL if out of memory
+ */
+char* metrics_render(MetricsFormat format, size_t* length);
+
+/**
+ * Starts a thread serving the Prometheus text on http://127.0.0.1:port/metrics
+ *
+ * @param port - TCP port on the loopback interface
+ * @return 0 on success, -1 if the port can't be bound or the thread can't start
+ */
+int start_metrics_endpoint(int port);
+
+#endif //METRICS_H
@@ -0,0 +1,67 @@
+//include/mpscring.h - Bounded lock-free multi-producer / single-consumer ring of pointers
+#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define MPSC_CACHE_LINE 64    //producers' and consumer's cursors live on separate lines
+
+/**
+ * One slot: its sequence number says whose turn it is
+ * sequence == position        free for the producer claiming that position
+ * sequence == position + 1    holds an item for the consumer
+ */
+typedef struct {
+    atomic_size_t sequence;
+    void* item;
+} MpscSlot;
+
+/**
+ * Any number of threads push, exactly one thread pops
+ * Producers claim a position with one compare-and-swap on tail and never wait for
+ * each other or for the consumer; a full ring makes mpsc_ring_push fail instead
+ */
+typedef struct {
+    MpscSlot* slots;                                    //capacity slots
+    size_t mask;                                        //capacity - 1 (capacity is a power of two)
+    _Alignas(MPSC_CACHE_LINE) atomic_size_t tail;       //next position producers claim
+    _Alignas(MPSC_CACHE_LINE) atomic_size_t head;       //next position the consumer reads
+} MpscRing;
+
+
+/**
+ * Allocates an empty ring
+ *
+ * @param ring - the ring to initialize
+ * @param capacity - slots, rounded up to a power of two
+ * @return 0 on success, -1 if out of memory
+ */
+int mpsc_ring_init(MpscRing* ring, size_t capacity);
+
+/**
+ * Frees the slots; items still in the ring are not touched
+ */
+void mpsc_ring_destroy(MpscRing* ring);
+
+/**
+ * Publishes an item; safe from any number of threads at once
+ *
+ * @return 0 on success, -1 if the ring is full
+ */
+int mpsc_ring_push(MpscRing* ring, void* item);
+
+/**
+ * Takes up to max items in publication order; consumer thread only
+ * Stops early at a position a producer has claimed but not yet filled
+ *
+ * @return number of items stored in items
+ */
+size_t mpsc_ring_drain(MpscRing* ring, void** items, size_t max);
+
+/**
+ * Items published and not yet drained (a snapshot; may be stale by the time it is used)
+ */
+size_t mpsc_ring_size(MpscRing* ring);
+
+#endif //MPSCRING_H
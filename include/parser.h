@@ -17,6 +17,28 @@ typedef struct {
 CommandList *parse_input(char *line); //primary parsing function that transforms user input into a machine-readable format.
 void free_command_list(CommandList *cmdlist);  //implements a complete memory deallocation strategy for CommandList structures
 
+#include <stddef.h>
+
+#define PARSE_ARENA_STACK 8192 //arena bytes callers keep on the stack; bigger lines get one heap block of parse_arena_bytes
+
+//bump allocator holding a whole parsed CommandList in one contiguous buffer
+typedef struct {
+    char *base;     //caller's buffer
+    size_t size;    //bytes in the buffer
+    size_t used;    //bytes handed out so far
+} ParseArena;
+
+void parse_arena_init(ParseArena *arena, void *buffer, size_t size); //use buffer as an empty arena (the caller owns it)
+void parse_arena_reset(ParseArena *arena); //drop everything parsed into the arena in O(1)
+size_t parse_arena_bytes(const char *line); //arena bytes that are always enough to parse line
+
+//zero-allocation parse_input: the CommandList, its commands, argv arrays and an unescaped
+//copy of the line (tokens point into it) all live in the arena; line is not modified.
+//same syntax as parse_input, but nothing is printed: NULL with errno EINVAL on a syntax error
+//(the server hands such lines to sh, which reports it to the client) or ENOMEM when the arena
+//is too small. Release with parse_arena_reset, never free_command_list
+CommandList *parse_input_arena(ParseArena *arena, const char *line);
+
 //Add this declaration for builtin echo
 void builtin_echo(char **argv);
 
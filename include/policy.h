@@ -0,0 +1,123 @@
+//include/policy.h - Scheduling policies shared by the scheduler workers and the simulator
+#ifndef POLICY_H
+#define POLICY_H
+
+#include <stddef.h>
+#include <limits.h>
+#include "scheduler.h"
+
+#define CFS_MIN_SLICE_US (100 * 1000LL)      //cfs: shortest slice however many tasks share the period
+#define CFS_WAKEUP_GRANULARITY_US (500 * 1000LL) //cfs: vruntime lead a queued task needs to preempt
+#define MLFQ_LEVELS 4                        //mlfq: priority levels, 0 = top
+#define MLFQ_LEVEL_DELAY_US (10 * USEC_PER_SEC) //mlfq: how long newer work one level up can pass a task
+#define EDF_NO_DEADLINE LLONG_MAX            //edf: queue key of a task without a deadline
+
+/**
+ * A scheduling policy: every decision a worker makes about its run queue
+ * The hooks only look at the tasks they are given (and the quantum settings), never
+ * at a clock, processes or sockets, so the same policy drives the scheduler workers
+ * on the monotonic clock and the simulator on a virtual one
+ */
+typedef struct SchedPolicy {
+    const char* name;                   //selected with --policy
+    const char* description;            //one line for usage texts
+
+    /**
+     * Run queue key of a task being queued: smaller keys run first, equal keys in
+     * arrival order. Read once per push, so it may depend on anything the task
+     * carried when it was queued; the first time a task is queued the policy may
+     * set up its own state in it (cfs places it at the queue's virtual time)
+     */
+    long long (*queue_key)(WaitingQueue* queue, Task* task);
+
+    /**
+     * Length of the slice the task is about to get
+     *
+     * @param queue - the run queue it was taken from (read without its lock)
+     */
+    long long (*quantum_us)(const WaitingQueue* queue, const Task* task);
+
+    /**
+     * Decides whether the best queued task takes the core from the running one
+     * Asked when a task arrives during a slice (running's run time is up to date)
+     *
+     * @param best - the head of the run queue
+     * @param running - the task whose slice is in progress
+     * @return 1 to end the running slice now
+     */
+    int (*preempts)(const Task* best, const Task* running);
+
+    /**
+     * Optional: a task was taken out of the queue to run
+     */
+    void (*on_select)(WaitingQueue* queue, const Task* task);
+
+    /**
+     * Optional: a slice of slice_us ended (run time and round are already charged)
+     * Called without any run queue lock held
+     */
+    void (*on_slice_end)(Task* task, long long slice_us);
+
+    int rotate;                         //1: a task is not selected twice in a row while another is queued
+} SchedPolicy;
+
+
+extern const SchedPolicy policy_rr_sjrf;
+extern const SchedPolicy policy_cfs;
+extern const SchedPolicy policy_mlfq;
+extern const SchedPolicy policy_edf;
+extern const SchedPolicy policy_fair;
+extern const SchedPolicy* const scheduling_policies[];   //every policy, NULL-terminated
+extern const SchedPolicy* scheduler_policy;              //the policy the run queues use
+
+
+/**
+ * Looks a policy up by name
+ *
+ * @return the policy, or NULL if there is none of that name
+ */
+const SchedPolicy* policy_find(const char* name);
+
+/**
+ * Removes the task a policy runs next from a run queue
+ * Caller must hold queue->mutex (the simulator has no concurrency)
+ *
+ * @param policy - the queue's policy
+ * @param queue - the run queue
+ * @return the task, or NULL if the queue is empty
+ */
+Task* policy_select(const SchedPolicy* policy, WaitingQueue* queue);
+
+/**
+ * Decides whether a queued task takes the core from a running program
+ *
+ * @return 1 to end the running slice now
+ */
+int policy_preempts(const SchedPolicy* policy, const Task* best, const Task* running);
+
+/**
+ * Ends a slice: counts the round and lets the policy update its state (cfs vruntime,
+ * mlfq demotion). Call after task_account_run_time has charged the slice
+ *
+ * @param slice_us - how long the slice lasted
+ */
+void policy_slice_end(const SchedPolicy* policy, Task* task, long long slice_us);
+
+/**
+ * Charges the time a program has run so far against its burst estimate
+ * A program still running past its estimate keeps a remaining time of 0
+ *
+ * @param task - the program
+ * @param run_time_us - total time it has been allowed to run, including the current slice
+ */
+void task_account_run_time(Task* task, long long run_time_us);
+
+/**
+ * Formats one schedule summary entry as "P<id>-(<seconds>.<ms>)", preceded by "-"
+ * unless it is the first, the way the server logs its schedule
+ *
+ * @return characters written (as snprintf)
+ */
+int schedule_entry_format(char* out, size_t capacity, const ScheduleEntry* entry, int first);
+
+#endif //POLICY_H
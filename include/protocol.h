@@ -0,0 +1,125 @@
+//include/protocol.h - Length-prefixed framing between client and server
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Wire format
+ * A framed client opens the connection with an 8 byte hello: PROTOCOL_MAGIC followed
+ * by PROTOCOL_VERSION (u32, network order). The magic starts with a NUL byte, which a
+ * text command never does, so the server can still serve legacy clients that send raw
+ * command text (one recv() = one command, output sent back unframed)
+ *
+ * Every message after the hello is a frame:
+ *   u32 length | u32 request_id | u8 type | 3 bytes zero | length bytes of payload
+ * (integers in network order). The client picks request ids; every response frame
+ * carries the id of the command it belongs to, so many commands can be in flight
+ * on one connection. Each command is answered by any number of OUTPUT/ERROR frames
+ * followed by exactly one END frame
+ *
+ * A BATCH frame carries many commands, one per line: line i is answered exactly like
+ * a COMMAND frame with request id request_id + i, so a script goes out in one frame
+ * and its results come back tagged by line index. An empty batch is answered with
+ * an END for request_id, and one over BATCH_MAX_COMMANDS lines with an ERROR and END
+ * for request_id and nothing run
+ */
+#define PROTOCOL_MAGIC "\0MSF"         //first 4 bytes of the hello
+#define PROTOCOL_VERSION 1             //wire format version sent in the hello
+#define PROTOCOL_HELLO_SIZE 8          //magic + version
+#define FRAME_HEADER_SIZE 12           //bytes before each frame's payload
+#define FRAME_MAX_PAYLOAD (1 << 20)    //larger frames are a protocol error
+#define BATCH_MAX_COMMANDS 65536       //lines in one BATCH frame; a larger batch is refused
+
+typedef enum {
+    FRAME_COMMAND = 1,   //client -> server: command text (no trailing newline needed)
+    FRAME_OUTPUT = 2,    //server -> client: a chunk of the command's output
+    FRAME_END = 3,       //server -> client: the command finished, no more frames for this id
+    FRAME_ERROR = 4,     //server -> client: error message about the command
+    FRAME_BATCH = 5      //client -> server: newline-separated commands, ids request_id, request_id + 1, ...
+} FrameType;
+
+typedef struct {
+    uint32_t length;                   //payload bytes
+    uint32_t request_id;               //command this frame belongs to
+    uint8_t type;                      //FrameType
+} FrameHeader;
+
+typedef enum {
+    PROTOCOL_UNKNOWN,    //nothing received yet
+    PROTOCOL_LEGACY,     //raw command text, one recv() per command
+    PROTOCOL_FRAMED      //hello received, length-prefixed frames
+} ProtocolMode;
+
+/**
+ * Reassembles frames from a byte stream that may split or coalesce them
+ */
+typedef struct {
+    char* data;                        //buffered bytes
+    size_t used;                       //bytes in data
+    size_t consumed;                   //bytes of data already returned as frames
+    size_t capacity;                   //allocated size of data
+    ProtocolMode mode;                 //detected (server) or fixed (client) protocol
+} FrameDecoder;
+
+
+/**
+ * Writes a frame header in wire format
+ *
+ * @param out - FRAME_HEADER_SIZE bytes
+ * @param type - frame type
+ * @param request_id - command the frame belongs to
+ * @param length - payload length
+ */
+void frame_header_encode(unsigned char* out, FrameType type, uint32_t request_id, uint32_t length);
+
+/**
+ * Sends one complete frame (header and payload) on a blocking socket
+ * Retries partial sends; the caller serializes writers on the same socket
+ *
+ * @return 0 on success, -1 if the peer is gone or the send timed out
+ */
+int frame_write(int socket, FrameType type, uint32_t request_id, const void* payload, uint32_t length);
+
+/**
+ * Sends the hello that switches a connection to framed mode
+ *
+ * @return 0 on success, -1 on failure
+ */
+int protocol_send_hello(int socket);
+
+/**
+ * Initializes an empty decoder
+ *
+ * @param decoder - decoder to initialize
+ * @param mode - PROTOCOL_UNKNOWN to detect the client's protocol from its first
+ *               bytes (server), PROTOCOL_FRAMED to expect frames only (client)
+ */
+void frame_decoder_init(FrameDecoder* decoder, ProtocolMode mode);
+
+/**
+ * Frees the decoder's buffer
+ */
+void frame_decoder_free(FrameDecoder* decoder);
+
+/**
+ * Appends received bytes
+ * Invalidates payload pointers returned by earlier frame_decoder_next calls
+ *
+ * @return 0 on success, -1 if out of memory
+ */
+int frame_decoder_append(FrameDecoder* decoder, const char* data, size_t length);
+
+/**
+ * Returns the next complete frame
+ * In legacy mode everything buffered is returned as one FRAME_COMMAND with request id 0
+ *
+ * @param decoder - the decoder
+ * @param header - receives the frame header
+ * @param payload - receives a pointer to the payload, valid until the next append
+ * @return 1 if a frame was returned, 0 if more bytes are needed, -1 on a protocol error
+ */
+int frame_decoder_next(FrameDecoder* decoder, FrameHeader* header, const char** payload);
+
+#endif //PROTOCOL_H
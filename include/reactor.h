@@ -0,0 +1,36 @@
+// include/reactor.h - Edge-triggered epoll reactor for client connections
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "server.h"
+
+#define REACTOR_MAX_EVENTS 256        //epoll events fetched per epoll_wait call
+#define REACTOR_READS_PER_EVENT 16    //recv() calls per connection before yielding to others
+
+/**
+ * Starts the reactor I/O threads
+ * Each thread owns one epoll instance; connections are spread across them
+ * round-robin and stay on the same thread for their whole lifetime
+ *
+ * @param io_threads - number of I/O threads to start (1..MAX_IO_THREADS)
+ * @return 0 on success, -1 if an epoll instance or thread could not be created
+ */
+int start_reactor(int io_threads);
+
+/**
+ * Registers an accepted client socket with one of the reactor I/O threads
+ * The socket stays in blocking mode so the scheduler can send() to it as usual.
+ * The reactor only reads with MSG_DONTWAIT, and it queues its own replies in the
+ * connection's outbox (conn_defer_sends)
+ *
+ * @param client_info - heap-allocated connection info, freed by the reactor on success
+ * @return 0 on success, -1 on failure (caller still owns client_info and its socket)
+ */
+int reactor_add_client(ClientInfo* client_info);
+
+/**
+ * Stops the reactor I/O threads and closes all remaining connections
+ */
+void stop_reactor();
+
+#endif // REACTOR_H
@@ -0,0 +1,158 @@
+//include/runqueue.h - Indexed min-heap run queue used by each scheduler worker
+#ifndef RUNQUEUE_H
+#define RUNQUEUE_H
+
+#include <pthread.h>
+
+#define RUNQUEUE_INITIAL_CAPACITY 64    //heap slots allocated on first push, doubled as needed
+#define RUNQUEUE_CLIENT_BUCKETS 1024    //hash buckets of the per-client task index (power of two)
+
+struct Task;
+struct SchedPolicy;
+
+/**
+ * All tasks of one client that are queued in a run queue
+ * Tasks are linked through Task.client_prev/client_next in arrival order
+ */
+typedef struct ClientTaskList {
+    int client_num;                     //client owning the tasks
+    int count;                          //number of queued tasks of this client
+    struct Task* head;                  //oldest queued task
+    struct Task* tail;                  //newest queued task
+    struct ClientTaskList* next;        //hash bucket chain
+} ClientTaskList;
+
+/**
+ * A client's fair-share finish tag in one run queue (fair policy): where the client's
+ * next slice starts in the queue's virtual time. Dropped once the queue's virtual time
+ * has passed it, since a tag behind the virtual time no longer changes anything
+ */
+typedef struct ShareTag {
+    int client_num;
+    long long finish_us;                //end of the client's last tagged slice
+    struct ShareTag* next;              //hash bucket chain
+} ShareTag;
+
+/**
+ * One heap slot: the ordering keys are copied out of the task when it is queued, so
+ * sifting and selection compare inside the heap array without dereferencing tasks
+ * (a queued task's burst does not change until it is taken out again)
+ */
+typedef struct {
+    long long key;                      //the policy's queue key; smaller runs first
+    unsigned long seq;                  //arrival order (FCFS tie-break)
+    int task_id;                        //checked when skipping the last selected task
+    struct Task* task;                  //the queued task
+} RunQueueSlot;
+
+/**
+ * Run queue ordered as a binary min-heap on (policy key, arrival order); under the
+ * default rr-sjrf policy that is shortest remaining burst first. Only programs are
+ * queued; shell commands go to the shell executor pool (shellpool.h).
+ * Each queued task records its heap slot in Task.heap_index so it can be removed
+ * in O(log n), and a per-client index gives O(1) access to a client's queued tasks
+ */
+typedef struct {
+    const struct SchedPolicy* policy; //computes the ordering key of each queued task
+    RunQueueSlot* heap;            //heap array with inlined ordering keys
+    int count;                     //current number of tasks in queue
+    int capacity;                  //allocated heap slots
+    int last_selected_id;          //ID of last selected task (to prevent consecutive selection)
+    unsigned long next_seq;        //arrival counter used as FCFS tie-break
+    long long min_vruntime_us;     //cfs, fair: virtual time of the queue, never decreases
+
+    ClientTaskList* clients[RUNQUEUE_CLIENT_BUCKETS]; //client_num -> queued tasks of that client
+    ShareTag* share_tags[RUNQUEUE_CLIENT_BUCKETS];    //fair: client_num -> finish tag in this queue
+
+    pthread_mutex_t mutex;         //mutex for thread-safe access
+    pthread_cond_t task_complete;  //condition variable: signaled when a task completes
+} WaitingQueue;
+
+
+/**
+ * Initializes an empty run queue and its synchronization primitives
+ *
+ * @param queue - the run queue to initialize
+ * @param policy - the policy whose queue_key orders the heap
+ */
+void runqueue_init(WaitingQueue* queue, const struct SchedPolicy* policy);
+
+/**
+ * Frees every queued task, the heap and the client index, and destroys the
+ * synchronization primitives
+ *
+ * @param queue - the run queue to destroy
+ */
+void runqueue_destroy(WaitingQueue* queue);
+
+/**
+ * Inserts a task, stamping it with the next arrival number
+ * Caller must hold queue->mutex. O(log n)
+ *
+ * @param queue - the run queue
+ * @param task - task to insert (must not be queued anywhere else)
+ * @return 0 on success, -1 if the queue is at MAX_TASKS or out of memory
+ */
+int runqueue_push(WaitingQueue* queue, struct Task* task);
+
+/**
+ * Returns the highest priority task without removing it
+ * Caller must hold queue->mutex. O(1)
+ *
+ * @param queue - the run queue
+ * @return the task at the top of the heap, or NULL if the queue is empty
+ */
+struct Task* runqueue_peek(WaitingQueue* queue);
+
+/**
+ * The client's finish tag in this queue, created at the queue's virtual time
+ * Tags in the same hash bucket that the virtual time has passed are freed on the way.
+ * Caller must hold queue->mutex
+ *
+ * @return the tag, or NULL if out of memory
+ */
+ShareTag* runqueue_share_tag(WaitingQueue* queue, int client_num);
+
+/**
+ * Removes and returns the highest priority task whose task_id differs from skip_id
+ * Falls back to the overall top task when every queued task has skip_id
+ * Caller must hold queue->mutex. O(k + log n) where k is the number of skip_id tasks
+ * ahead of the result; the heap is only walked, never drained and refilled
+ *
+ * @param queue - the run queue
+ * @param skip_id - task id to pass over, or -1 to take the top task
+ * @return the removed task, or NULL if the queue is empty
+ */
+struct Task* runqueue_pop_next(WaitingQueue* queue, int skip_id);
+
+/**
+ * Removes a specific queued task
+ * Caller must hold queue->mutex. O(log n)
+ *
+ * @param queue - the run queue holding the task
+ * @param task - the task to remove
+ */
+void runqueue_remove(WaitingQueue* queue, struct Task* task);
+
+/**
+ * Finds the oldest queued task with the given id
+ * Task ids are client numbers, so this is a lookup in the per-client index
+ * Caller must hold queue->mutex. O(1) expected
+ *
+ * @param queue - the run queue
+ * @param task_id - id to look for
+ * @return the task, or NULL if none is queued
+ */
+struct Task* runqueue_find_id(WaitingQueue* queue, int task_id);
+
+/**
+ * Removes and returns the oldest queued task of a client
+ * Caller must hold queue->mutex. O(log n)
+ *
+ * @param queue - the run queue
+ * @param client_num - client whose task should be removed
+ * @return the removed task, or NULL if the client has no queued task
+ */
+struct Task* runqueue_pop_client(WaitingQueue* queue, int client_num);
+
+#endif //RUNQUEUE_H
@@ -4,13 +4,28 @@
 
 #include <pthread.h>
 #include <sys/time.h>
-
-
-#define MAX_TASKS 100              //maximum number of tasks in the waiting queue
-#define FIRST_ROUND_QUANTUM 3      //quantum for first round (seconds)
-#define DEFAULT_QUANTUM 7          //quantum for subsequent rounds (seconds)
+#include <stdint.h>
+#include <sys/types.h>
+#include <stdatomic.h>
+#include "runqueue.h"
+#include "mpscring.h"
+#include "connection.h"
+
+
+#define MAX_TASKS 262144           //maximum number of tasks in one worker's run queue
+#define MAX_SCHEDULE_ENTRIES 1000  //maximum number of entries in the scheduling summary
+#define USEC_PER_SEC 1000000LL     //microseconds per second
+#define FIRST_ROUND_QUANTUM_US (3 * USEC_PER_SEC) //default quantum for first round (microseconds)
+#define DEFAULT_QUANTUM_US (7 * USEC_PER_SEC)     //default quantum for subsequent rounds (microseconds)
 #define SHELL_COMMAND_BURST -1     //special burst time for shell commands (immediate execution)
-#define DEFAULT_BURST_TIME 10      //default burst time for unknown programs
+#define DEFAULT_BURST_TIME 10      //default burst time for unknown programs (seconds)
+#define DEFAULT_SCHEDULER_WORKERS 1 //scheduler workers when --workers is not given
+#define MAX_SCHEDULER_WORKERS 256  //upper bound on scheduler workers
+#define STEAL_RETRY_MS 50          //idle workers re-check peers for work at least this often
+#define SUBMIT_RING_CAPACITY 4096  //submitted tasks a worker's inbox holds before submitters fall back to its queue lock
+#define SUBMIT_DRAIN_BATCH 64      //tasks moved from the inbox to the run queue per ring pass
+#define TASK_DEFAULT_WEIGHT 1024   //fair-share weight of a task; cfs vruntime advances at run time * default / weight
+#define DEADLINE_PREFIX "deadline" //"deadline <ms> <command>" submits a command with a deadline (used by edf)
 
 
 typedef enum {
@@ -23,90 +38,136 @@ typedef enum {
 
 typedef enum {
     TASK_TYPE_SHELL,   //shell command (ls, pwd, etc.) - runs to completion immediately
-    TASK_TYPE_PROGRAM  //program execution (demo N) - can be preempted
+    TASK_TYPE_PROGRAM  //program execution (demo N) - forked once, preempted with SIGSTOP/SIGCONT
 } TaskType;
 
-typedef struct {
+typedef struct Task {
+    //scheduling-hot fields first: the run queue, selection and stealing touch only these
     int task_id;                   //unique task identifier
     int client_num;                //client number that submitted this task
-    int client_socket;             //socket to send output back to client
-    char command[4096];            //the command string to execute
-    
     TaskType type;                 //shell command or program
     TaskState state;               //current state of the task
+    long long remaining_burst_us;  //remaining time to complete execution in microseconds
+    int round_number;              //which scheduling round the task is in
+    int heap_index;                //slot in the owning run queue's heap, -1 when not queued
+    unsigned long queue_seq;       //arrival order in the run queue (FCFS tie-break)
+    struct Task* client_prev;      //links in the run queue's per-client task list
+    struct Task* client_next;      //(client_next also links shell tasks waiting in the shell pool)
+    long long quantum_us;          //current quantum allocated to this task (microseconds)
+    long long total_burst_us;      //total time needed for execution in microseconds (N seconds for demo)
+    long long deadline_us;         //absolute deadline (monotonic microseconds), 0 when none was given
+    int weight;                    //cfs weight: the client's effective fair-share weight when the task was created
+    long long vruntime_base_us;    //cfs: vruntime minus the weighted run time, set when placed in vruntime_queue
+    const WaitingQueue* vruntime_queue; //cfs: the run queue whose virtual time the task was placed in, NULL until then
+    int level;                     //mlfq: priority level, 0 = top
+    long long level_run_us;        //mlfq: run time charged at the current level
+    long long share_tag_us;        //fair: the client's start tag the task was queued with
+    long long share_charge_us;     //fair: service that tag charged to the client
+    WaitingQueue* share_queue;     //fair: the run queue whose tag the task holds, NULL once its slice ended
     
-    int total_burst_time;          //total time needed for execution (N value for demo)
-    int remaining_burst_time;      //remaining time to complete execution
-    int current_iteration;         //current iteration (for demo program progress tracking)
+    //cold fields: only used while the task runs or reports
+    ClientConn* conn;              //connection to send output back to (one reference held)
+    uint32_t request_id;           //client's id for this command in framed mode, 0 for legacy clients
+    int command_class;             //size class of the command buffer (see taskpool.h)
+    char* command;                 //the command string to execute, in a pooled buffer
     
-    int round_number;              //which scheduling round the task is in
-    int quantum;                   //current quantum allocated to this task
+    long long arrival_us;          //when the task was created (monotonic microseconds)
+    long long ready_us;            //when the task last became runnable (created or preempted)
+    long long start_us;            //when the task first started running, 0 until then
+    long long end_us;              //when the task completed
     
-    struct timeval arrival_time;   //when the task was added to the queue
-    struct timeval start_time;     //when the task first started running
-    struct timeval end_time;       //when the task completed
+    long long output_bytes;        //bytes of output streamed to the client so far
     
-    char output_buffer[4096];      //buffer to accumulate output
-    int output_length;             //current length of output in buffer
+    pid_t pid;                     //program's process group leader, -1 until first dispatch or once reaped
+    int output_fd;                 //read end of the program's stdout/stderr pipe, -1 when closed
+    int exit_fd;                   //zygote status pipe, readable once the program has exited, -1 when none
+    long long run_time_us;         //time the program has been allowed to run so far
 } Task;
 
 
+/**
+ * One scheduler worker: a thread with its own run queue
+ * Each worker applies the scheduling policy (RR + SJRF by default) to its own queue; idle workers
+ * steal queued tasks from busy peers. Submitters never take the queue's lock:
+ * they publish into the worker's lock-free inbox, which only the worker drains
+ */
 typedef struct {
-    Task* tasks[MAX_TASKS];        //array of task pointers
-    int count;                     //current number of tasks in queue
-    int last_selected_id;          //ID of last selected task (to prevent consecutive selection)
-    
-    pthread_mutex_t mutex;         //mutex for thread-safe access
-    pthread_cond_t not_empty;      //condition variable: signaled when queue becomes non-empty
-    pthread_cond_t task_complete;  //condition variable: signaled when a task completes
-} WaitingQueue;
+    int worker_id;                 //index into scheduler_workers
+    WaitingQueue queue;            //this worker's run queue
+    MpscRing inbox;                //tasks submitted to this worker, moved into queue by the worker itself
+    atomic_int currently_running_task_id; //task being executed by this worker, -1 if none (read by peers)
+    int idle;                      //1 while the worker is waiting for work
+    int wake_fd;                   //eventfd written when a task is submitted to this worker or a peer has spare work
+    int timer_fd;                  //timerfd (CLOCK_MONOTONIC) armed for the running quantum's expiry
+} SchedulerWorker;
 
 
 typedef struct {
     int task_id;                   //task ID (Px)
-    int completion_time;           //time at which task completed (relative to start)
+    long long completion_us;       //time at which task completed (microseconds relative to start)
 } ScheduleEntry;
 
 typedef struct {
-    ScheduleEntry entries[MAX_TASKS * 10];  //scheduling order log
+    ScheduleEntry entries[MAX_SCHEDULE_ENTRIES]; //scheduling order log
     int count;                              //number of entries
-    struct timeval start_time;              //scheduler start time for relative calculations
+    long long start_us;                     //scheduler start time (monotonic microseconds)
 } ScheduleSummary;
 
 
-extern WaitingQueue waiting_queue;
+extern SchedulerWorker* scheduler_workers;
+extern int scheduler_worker_count;
 extern ScheduleSummary schedule_summary;
 extern pthread_mutex_t scheduler_mutex;
 extern pthread_cond_t scheduler_cond;
 extern int scheduler_running;
-extern int currently_running_task_id;
+extern long long first_round_quantum_us;
+extern long long default_quantum_us;
 
 
 /**
- * Initializes the waiting queue and all associated synchronization primitives
+ * Initializes one run queue per scheduler worker and all associated synchronization primitives
  * Must be called before any other scheduler functions
+ *
+ * @param worker_count - number of scheduler workers (1..MAX_SCHEDULER_WORKERS)
  */
-void init_waiting_queue();
+void init_waiting_queue(int worker_count);
 
 /**
- * Cleans up the waiting queue and frees all resources
+ * Cleans up all run queues and frees all resources
  */
 void destroy_waiting_queue();
 
 /**
  * Creates a new task from a command string
- * Determines task type (shell vs program) and extracts burst time
+ * Determines task type (shell vs program) and extracts burst time. A leading
+ * "deadline <ms> " is stripped from the command and sets the task's deadline
+ * The Task comes from the slab pool and the command is copied into a buffer sized
+ * for it
  * 
  * @param command - the command string to create a task for
- * @param client_num - the client number submitting this command
- * @param client_socket - socket to send output back to client
+ * @param conn - the client submitting this command (the task takes a reference)
+ * @param request_id - the client's id for this command (0 for legacy clients)
  * @return pointer to newly created Task, or NULL on failure
  */
-Task* create_task(const char* command, int client_num, int client_socket);
+Task* create_task(const char* command, ClientConn* conn, uint32_t request_id);
 
 /**
- * Adds a task to the waiting queue
- * Thread-safe operation that signals the scheduler when queue becomes non-empty
+ * Frees a task
+ * A program that was started is killed (whole process group) and reaped by the zygote first,
+ * and the task's connection reference is dropped; the Task and its command buffer
+ * go back to their pools
+ * 
+ * @param task - the task to free, may be NULL
+ */
+void destroy_task(Task* task);
+
+/**
+ * Adds a program to the least loaded worker's run queue
+ * Shell commands go to shell_pool_submit instead; the workers only run programs
+ * Lock-free: the task is published in the worker's inbox and the worker is woken
+ * through its eventfd; it moves inbox tasks into its run queue in batches before
+ * selecting or checking for preemption. Falls back to the queue lock only when
+ * the inbox is full
  * 
  * @param task - pointer to the task to add
  * @return 0 on success, -1 if queue is full
@@ -114,8 +175,21 @@ Task* create_task(const char* command, int client_num, int client_socket);
 int add_task_to_queue(Task* task);
 
 /**
- * Removes a specific task from the waiting queue
+ * Adds many tasks at once, spread over the least loaded workers
+ * Same lock-free path as add_task_to_queue, but the system's task count is updated
+ * once and each worker that received tasks is woken once
+ *
+ * @param tasks - tasks to add; on return tasks[0 .. count - queued) hold the ones that
+ *                could not be queued (still owned by the caller)
+ * @param count - number of tasks
+ * @return number of tasks queued
+ */
+int add_tasks_to_queue(Task** tasks, int count);
+
+/**
+ * Removes a specific task from whichever run queue holds it
  * Used when a task completes or client disconnects
+ * O(log n) per queue via the run queue's client index
  * 
  * @param task_id - ID of the task to remove
  * @return pointer to removed task, or NULL if not found
@@ -123,60 +197,100 @@ int add_task_to_queue(Task* task);
 Task* remove_task_from_queue(int task_id);
 
 /**
- * Removes all tasks belonging to a specific client
+ * Removes all tasks belonging to a specific client from every run queue
+ * and from the shell executor pool, and closes its fair-share account
  * Called when a client disconnects
+ * O(k log n) for k queued tasks of the client
  * 
  * @param client_num - client number whose tasks should be removed
  */
 void remove_client_tasks(int client_num);
 
 /**
- * Selects the next task to execute using the combined RR + SJRF algorithm
- * Selection criteria:
- * 1. Shell commands (burst_time == -1) have highest priority
- * 2. Among programs, select shortest remaining job first
- * 3. If remaining times are equal, use FCFS (first in queue)
- * 4. Same task cannot be selected twice in a row unless it's the only task
+ * Selects the next task to execute using the queue's scheduling policy (policy.h)
+ * Under the default RR + SJRF policy the selection criteria are:
+ * 1. Select shortest remaining job first
+ * 2. If remaining times are equal, use FCFS (first in queue)
+ * 3. Same task cannot be selected twice in a row unless it's the only task
+ * The run queue is a heap on the policy's key, so selection is O(log n)
+ * Caller must hold queue->mutex
  * 
+ * @param queue - the run queue to select from
  * @return pointer to selected task, or NULL if queue is empty
  */
-Task* select_next_task();
+Task* select_next_task(WaitingQueue* queue);
+
+/**
+ * Takes one queued task from a busy peer's run queue for an idle worker
+ * Picks the task at the top of the victim's heap (its policy's best) without
+ * touching the victim's consecutive-selection state
+ * 
+ * @param thief - the idle worker looking for work
+ * @return pointer to the stolen task, or NULL if no peer had spare work
+ */
+Task* steal_task(SchedulerWorker* thief);
 
 /**
- * Executes a task for one quantum or until completion
- * For shell commands: executes to completion in one round
- * For programs: executes for quantum seconds, then returns to queue if not done
+ * Executes a program for one quantum or until completion
+ * Forks the program on first dispatch (SIGCONT on later ones), streams its output
+ * to the client and SIGSTOPs it when the quantum timer fires or, as soon as it
+ * arrives, a shorter job is waiting; returns it to the queue if not done
+ * Only programs reach the workers; shell commands run on the shell pool (run_shell_task)
  * 
+ * @param worker - the worker running the task (its queue is checked for preemption)
  * @param task - pointer to the task to execute
  * @return 1 if task completed, 0 if task needs more time
  */
-int execute_task(Task* task);
+int execute_task(SchedulerWorker* worker, Task* task);
 
 /**
- * Main scheduler thread function
- * Continuously selects and executes tasks from the waiting queue
+ * Runs a shell command to completion outside the program scheduler
+ * Called by the shell executor pool; logs the task's transitions and streams its
+ * output to the client. The caller frees the task afterwards
+ * 
+ * @param task - a TASK_TYPE_SHELL task that is not in any queue
+ */
+void run_shell_task(Task* task);
+
+/**
+ * Scheduler worker thread function
+ * Continuously selects and executes tasks from the worker's own run queue,
+ * stealing from peers when it runs dry
  * Implements the combined RR + SJRF scheduling algorithm
  * 
- * @param arg - unused
+ * @param arg - pointer to this thread's SchedulerWorker
  * @return NULL
  */
 void* scheduler_thread(void* arg);
 
 /**
- * Starts the scheduler thread
- * Creates a detached thread running the scheduler loop
+ * Starts the scheduler worker threads
+ * Creates one detached thread per worker set up by init_waiting_queue
  */
 void start_scheduler();
 
 /**
- * Stops the scheduler thread
- * Sets running flag to 0 and signals condition variable
+ * Stops the scheduler worker threads
+ * Sets running flag to 0 and signals every worker's condition variable
  */
 void stop_scheduler();
 
+/**
+ * Tasks queued or running on any scheduler worker (a snapshot)
+ */
+int scheduler_tasks_in_system();
+
+/**
+ * Tasks waiting in one worker's run queue and inbox (a snapshot)
+ *
+ * @param worker - index into scheduler_workers
+ */
+int scheduler_worker_depth(int worker);
+
 /**
  * Logs a task state change with formatted output
- * Uses the logging format specified in project requirements
+ * Uses the logging format specified in project requirements; "running" and "waiting"
+ * happen every quantum and are debug records, the others info records
  * 
  * @param task - the task that changed state
  * @param state_msg - message describing the state (created, started, waiting, running, ended)
@@ -193,7 +307,7 @@ void add_schedule_entry(int task_id);
 
 /**
  * Prints the scheduling summary showing execution order
- * Format: P5-(3)-P7-(6)-P6-(13)-P7-(20)-P6-(22)-P7-(24)
+ * Format: P5-(3.000)-P7-(6.004)-P6-(13.010)-P7-(20.013) (seconds, millisecond resolution)
  */
 void print_schedule_summary();
 
@@ -201,6 +315,7 @@ void print_schedule_summary();
  * Determines if a command is a shell command or a program
  * Shell commands: ls, pwd, cd, echo, cat, mkdir, rm, etc.
  * Programs: ./demo, ./program, or any command with burst time argument
+ * Backed by the command table (classify.h), which --command-table can extend
  * 
  * @param command - the command string to check
  * @return TASK_TYPE_SHELL or TASK_TYPE_PROGRAM
@@ -212,16 +327,23 @@ TaskType get_task_type(const char* command);
  * Example: "./demo 12" returns 12
  * 
  * @param command - the command string
- * @return burst time value, or DEFAULT_BURST_TIME if not found
+ * @return burst time value in seconds, or DEFAULT_BURST_TIME if not found
  */
 int extract_burst_time(const char* command);
 
 /**
- * Gets current time in seconds since scheduler started
+ * Reads the monotonic clock
+ * 
+ * @return CLOCK_MONOTONIC time in microseconds
+ */
+long long monotonic_us();
+
+/**
+ * Gets current time in microseconds since scheduler started
  * Used for scheduling summary timestamps
  * 
- * @return seconds elapsed since scheduler start
+ * @return microseconds elapsed since scheduler start
  */
-int get_elapsed_seconds();
+long long get_elapsed_us();
 
 #endif //SCHEDULER_H
\ No newline at end of file
@@ -11,6 +11,8 @@
 // #define PORT 8080              // port number the server listens on
 // #define BUFFER_SIZE 4096       // maximum size for command and output buffers
 // #define MAX_PENDING 5          // maximum number of pending connections in listen queue
+#define DEFAULT_IO_THREADS 4   // epoll reactor I/O threads when --io-threads is not given
+#define MAX_IO_THREADS 64      // upper bound on epoll reactor I/O threads
 
 // // ANSI color codes for formatted server output logging
 // #define COLOR_INFO "\033[1;34m"      // blue for INFO messages
@@ -80,6 +82,8 @@
 
 #include <pthread.h>
 #include <netinet/in.h>
+#include "connection.h"
+#include "logger.h"
 
 // ============================================================================
 // SERVER CONFIGURATION CONSTANTS
@@ -88,6 +92,9 @@
 #define PORT 8080              // port number the server listens on
 #define BUFFER_SIZE 4096       // maximum size for command and output buffers
 #define MAX_PENDING 5          // maximum number of pending connections in listen queue
+#define CLIENT_SEND_TIMEOUT_SEC 10 // a send blocked this long on a client that stopped reading fails
+#define DEFAULT_IO_THREADS 4   // epoll reactor I/O threads when --io-threads is not given
+#define MAX_IO_THREADS 64      // upper bound on epoll reactor I/O threads
 
 // ============================================================================
 // ANSI COLOR CODES FOR LOGGING
@@ -104,6 +111,35 @@
 // DATA STRUCTURES
 // ============================================================================
 
+/**
+ * Connection handling model selected at startup
+ * THREADED spawns one detached thread per client (blocking recv)
+ * EPOLL multiplexes all clients on a small fixed set of I/O threads
+ */
+typedef enum {
+    SERVER_MODE_THREADED,
+    SERVER_MODE_EPOLL
+} ServerMode;
+
+/**
+ * Startup configuration parsed from the server command line
+ */
+typedef struct {
+    ServerMode mode;                  // connection handling model
+    int io_threads;                   // number of reactor I/O threads (EPOLL mode only)
+    int scheduler_workers;            // number of scheduler workers, each with its own run queue
+    int shell_workers;                // number of shell executor threads
+    const char* policy;               // name of the run queues' scheduling policy (see policy.h)
+    long long first_quantum_us;       // program quantum for the first round (microseconds)
+    long long default_quantum_us;     // program quantum for later rounds (microseconds)
+    int command_cache_entries;        // parsed commands kept by the command cache, 0 = no caching
+    const char* command_table;        // file extending the shell/program command table, NULL for the built-in one
+    const char* burst_model;          // file the burst predictor is loaded from and saved to, NULL to keep it in memory
+    LogLevel log_level;               // least severe log records written
+    LogFormat log_format;             // console log format
+    int metrics_port;                 // loopback port of the Prometheus endpoint, 0 = off
+} ServerConfig;
+
 /**
  * Structure to hold client connection information
  * Passed to each thread to identify and manage the client
@@ -123,10 +159,50 @@ typedef struct {
 /**
  * Starts the server and listens for client connections
  * Creates a socket, binds it to the specified port, and enters an infinite loop
- * accepting client connections and spawning threads to handle them
+ * accepting client connections and handing them to a per-client thread or to
+ * the epoll reactor depending on config->mode
  * Also initializes and starts the scheduler
+ *
+ * @param config - startup configuration (mode, I/O thread count, scheduler workers, quanta)
+ */
+void start_server(const ServerConfig* config);
+
+/**
+ * Handles one command received from a client
+ * Strips the trailing newline, skips empty input, answers the builtins ("exit", "stats",
+ * "weight N") and otherwise passes the command to the scheduler. Shared by
+ * both connection models
+ *
+ * @param command_buffer - NUL-terminated command received from the client (modified in place)
+ * @param conn - the client that sent the command
+ * @param request_id - the client's id for the command (0 for legacy clients)
+ * @return 1 if the client asked to disconnect, 0 otherwise
  */
-void start_server();
+int handle_client_command(char* command_buffer, ClientConn* conn, uint32_t request_id);
+
+/**
+ * Handles a batch of newline-separated commands from one BATCH frame
+ * Line i is handled like handle_client_command with request id first_id + i; the
+ * tasks are created first and then queued with one bulk submission per kind
+ *
+ * @param payload - the frame's payload (not NUL-terminated, not modified)
+ * @param length - payload length in bytes
+ * @param conn - the client that sent the batch
+ * @param first_id - request id of the first line
+ * @return 1 if the client asked to disconnect, 0 otherwise
+ */
+int handle_client_batch(const char* payload, size_t length, ClientConn* conn, uint32_t first_id);
+
+/**
+ * Handles every complete command buffered in a connection's decoder
+ * Marks the connection framed once the client's hello has been seen, so replies
+ * are framed from the first command on. Shared by both connection models
+ *
+ * @param conn - the client
+ * @param decoder - the connection's decoder, fed with everything received so far
+ * @return 1 if the connection should be closed (exit or protocol error), 0 otherwise
+ */
+int dispatch_client_frames(ClientConn* conn, FrameDecoder* decoder);
 
 /**
  * Thread function that handles communication with a single connected client
@@ -140,25 +216,30 @@ void* handle_client_thread(void* arg);
 
 /**
  * Processes a command from a client by creating a task and adding it to scheduler
- * Shell commands are given high priority (burst_time = -1)
- * Program commands are scheduled using the RR + SJRF algorithm
+ * Shell commands are given high priority (burst = -1)
+ * Program commands are scheduled by the selected policy (RR + SJRF by default)
  * 
  * @param command - the command string to process
- * @param client_num - the client number submitting this command
- * @param client_socket - socket to send output back to client
+ * @param conn - the client submitting this command
+ * @param request_id - the client's id for the command (0 for legacy clients)
  */
-void process_command_with_scheduler(const char* command, int client_num, int client_socket);
+void process_command_with_scheduler(const char* command, ClientConn* conn, uint32_t request_id);
 
 /**
- * Prints formatted log messages to server console with color coding
- * Thread-safe implementation using mutex to prevent interleaved output
+ * Logs a message with a color-coded tag through the asynchronous logger
+ * ERROR and WARN tags log at those levels, anything else at info
  * 
- * @param color - ANSI color code for the message
+ * @param color - one of the COLOR_ codes below for the tag (others print uncolored)
  * @param tag - log level tag (e.g., "INFO", "ERROR")
  * @param message - the log message to display
  */
 void log_message(const char *color, const char *tag, const char *message);
 
+/**
+ * The log functions below only queue a record for the log writer thread (logger.h),
+ * which prints it in the configured format; none of them blocks
+ */
+
 /**
  * Logs client connection in Phase 4 format
  * Format: [client_num]<<< client connected
@@ -183,6 +264,6 @@ void log_command_received(int client_num, const char* command);
  * @param client_num - the client number
  * @param bytes - number of bytes sent
  */
-void log_bytes_sent(int client_num, int bytes);
+void log_bytes_sent(int client_num, long long bytes);
 
 #endif // SERVER_H
\ No newline at end of file
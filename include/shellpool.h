@@ -0,0 +1,64 @@
+//include/shellpool.h - Fast-path executor pool for shell commands
+#ifndef SHELLPOOL_H
+#define SHELLPOOL_H
+
+#include "scheduler.h"
+
+#define DEFAULT_SHELL_WORKERS 8        //shell executor threads when --shell-workers is not given
+#define MAX_SHELL_WORKERS 64           //upper bound on shell executor threads
+#define SHELL_CLIENT_CAPACITY 4096     //max shell commands of one client waiting for an executor
+#define SHELL_CLIENT_BUCKETS 256       //hash buckets of the clients with queued commands (power of two)
+
+/**
+ * Starts the shell executor threads
+ * Shell commands never wait behind programs: they bypass the run queues and run
+ * to completion on this pool, in parallel with the program scheduler. Each client
+ * has a FIFO of commands, and clients with commands waiting are on one shared ready
+ * list. An idle thread takes the oldest ready client and runs its next command,
+ * and the client stays off the list until that command finishes. So one client's
+ * commands run (and answer) in the order they were sent, and a slow command only
+ * holds up its own client
+ *
+ * @param worker_count - number of executor threads (1..MAX_SHELL_WORKERS)
+ * @return 0 on success, -1 if a thread could not be created
+ */
+int start_shell_pool(int worker_count);
+
+/**
+ * Queues a shell task behind its client's earlier commands
+ *
+ * @param task - a TASK_TYPE_SHELL task, owned by the pool on success
+ * @return 0 on success, -1 if the client has SHELL_CLIENT_CAPACITY commands waiting
+ *         or the pool is not running
+ */
+int shell_pool_submit(Task* task);
+
+/**
+ * Queues many shell tasks under a single lock
+ *
+ * @param tasks - TASK_TYPE_SHELL tasks in submission order; on return tasks[0 .. count - queued)
+ *                hold the ones that could not be queued (still owned by the caller)
+ * @param count - number of tasks
+ * @return number of tasks queued
+ */
+int shell_pool_submit_batch(Task** tasks, int count);
+
+/**
+ * Shell commands queued and not started yet (a snapshot)
+ */
+int shell_pool_pending();
+
+/**
+ * Drops every shell task of a client that has not started yet
+ * Called when a client disconnects
+ *
+ * @param client_num - client whose queued shell tasks should be freed
+ */
+void shell_pool_remove_client(int client_num);
+
+/**
+ * Stops the shell executor threads and frees any commands still queued
+ */
+void stop_shell_pool();
+
+#endif //SHELLPOOL_H
@@ -0,0 +1,52 @@
+//include/taskpool.h - Slab allocator for Task objects and size-classed command buffers
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <stddef.h>
+
+#define TASK_SLAB_TASKS 64              //Task objects carved from each slab
+#define COMMAND_MIN_CLASS_SHIFT 5       //smallest command buffer: 32 bytes
+#define COMMAND_CLASS_COUNT 8           //32, 64, ..., 4096 byte command buffers
+#define COMMAND_CHUNK_SIZE 16384        //bytes carved into buffers of one class at a time
+#define COMMAND_HEAP_CLASS COMMAND_CLASS_COUNT //longer commands get their own heap block
+
+struct Task;
+
+/**
+ * Takes a Task from the pool, growing it by a slab when every object is in use
+ * Objects are recycled through a free list and never returned to the system, so a
+ * steady stream of commands does no malloc/free per task. Thread-safe
+ *
+ * @return an uninitialized Task, or NULL if out of memory
+ */
+struct Task* task_alloc();
+
+/**
+ * Returns a Task to the pool
+ * Thread-safe
+ *
+ * @param task - object obtained from task_alloc, may be NULL
+ */
+void task_free(struct Task* task);
+
+/**
+ * Copies a command into a buffer of the smallest size class that holds it
+ * Commands too long for the largest class get an exactly sized heap block
+ * (COMMAND_HEAP_CLASS). Thread-safe
+ *
+ * @param command - the command text
+ * @param size_class - receives the buffer's class, needed to free it
+ * @return the copy, or NULL if out of memory
+ */
+char* command_dup(const char* command, int* size_class);
+
+/**
+ * Returns a command buffer to its size class
+ * Thread-safe
+ *
+ * @param buffer - buffer obtained from command_dup, may be NULL
+ * @param size_class - the class command_dup reported
+ */
+void command_free(char* buffer, int size_class);
+
+#endif //TASKPOOL_H
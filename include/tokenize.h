@@ -0,0 +1,28 @@
+// include/tokenize.h - Block scanning primitives for the command parser (scalar, SSE2, AVX2)
+#ifndef TOKENIZE_H
+#define TOKENIZE_H
+
+#include <stddef.h>
+
+typedef enum {
+    TOKENIZER_AUTO,    //widest implementation the CPU supports (default)
+    TOKENIZER_SCALAR,  //one byte at a time
+    TOKENIZER_SSE2,    //16-byte blocks
+    TOKENIZER_AVX2     //32-byte blocks
+} TokenizerMode;
+
+void tokenizer_set_mode(TokenizerMode mode); //force an implementation (benchmarks and differential tests); unsupported ones fall back to scalar
+TokenizerMode tokenizer_mode(); //implementation actually in use
+
+//isspace() in the C locale (' ' and '\t' through '\r') without the locale table lookup
+static inline int is_space(char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= (unsigned char)('\r' - '\t');
+}
+
+//the scanners classify whitespace (C locale isspace), '|' and quotes a block at a time and
+//read only [p, end), so they never look past the line's terminator
+size_t scan_word(const char *p, const char *end);  //bytes before the first whitespace, '|', '"' or '\''
+size_t scan_field(const char *p, const char *end); //bytes before the first whitespace or '|'
+void scan_bounds(const char *p, const char *end, size_t *pipes, size_t *runs); //count '|' and runs of bytes that are neither whitespace nor '|'
+
+#endif
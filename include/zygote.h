@@ -0,0 +1,59 @@
+//include/zygote.h - Pre-forked helper process that spawns commands for the server
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <sys/types.h>
+
+#define ZYGOTE_INLINE_COMMAND 4096     //longer command lines travel in a memfd instead of the request
+
+/**
+ * Forks the spawn helper
+ * Must be called while the server is still single-threaded and small (first thing
+ * in start_server): the helper keeps that tiny footprint, so every later spawn costs
+ * the same no matter how large the server's heap or thread count grows, and no
+ * child is ever forked from a multithreaded process.
+ *
+ * The server sends the helper one SOCK_SEQPACKET message per command: the command
+ * text, with the output pipe and the write end of a per-job status pipe attached
+ * via SCM_RIGHTS (a command longer than ZYGOTE_INLINE_COMMAND is written to a memfd
+ * that is attached as a third descriptor). The helper starts the job with launch_command, writes the leader's
+ * pid into the status pipe and, once the leader exits, kills the job's other stages,
+ * reaps it and writes its wait status
+ *
+ * @return 0 on success, -1 if the helper could not be started
+ */
+int start_zygote();
+
+/**
+ * Starts a command through the helper in a new process group
+ * The job is not a child of the server: its exit is reported on *exit_fd, which
+ * becomes readable when the job's leader has exited and been reaped
+ *
+ * @param command - command line (direct exec or /bin/sh -c, see launch_command)
+ * @param out_fd - the job's stdout and stderr
+ * @param exit_fd - receives the job's status descriptor (close-on-exec), owned by the caller
+ * @return the process group leader's pid, or -1 if the job could not be started
+ */
+pid_t zygote_spawn(const char* command, int out_fd, int* exit_fd);
+
+/**
+ * Blocks until a job started by zygote_spawn has exited, then closes its exit_fd
+ *
+ * @return the job's wait status, or -1 if the helper went away
+ */
+int zygote_wait(int exit_fd);
+
+/**
+ * Kills a job's whole process group and waits for the helper to reap it
+ *
+ * @param pid - the job's process group leader
+ * @param exit_fd - the job's status descriptor, closed afterwards
+ */
+void zygote_kill(pid_t pid, int exit_fd);
+
+/**
+ * Shuts the helper down; it kills the jobs it still tracks and exits
+ */
+void stop_zygote();
+
+#endif //ZYGOTE_H
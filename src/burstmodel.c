@@ -0,0 +1,270 @@
+// src/burstmodel.c - Burst time prediction from the measured run times of earlier commands
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../include/burstmodel.h"
+#include "../include/scheduler.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define MODEL_SLOTS (2 * BURST_MODEL_CAPACITY)   //open addressing at most half full
+#define DEFAULT_BURST_US ((long long)DEFAULT_BURST_TIME * USEC_PER_SEC)
+
+//one signature's history, also the on-disk record
+typedef struct {
+    uint64_t key;           //signature hash, 0 for an empty slot
+    int64_t average_us;     //exponential average of the run times
+    uint32_t samples;       //runs folded in
+    uint32_t uses;          //clock: recent runs banked against replacement
+} ModelEntry;
+
+//on-disk header, followed by count ModelEntry records
+typedef struct {
+    uint32_t magic;         //BURST_MODEL_MAGIC
+    uint32_t count;
+} ModelHeader;
+
+static pthread_mutex_t model_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t save_mutex = PTHREAD_MUTEX_INITIALIZER; //one writer of the file at a time
+static ModelEntry slots[MODEL_SLOTS];
+static int entry_count = 0;
+static size_t clock_hand = 0;            //next slot the replacement sweep looks at
+static int dirty = 0;
+static char* model_path = NULL;
+
+
+static uint64_t fnv_bytes(uint64_t hash, const char* bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+//hash both signatures of a command; -1 if it has no words
+static int signatures(const char* command, uint64_t* command_key, uint64_t* program_key) {
+    const char* p = command + strspn(command, " \t");
+    size_t length = strcspn(p, " \t");
+    if (length == 0) return -1;
+
+    //a separator byte after every word keeps "a bc" and "ab c" apart; the executable
+    //signature ends in a different byte than a command without arguments
+    uint64_t hash = fnv_bytes(FNV_OFFSET, p, length);
+    *program_key = fnv_bytes(hash, "\1", 1);
+    while (length > 0) {
+        hash = fnv_bytes(hash, "\0", 1);
+        p += length;
+        p += strspn(p, " \t");
+        length = strcspn(p, " \t");
+        hash = fnv_bytes(hash, p, length);
+    }
+    *command_key = hash;
+
+    //0 marks empty slots
+    if (*command_key == 0) *command_key = 1;
+    if (*program_key == 0) *program_key = 1;
+    return 0;
+}
+
+//slot holding key, or the empty slot where it belongs (the table is never more than half
+//full, so there always is one); caller holds model_mutex
+static ModelEntry* find_slot(uint64_t key) {
+    size_t at = key & (MODEL_SLOTS - 1);
+    while (slots[at].key != key && slots[at].key != 0) at = (at + 1) & (MODEL_SLOTS - 1);
+    return &slots[at];
+}
+
+//empty slot hole, shifting later entries of its probe run back so none is cut off from
+//its home slot; caller holds model_mutex
+static void remove_slot(size_t hole) {
+    memset(&slots[hole], 0, sizeof(ModelEntry));
+    for (size_t at = (hole + 1) & (MODEL_SLOTS - 1); slots[at].key != 0; at = (at + 1) & (MODEL_SLOTS - 1)) {
+        size_t home = slots[at].key & (MODEL_SLOTS - 1);
+        //an entry whose home lies after the hole (up to where it sits) must stay
+        if (((at - home) & (MODEL_SLOTS - 1)) < ((at - hole) & (MODEL_SLOTS - 1))) continue;
+        slots[hole] = slots[at];
+        memset(&slots[at], 0, sizeof(ModelEntry));
+        hole = at;
+    }
+    entry_count--;
+}
+
+//clock sweep: take a banked use from each signature passed, drop the first with none
+//left; caller holds model_mutex and the model is full
+static void evict_one() {
+    for (;;) {
+        size_t at = clock_hand;
+        clock_hand = (clock_hand + 1) & (MODEL_SLOTS - 1);
+        if (slots[at].key == 0) continue;
+        if (slots[at].uses > 0) {
+            slots[at].uses--;
+            continue;
+        }
+        remove_slot(at);
+        return;
+    }
+}
+
+//caller holds model_mutex
+static void fold_sample(uint64_t key, long long run_us) {
+    ModelEntry* entry = find_slot(key);
+    if (entry->key == 0 && entry_count >= BURST_MODEL_CAPACITY) {
+        //evicting moves entries around, so look the slot up again
+        evict_one();
+        entry = find_slot(key);
+    }
+    if (entry->key == 0) {
+        entry->key = key;
+        entry->average_us = run_us;
+        entry->samples = 1;
+        entry->uses = 1;
+        entry_count++;
+    } else {
+        entry->average_us += (run_us - entry->average_us) * BURST_MODEL_WEIGHT_PERCENT / 100;
+        if (entry->samples < UINT32_MAX) entry->samples++;
+        if (entry->uses < BURST_MODEL_MAX_USES) entry->uses++;
+    }
+}
+
+
+int burst_model_load(const char* path) {
+    char* copy = strdup(path);
+    if (copy == NULL) return -1;
+
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        if (errno == ENOENT) {
+            pthread_mutex_lock(&model_mutex);
+            free(model_path);
+            model_path = copy;
+            pthread_mutex_unlock(&model_mutex);
+            return 0;
+        }
+        perror(path);
+        free(copy);
+        return -1;
+    }
+
+    ModelHeader header;
+    ModelEntry* entries = NULL;
+    int result = -1;
+    if (fread(&header, sizeof(header), 1, file) == 1 && header.magic == BURST_MODEL_MAGIC &&
+        header.count <= BURST_MODEL_CAPACITY) {
+        entries = (ModelEntry*)malloc((header.count ? header.count : 1) * sizeof(ModelEntry));
+        if (entries != NULL && fread(entries, sizeof(ModelEntry), header.count, file) == header.count &&
+            fgetc(file) == EOF) {
+            result = 0;
+        }
+    }
+    fclose(file);
+    if (result != 0) {
+        fprintf(stderr, "%s: not a burst model file\n", path);
+        free(entries);
+        free(copy);
+        return -1;
+    }
+
+    pthread_mutex_lock(&model_mutex);
+    memset(slots, 0, sizeof(slots));
+    entry_count = 0;
+    clock_hand = 0;
+    for (uint32_t i = 0; i < header.count; i++) {
+        ModelEntry* slot = entries[i].key ? find_slot(entries[i].key) : NULL;
+        if (slot == NULL || slot->key != 0) continue;
+        *slot = entries[i];
+        //age what earlier runs banked: a signature nobody runs any more loses it over a few restarts
+        if (slot->uses > BURST_MODEL_MAX_USES) slot->uses = BURST_MODEL_MAX_USES;
+        slot->uses /= 2;
+        entry_count++;
+    }
+    dirty = 0;
+    free(model_path);
+    model_path = copy;
+    pthread_mutex_unlock(&model_mutex);
+    free(entries);
+    return 0;
+}
+
+long long burst_model_predict_us(const char* command, long long hint_us) {
+    uint64_t command_key, program_key;
+    if (signatures(command, &command_key, &program_key) != 0) return hint_us;
+
+    long long predicted = hint_us;
+    pthread_mutex_lock(&model_mutex);
+    ModelEntry* entry = find_slot(command_key);
+    //a burst the command names itself ("./demo 12") beats what other arguments took
+    if (entry->key == 0 && hint_us == DEFAULT_BURST_US) {
+        entry = find_slot(program_key);
+    }
+    if (entry->key != 0) predicted = entry->average_us;
+    pthread_mutex_unlock(&model_mutex);
+
+    return predicted < BURST_MODEL_MIN_US ? BURST_MODEL_MIN_US : predicted;
+}
+
+void burst_model_record(const char* command, long long run_us) {
+    uint64_t command_key, program_key;
+    if (run_us < 0 || signatures(command, &command_key, &program_key) != 0) return;
+
+    pthread_mutex_lock(&model_mutex);
+    fold_sample(command_key, run_us);
+    fold_sample(program_key, run_us);
+    dirty = 1;
+    pthread_mutex_unlock(&model_mutex);
+}
+
+int burst_model_save() {
+    pthread_mutex_lock(&save_mutex);
+
+    //snapshot under the model lock, write without it
+    pthread_mutex_lock(&model_mutex);
+    if (model_path == NULL || !dirty) {
+        pthread_mutex_unlock(&model_mutex);
+        pthread_mutex_unlock(&save_mutex);
+        return 0;
+    }
+    ModelHeader header = { BURST_MODEL_MAGIC, (uint32_t)entry_count };
+    ModelEntry* entries = (ModelEntry*)malloc((entry_count ? (size_t)entry_count : 1) * sizeof(ModelEntry));
+    if (entries == NULL) {
+        pthread_mutex_unlock(&model_mutex);
+        pthread_mutex_unlock(&save_mutex);
+        return -1;
+    }
+    uint32_t n = 0;
+    for (size_t i = 0; i < MODEL_SLOTS; i++) {
+        if (slots[i].key != 0) entries[n++] = slots[i];
+    }
+    dirty = 0;
+    size_t path_length = strlen(model_path);
+    char* final_path = (char*)malloc(2 * path_length + 6);
+    if (final_path != NULL) memcpy(final_path, model_path, path_length + 1);
+    pthread_mutex_unlock(&model_mutex);
+
+    int result = -1;
+    if (final_path != NULL) {
+        char* temp_path = final_path + path_length + 1;
+        memcpy(temp_path, final_path, path_length);
+        memcpy(temp_path + path_length, ".tmp", 5);
+        FILE* file = fopen(temp_path, "wb");
+        if (file != NULL) {
+            int written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                          fwrite(entries, sizeof(ModelEntry), n, file) == n;
+            if (fclose(file) == 0 && written && rename(temp_path, final_path) == 0) result = 0;
+            else unlink(temp_path);
+        }
+    }
+    if (result != 0) {
+        //try again at the next save
+        pthread_mutex_lock(&model_mutex);
+        dirty = 1;
+        pthread_mutex_unlock(&model_mutex);
+    }
+    free(entries);
+    free(final_path);
+    pthread_mutex_unlock(&save_mutex);
+    return result;
+}
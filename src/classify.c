@@ -0,0 +1,188 @@
+// src/classify.c - Command table deciding whether a command runs as a shell command or a program
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/classify.h"
+#include "../include/executor.h"
+
+#define TRIE_NO_CLASS -1    //no name ends at this node
+
+//one outgoing byte of a trie node
+typedef struct {
+    unsigned char byte;
+    int child;              //index into nodes
+} TrieEdge;
+
+typedef struct {
+    TrieEdge* edges;        //sorted by byte; names share prefixes, so most nodes have one
+    int edge_count;
+    int task_class;         //TaskType of the name ending here, or TRIE_NO_CLASS
+} TrieNode;
+
+//built-in shell commands; they get the highest priority
+static const char* BUILTIN_SHELL_COMMANDS[] = {
+    "ls", "pwd", "cd", "echo", "cat", "mkdir", "rmdir", "rm", "cp", "mv",
+    "touch", "head", "tail", "grep", "find", "wc", "sort", "uniq", "date",
+    "whoami", "hostname", "uname", "env", "export", "clear", "man", "help",
+    "ps", "kill", "chmod", "chown", "df", "du", "tar", "gzip", "gunzip",
+    NULL
+};
+
+static TrieNode* nodes = NULL;      //nodes[0] is the root
+static int node_count = 0;
+static int node_capacity = 0;
+static TaskType default_class = TASK_TYPE_SHELL;
+static int has_path_entries = 0;    //some entry names an executable by path, so misses resolve on PATH
+static pthread_once_t table_once = PTHREAD_ONCE_INIT;
+
+
+static int new_node() {
+    if (node_count == node_capacity) {
+        int capacity = node_capacity ? node_capacity * 2 : 64;
+        TrieNode* grown = (TrieNode*)realloc(nodes, (size_t)capacity * sizeof(TrieNode));
+        if (grown == NULL) return -1;
+        nodes = grown;
+        node_capacity = capacity;
+    }
+    nodes[node_count].edges = NULL;
+    nodes[node_count].edge_count = 0;
+    nodes[node_count].task_class = TRIE_NO_CLASS;
+    return node_count++;
+}
+
+//child of node for byte, -1 if there is none
+static int find_child(int node, unsigned char byte) {
+    const TrieNode* n = &nodes[node];
+    for (int i = 0; i < n->edge_count && n->edges[i].byte <= byte; i++) {
+        if (n->edges[i].byte == byte) return n->edges[i].child;
+    }
+    return -1;
+}
+
+//child of node for byte, created (keeping the edges sorted) if missing; -1 if out of memory
+static int add_child(int node, unsigned char byte) {
+    int child = find_child(node, byte);
+    if (child >= 0) return child;
+    child = new_node();
+    if (child < 0) return -1;
+
+    TrieNode* n = &nodes[node]; //new_node may have moved the array
+    TrieEdge* edges = (TrieEdge*)realloc(n->edges, (size_t)(n->edge_count + 1) * sizeof(TrieEdge));
+    if (edges == NULL) return -1;
+    int at = n->edge_count;
+    while (at > 0 && edges[at - 1].byte > byte) {
+        edges[at] = edges[at - 1];
+        at--;
+    }
+    edges[at].byte = byte;
+    edges[at].child = child;
+    n->edges = edges;
+    n->edge_count++;
+    return child;
+}
+
+static int insert_name(const char* name, size_t length, TaskType task_class) {
+    int node = 0;
+    for (size_t i = 0; i < length; i++) {
+        node = add_child(node, (unsigned char)name[i]);
+        if (node < 0) return -1;
+    }
+    nodes[node].task_class = task_class;
+    return 0;
+}
+
+//class of the table entry spelled by name[0..length), TRIE_NO_CLASS if there is none
+static int lookup_name(const char* name, size_t length) {
+    int node = 0;
+    for (size_t i = 0; i < length && node >= 0; i++) {
+        node = find_child(node, (unsigned char)name[i]);
+    }
+    return node >= 0 ? nodes[node].task_class : TRIE_NO_CLASS;
+}
+
+static void load_builtin_table() {
+    if (new_node() < 0) return;
+    for (int i = 0; BUILTIN_SHELL_COMMANDS[i] != NULL; i++) {
+        insert_name(BUILTIN_SHELL_COMMANDS[i], strlen(BUILTIN_SHELL_COMMANDS[i]), TASK_TYPE_SHELL);
+    }
+}
+
+static int parse_class(const char* word, TaskType* task_class) {
+    if (strcmp(word, "shell") == 0) *task_class = TASK_TYPE_SHELL;
+    else if (strcmp(word, "program") == 0) *task_class = TASK_TYPE_PROGRAM;
+    else return -1;
+    return 0;
+}
+
+
+int load_command_table(const char* path) {
+    pthread_once(&table_once, load_builtin_table);
+    if (node_count == 0) return -1;
+
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char* line = NULL;
+    size_t line_size = 0;
+    int line_number = 0;
+    int result = 0;
+    while (result == 0 && getline(&line, &line_size, file) != -1) {
+        line_number++;
+        line[strcspn(line, "#")] = '\0';
+
+        char* save = NULL;
+        char* name = strtok_r(line, " \t\r\n", &save);
+        if (name == NULL) continue;
+        char* class_word = strtok_r(NULL, " \t\r\n", &save);
+        TaskType task_class;
+        if (class_word == NULL || strtok_r(NULL, " \t\r\n", &save) != NULL ||
+            parse_class(class_word, &task_class) != 0) {
+            fprintf(stderr, "%s:%d: expected \"<name> shell|program\"\n", path, line_number);
+            result = -1;
+        } else if (strcmp(name, "default") == 0) {
+            default_class = task_class;
+        } else if (insert_name(name, strlen(name), task_class) != 0) {
+            fprintf(stderr, "%s:%d: out of memory\n", path, line_number);
+            result = -1;
+        } else if (strchr(name, '/') != NULL) {
+            has_path_entries = 1;
+        }
+    }
+    free(line);
+    fclose(file);
+    return result;
+}
+
+TaskType classify_command(const char* command) {
+    pthread_once(&table_once, load_builtin_table);
+    if (node_count == 0) return default_class;
+
+    //first word, in place
+    const char* word = command + strspn(command, " \t");
+    size_t length = strcspn(word, " \t");
+    if (length == 0) return TASK_TYPE_SHELL;
+
+    int task_class = lookup_name(word, length);
+    if (task_class != TRIE_NO_CLASS) return (TaskType)task_class;
+
+    //programs always start with ./
+    if (length >= 2 && word[0] == '.' && word[1] == '/') return TASK_TYPE_PROGRAM;
+
+    //the table may name the executable by path ("/usr/bin/make program"); without such
+    //entries a PATH walk could not find anything, so the miss costs no copy or access()
+    char name[SPAWN_MAX_PATH];
+    char resolved[SPAWN_MAX_PATH];
+    if (has_path_entries && length < sizeof(name)) {
+        memcpy(name, word, length);
+        name[length] = '\0';
+        if (resolve_executable(name, resolved, sizeof(resolved)) == 0) {
+            task_class = lookup_name(resolved, strlen(resolved));
+            if (task_class != TRIE_NO_CLASS) return (TaskType)task_class;
+        }
+    }
+    return default_class;
+}
@@ -1,67 +1,267 @@
-// src/client.c 
-#include <stdio.h>      
-#include <stdlib.h>     
-#include <string.h>     
-#include <unistd.h>    
-#include <arpa/inet.h> 
+// src/client.c
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
 #include <sys/select.h>
 #include <errno.h>
 #include <pthread.h>
 #include "../include/client.h"
+#include "../include/protocol.h"
 
 //flag to control the receive thread
 static volatile int receiving = 0;
 static int global_sock = -1;
 
+//commands sent whose END frame has not arrived yet
+static int pending_requests = 0;
+static int exiting = 0;
+static pthread_mutex_t pending_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pending_cond = PTHREAD_COND_INITIALIZER;
+
+//batch mode: output collected per command (request id i is input line i), printed at its END
+typedef struct {
+    char* data;
+    size_t length, capacity;
+} BatchOutput;
+
+static int batch_mode = 0;
+static BatchOutput* batch_outputs = NULL;
+static uint32_t batch_count = 0;
+
+//show the prompt once every command sent so far has finished
+static void print_prompt_if_idle() {
+    if (pending_requests == 0 && !exiting && !batch_mode) {
+        printf(">>> ");
+        fflush(stdout);
+    }
+}
+
+//keep a batch command's output until it finishes
+static void collect_batch_output(uint32_t request_id, const char* payload, uint32_t length) {
+    if (request_id == 0 || request_id > batch_count) return;
+    BatchOutput* output = &batch_outputs[request_id - 1];
+    if (output->length + length > output->capacity) {
+        size_t capacity = output->capacity ? output->capacity : 256;
+        while (capacity < output->length + length) capacity *= 2;
+        char* data = (char*)realloc(output->data, capacity);
+        if (data == NULL) return;
+        output->data = data;
+        output->capacity = capacity;
+    }
+    memcpy(output->data + output->length, payload, length);
+    output->length += length;
+}
+
+//print a finished batch command's output, each line tagged with its line number
+static void print_batch_output(uint32_t request_id) {
+    if (request_id == 0 || request_id > batch_count) return;
+    BatchOutput* output = &batch_outputs[request_id - 1];
+    const char* line = output->data;
+    const char* end = output->data + output->length;
+    while (line < end) {
+        const char* newline = memchr(line, '\n', (size_t)(end - line));
+        size_t length = newline ? (size_t)(newline - line) : (size_t)(end - line);
+        printf("[%u] %.*s\n", request_id, (int)length, line);
+        line += length + 1;
+    }
+    fflush(stdout);
+    free(output->data);
+    output->data = NULL;
+    output->length = output->capacity = 0;
+}
+
 /**
  * Thread function to continuously receive data from server
- * This allows the client to receive streaming output from demo programs
- * while still being able to send new commands
+ * Decodes response frames: OUTPUT/ERROR payloads are printed as they arrive
+ * (demo programs stream their output), END marks a command as finished
  */
 void* receive_thread(void* arg) {
     int sock = *(int*)arg;
     char recv_buffer[CLIENT_BUFFER_SIZE];
-    
+    FrameDecoder decoder;
+    frame_decoder_init(&decoder, PROTOCOL_FRAMED);
+
     while (receiving) {
         //use select with a short timeout so we can check the receiving flag
         fd_set read_fds;
         FD_ZERO(&read_fds);
         FD_SET(sock, &read_fds);
-        
+
         struct timeval timeout;
         timeout.tv_sec = 0;
         timeout.tv_usec = 100000;  //100ms timeout
-        
+
         int select_result = select(sock + 1, &read_fds, NULL, NULL, &timeout);
-        
+
         if (select_result > 0 && FD_ISSET(sock, &read_fds)) {
-            memset(recv_buffer, 0, CLIENT_BUFFER_SIZE);
-            ssize_t bytes_received = recv(sock, recv_buffer, CLIENT_BUFFER_SIZE - 1, 0);
-            
-            if (bytes_received > 0) {
-                recv_buffer[bytes_received] = '\0';
-                printf("%s", recv_buffer);
-                fflush(stdout);
-            } else if (bytes_received == 0) {
-                printf("\nServer disconnected.\n");
-                receiving = 0;
+            ssize_t bytes_received = recv(sock, recv_buffer, CLIENT_BUFFER_SIZE, 0);
+
+            if (bytes_received <= 0) {
+                if (!exiting) {
+                    printf("\nServer disconnected.\n");
+                }
+                break;
+            }
+            if (frame_decoder_append(&decoder, recv_buffer, (size_t)bytes_received) != 0) {
+                break;
+            }
+
+            FrameHeader header;
+            const char* payload;
+            int result;
+            while ((result = frame_decoder_next(&decoder, &header, &payload)) > 0) {
+                if ((header.type == FRAME_OUTPUT || header.type == FRAME_ERROR) && batch_mode) {
+                    collect_batch_output(header.request_id, payload, header.length);
+                } else if (header.type == FRAME_OUTPUT || header.type == FRAME_ERROR) {
+                    fwrite(payload, 1, header.length, stdout);
+                    fflush(stdout);
+                } else if (header.type == FRAME_END) {
+                    if (batch_mode) print_batch_output(header.request_id);
+                    pthread_mutex_lock(&pending_mutex);
+                    if (pending_requests > 0) pending_requests--;
+                    print_prompt_if_idle();
+                    pthread_cond_broadcast(&pending_cond);
+                    pthread_mutex_unlock(&pending_mutex);
+                }
+            }
+            if (result < 0) {
+                printf("\nProtocol error from server.\n");
                 break;
             }
         }
     }
-    
+
+    //wake the main thread if it waits for outstanding commands
+    pthread_mutex_lock(&pending_mutex);
+    receiving = 0;
+    pthread_cond_broadcast(&pending_cond);
+    pthread_mutex_unlock(&pending_mutex);
+
+    frame_decoder_free(&decoder);
     return NULL;
 }
 
+/**
+ * Reads all of stdin and sends it as BATCH frames, each as full as the protocol allows
+ * Line i of the input is request id i; lines too long for a frame are sent empty
+ * so the numbering still matches the input. An "exit" line ends the batch: it is
+ * sent on its own once everything before it has finished, as in interactive mode
+ */
+static void send_batch(int sock) {
+    char* input = NULL;
+    size_t input_length = 0, input_capacity = 0;
+    char chunk[CLIENT_BUFFER_SIZE];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), stdin)) > 0) {
+        if (input_length + n + 1 > input_capacity) {
+            input_capacity = (input_length + n + 1) * 2;
+            char* grown = (char*)realloc(input, input_capacity);
+            if (grown == NULL) {
+                fprintf(stderr, "Out of memory reading the batch\n");
+                free(input);
+                return;
+            }
+            input = grown;
+        }
+        memcpy(input + input_length, chunk, n);
+        input_length += n;
+    }
+    if (input_length == 0) {
+        free(input);
+        return;
+    }
+    if (input[input_length - 1] != '\n') input[input_length++] = '\n';
+
+    //count the lines up to an exit, which is not part of the batch frames
+    uint32_t lines = 0;
+    int exit_line = 0;
+    for (char* line = input; line < input + input_length; ) {
+        char* newline = memchr(line, '\n', (size_t)(input + input_length - line));
+        lines++;
+        if (newline - line == 4 && memcmp(line, "exit", 4) == 0) {
+            input_length = (size_t)(line - input);
+            exit_line = 1;
+            break;
+        }
+        line = newline + 1;
+    }
+    batch_outputs = (BatchOutput*)calloc(lines, sizeof(BatchOutput));
+    if (batch_outputs == NULL) {
+        fprintf(stderr, "Out of memory reading the batch\n");
+        free(input);
+        return;
+    }
+    batch_count = lines;
+
+    //blank out lines no frame can carry
+    uint32_t line_number = 1;
+    for (char* line = input; line < input + input_length; line_number++) {
+        char* newline = memchr(line, '\n', (size_t)(input + input_length - line));
+        if ((size_t)(newline - line) >= FRAME_MAX_PAYLOAD) {
+            fprintf(stderr, "[%u] command too long (limit %d bytes), skipped\n", line_number, FRAME_MAX_PAYLOAD);
+            memmove(line, newline, (size_t)(input + input_length - newline));
+            input_length -= (size_t)(newline - line);
+            newline = line;
+        }
+        line = newline + 1;
+    }
+
+    //count every line before sending so no END can arrive first
+    pthread_mutex_lock(&pending_mutex);
+    pending_requests += (int)(lines - (uint32_t)exit_line);
+    pthread_mutex_unlock(&pending_mutex);
+
+    uint32_t first_id = 1;
+    int sent = 1;
+    char* start = input;
+    while (start < input + input_length && receiving) {
+        //take whole lines while they fit in one frame
+        char* end = start;
+        uint32_t count = 0;
+        while (end < input + input_length && count < BATCH_MAX_COMMANDS) {
+            char* newline = memchr(end, '\n', (size_t)(input + input_length - end));
+            if ((size_t)(newline + 1 - start) > FRAME_MAX_PAYLOAD) break;
+            end = newline + 1;
+            count++;
+        }
+        if (frame_write(sock, FRAME_BATCH, first_id, start, (uint32_t)(end - start)) != 0) {
+            perror("Send failed");
+            sent = 0;
+            break;
+        }
+        first_id += count;
+        start = end;
+    }
+    free(input);
+
+    if (exit_line && sent) {
+        pthread_mutex_lock(&pending_mutex);
+        while (receiving && pending_requests > 0) {
+            pthread_cond_wait(&pending_cond, &pending_mutex);
+        }
+        exiting = 1;
+        pending_requests++;
+        pthread_mutex_unlock(&pending_mutex);
+        if (frame_write(sock, FRAME_COMMAND, lines, "exit", 4) != 0) {
+            perror("Send failed");
+        }
+    }
+}
+
 /**
  * Function to start the client and manage communication with the server
- * Updated for Phase 4 to handle streaming output from scheduled processes
+ * Commands are sent as frames tagged with increasing request ids without waiting
+ * for earlier ones to finish; the receive thread matches replies by their END frames
  */
-void start_client() {
+void start_client(int batch) {
     int sock;
     struct sockaddr_in server_addr;
-    char send_buffer[CLIENT_BUFFER_SIZE];
+    char* send_buffer = NULL;   //one line of input, grown by getline for long generated commands
+    size_t send_capacity = 0;
     pthread_t recv_tid;
+    uint32_t next_request_id = 1;
 
     //create socket
     sock = socket(AF_INET, SOCK_STREAM, 0);
@@ -69,7 +269,7 @@ void start_client() {
         perror("Socket creation failed");
         exit(EXIT_FAILURE);
     }
-    
+
     global_sock = sock;
 
     //setup server address
@@ -90,8 +290,15 @@ void start_client() {
         exit(EXIT_FAILURE);
     }
 
+    //switch the connection to framed mode
+    if (protocol_send_hello(sock) != 0) {
+        perror("Handshake failed");
+        close(sock);
+        exit(EXIT_FAILURE);
+    }
+
     printf("Connected to a server\n");
-    
+
     //start receive thread
     receiving = 1;
     if (pthread_create(&recv_tid, NULL, receive_thread, &sock) != 0) {
@@ -100,13 +307,18 @@ void start_client() {
         exit(EXIT_FAILURE);
     }
 
-    //main client loop
-    while (receiving) {
-        printf(">>> ");
-        fflush(stdout);
+    batch_mode = batch;
+    if (batch_mode) {
+        send_batch(sock);
+    } else {
+        pthread_mutex_lock(&pending_mutex);
+        print_prompt_if_idle();
+        pthread_mutex_unlock(&pending_mutex);
+    }
 
-        if (!fgets(send_buffer, CLIENT_BUFFER_SIZE, stdin)) {
-            printf("\n");
+    //main client loop
+    while (receiving && !batch_mode) {
+        if (getline(&send_buffer, &send_capacity, stdin) < 0) {
             break;
         }
 
@@ -118,38 +330,75 @@ void start_client() {
 
         //skip empty commands
         if (strlen(send_buffer) == 0) {
+            pthread_mutex_lock(&pending_mutex);
+            print_prompt_if_idle();
+            pthread_mutex_unlock(&pending_mutex);
             continue;
         }
 
-        //handle exit command
+        if (strlen(send_buffer) > FRAME_MAX_PAYLOAD) {
+            printf("Command too long (limit %d bytes)\n", FRAME_MAX_PAYLOAD);
+            pthread_mutex_lock(&pending_mutex);
+            print_prompt_if_idle();
+            pthread_mutex_unlock(&pending_mutex);
+            continue;
+        }
+
+        //count the command before sending so its END can never arrive first
+        pthread_mutex_lock(&pending_mutex);
         if (strcmp(send_buffer, "exit") == 0) {
-            send(sock, send_buffer, strlen(send_buffer), 0);
-            usleep(500000);  //wait for server response
-            receiving = 0;
-            break;
+            //the server hangs up on exit, so let earlier commands finish first
+            while (receiving && pending_requests > 0) {
+                pthread_cond_wait(&pending_cond, &pending_mutex);
+            }
+            exiting = 1;
         }
+        pending_requests++;
+        pthread_mutex_unlock(&pending_mutex);
 
         //send command to server
-        if (send(sock, send_buffer, strlen(send_buffer), 0) < 0) {
+        if (frame_write(sock, FRAME_COMMAND, next_request_id++, send_buffer, (uint32_t)strlen(send_buffer)) != 0) {
             perror("Send failed");
-            receiving = 0;
             break;
         }
-        
-        //give some time for server to respond before prompting again
-        //for demo programs, the output will stream in via the receive thread
-        usleep(200000);  //200ms delay
+
+        //the server answers exit and closes the connection
+        if (exiting) {
+            break;
+        }
     }
 
-    //stop receive thread
+    //let every command already sent finish (or the server hang up) before leaving
+    pthread_mutex_lock(&pending_mutex);
+    while (receiving && pending_requests > 0) {
+        pthread_cond_wait(&pending_cond, &pending_mutex);
+    }
+    if (!exiting && !batch_mode) {
+        printf("\n");
+    }
     receiving = 0;
+    pthread_mutex_unlock(&pending_mutex);
+
+    //stop receive thread
     pthread_join(recv_tid, NULL);
-    
+
+    free(send_buffer);
+    free(batch_outputs);
     close(sock);
 }
 
 //main function
-int main() {
-    start_client();
+int main(int argc, char* argv[]) {
+    int batch = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--batch") == 0) {
+            batch = 1;
+        } else {
+            fprintf(stderr, "Usage: %s [--batch]\n", argv[0]);
+            fprintf(stderr, "  --batch    send all of stdin as one batch, output tagged by line number\n");
+            return 1;
+        }
+    }
+    start_client(batch);
     return 0;
-}
\ No newline at end of file
+}
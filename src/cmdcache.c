@@ -0,0 +1,195 @@
+// src/cmdcache.c - LRU cache of classified or parsed commands keyed by command text
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/cmdcache.h"
+#include "../include/executor.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ParsedCommand** buckets = NULL;   //hash chains, bucket_mask + 1 of them
+static size_t bucket_mask = 0;
+static ParsedCommand* lru_head = NULL;   //most recently used
+static ParsedCommand* lru_tail = NULL;   //least recently used, evicted first
+static CommandCacheStats stats = { 0, 0, 0, 0, 0, 0 };
+static CommandCacheContent content = COMMAND_CACHE_CLASSIFY;
+
+
+static uint64_t hash_text(const char* text, size_t length) {
+    uint64_t hash = FNV_OFFSET;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+//classify or parse a command into one block: entry, key text, then the parse arena
+static ParsedCommand* build_entry(const char* command, size_t length, uint64_t hash) {
+    //lines only /bin/sh understands are never parsed
+    int direct = content == COMMAND_CACHE_PARSE && !command_needs_shell(command);
+    size_t header = sizeof(ParsedCommand) + length + 1;
+    size_t arena_bytes = direct ? parse_arena_bytes(command) : 0;
+
+    ParsedCommand* entry = (ParsedCommand*)malloc(header + arena_bytes);
+    if (entry == NULL) return NULL;
+    char* text = (char*)(entry + 1);
+    memcpy(text, command, length + 1);
+
+    entry->text = text;
+    entry->type = TASK_TYPE_PROGRAM;
+    entry->burst_seconds = 0;
+    entry->commands = NULL;
+    if (content == COMMAND_CACHE_CLASSIFY) {
+        entry->type = get_task_type(text);
+        if (entry->type == TASK_TYPE_PROGRAM) entry->burst_seconds = extract_burst_time(text);
+    } else if (direct) {
+        //a malformed pipeline stays NULL and goes to sh, which reports the error
+        ParseArena arena;
+        parse_arena_init(&arena, (char*)entry + header, arena_bytes);
+        entry->commands = parse_input_arena(&arena, text);
+    }
+
+    entry->length = length;
+    entry->hash = hash;
+    atomic_init(&entry->refs, 1);
+    entry->cached = 0;
+    entry->hash_next = NULL;
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+    return entry;
+}
+
+static void lru_unlink(ParsedCommand* entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else lru_tail = entry->lru_prev;
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void lru_push_front(ParsedCommand* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = entry;
+    lru_head = entry;
+    if (lru_tail == NULL) lru_tail = entry;
+}
+
+//cached entry with this text, NULL if none; caller holds cache_mutex
+static ParsedCommand* find_entry(const char* command, size_t length, uint64_t hash) {
+    for (ParsedCommand* entry = buckets[hash & bucket_mask]; entry; entry = entry->hash_next) {
+        if (entry->hash == hash && entry->length == length && memcmp(entry->text, command, length) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+//take the least recently used entry out of the table; caller holds cache_mutex
+//returns it if the cache held the last reference, so it can be freed outside the lock
+static ParsedCommand* evict_oldest() {
+    ParsedCommand* victim = lru_tail;
+    ParsedCommand** link = &buckets[victim->hash & bucket_mask];
+    while (*link != victim) link = &(*link)->hash_next;
+    *link = victim->hash_next;
+    lru_unlink(victim);
+    victim->cached = 0;
+    stats.entries--;
+    stats.evictions++;
+    return atomic_fetch_sub(&victim->refs, 1) == 1 ? victim : NULL;
+}
+
+
+int command_cache_init(int capacity) {
+    if (capacity > COMMAND_CACHE_MAX_CAPACITY) capacity = COMMAND_CACHE_MAX_CAPACITY;
+    if (capacity <= 0) return 0;
+
+    //at least two buckets per entry keeps the chains short
+    size_t count = 1;
+    while (count < 2 * (size_t)capacity) count <<= 1;
+    ParsedCommand** table = (ParsedCommand**)calloc(count, sizeof(ParsedCommand*));
+    if (table == NULL) return -1;
+
+    pthread_mutex_lock(&cache_mutex);
+    buckets = table;
+    bucket_mask = count - 1;
+    stats.capacity = capacity;
+    pthread_mutex_unlock(&cache_mutex);
+    return 0;
+}
+
+void command_cache_set_content(CommandCacheContent what) {
+    pthread_mutex_lock(&cache_mutex);
+    content = what;
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+const ParsedCommand* command_cache_get(const char* command) {
+    size_t length = strnlen(command, COMMAND_CACHE_MAX_KEY + 1);
+    int cacheable = length <= COMMAND_CACHE_MAX_KEY;
+    uint64_t hash = cacheable ? hash_text(command, length) : 0;
+
+    pthread_mutex_lock(&cache_mutex);
+    if (buckets == NULL || !cacheable) {
+        //a key too long to cache is left to the caller instead of building an entry to throw away
+        if (buckets != NULL) stats.uncached++;
+        pthread_mutex_unlock(&cache_mutex);
+        return NULL;
+    }
+    ParsedCommand* found = find_entry(command, length, hash);
+    if (found) {
+        lru_unlink(found);
+        lru_push_front(found);
+        atomic_fetch_add(&found->refs, 1);
+        stats.hits++;
+        pthread_mutex_unlock(&cache_mutex);
+        return found;
+    }
+    stats.misses++;
+    pthread_mutex_unlock(&cache_mutex);
+
+    //classify or parse outside the lock, the slow part of a miss
+    ParsedCommand* entry = build_entry(command, length, hash);
+    if (entry == NULL) return NULL;
+
+    pthread_mutex_lock(&cache_mutex);
+    //another thread may have published the same command meanwhile; keep the first
+    ParsedCommand* existing = find_entry(command, length, hash);
+    if (existing) {
+        lru_unlink(existing);
+        lru_push_front(existing);
+        atomic_fetch_add(&existing->refs, 1);
+        pthread_mutex_unlock(&cache_mutex);
+        free(entry);
+        return existing;
+    }
+
+    ParsedCommand* victim = stats.entries >= stats.capacity ? evict_oldest() : NULL;
+    entry->hash_next = buckets[hash & bucket_mask];
+    buckets[hash & bucket_mask] = entry;
+    lru_push_front(entry);
+    entry->cached = 1;
+    atomic_fetch_add(&entry->refs, 1); //the cache's reference
+    stats.entries++;
+    pthread_mutex_unlock(&cache_mutex);
+
+    free(victim);
+    return entry;
+}
+
+void command_cache_release(const ParsedCommand* entry) {
+    if (entry == NULL) return;
+    //entries are only written before they are published and after the last reference is gone
+    ParsedCommand* held = (ParsedCommand*)entry;
+    if (atomic_fetch_sub(&held->refs, 1) == 1) free(held);
+}
+
+void command_cache_stats(CommandCacheStats* out) {
+    pthread_mutex_lock(&cache_mutex);
+    *out = stats;
+    pthread_mutex_unlock(&cache_mutex);
+}
@@ -0,0 +1,271 @@
+// src/connection.c - Shared, reference-counted client connection
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "../include/connection.h"
+
+//set once the kernel refuses to splice pipes into sockets; read/send is used instead
+static atomic_int splice_unsupported = 0;
+
+//set on I/O threads: replies are queued in the outbox instead of sent blocking
+static __thread int sends_deferred = 0;
+
+
+ClientConn* conn_create(int socket, int client_num) {
+    ClientConn* conn = (ClientConn*)calloc(1, sizeof(ClientConn));
+    if (conn == NULL) return NULL;
+    conn->socket = socket;
+    conn->client_num = client_num;
+    conn->framed = 0;
+    atomic_init(&conn->refs, 1);
+    atomic_init(&conn->closed, 0);
+    pthread_mutex_init(&conn->send_mutex, NULL);
+    pthread_mutex_init(&conn->outbox_mutex, NULL);
+    return conn;
+}
+
+ClientConn* conn_retain(ClientConn* conn) {
+    atomic_fetch_add(&conn->refs, 1);
+    return conn;
+}
+
+void conn_release(ClientConn* conn) {
+    if (conn == NULL) return;
+    if (atomic_fetch_sub(&conn->refs, 1) != 1) return;
+    close(conn->socket);
+    pthread_mutex_destroy(&conn->send_mutex);
+    pthread_mutex_destroy(&conn->outbox_mutex);
+    free(conn->outbox);
+    free(conn);
+}
+
+void conn_shutdown(ClientConn* conn) {
+    atomic_store(&conn->closed, 1);
+    shutdown(conn->socket, SHUT_RDWR);
+}
+
+//send a whole buffer, retrying partial sends; -1 if the client is gone
+static int send_all(int socket, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(socket, data, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return 0;
+}
+
+//send what an I/O thread queued, blocking; caller holds send_mutex
+//the buffer is taken out first, so the I/O thread can keep queueing meanwhile
+static int drain_outbox(ClientConn* conn) {
+    pthread_mutex_lock(&conn->outbox_mutex);
+    char* data = conn->outbox;
+    size_t sent = conn->outbox_sent;
+    size_t used = conn->outbox_used;
+    conn->outbox = NULL;
+    conn->outbox_sent = conn->outbox_used = conn->outbox_capacity = 0;
+    pthread_mutex_unlock(&conn->outbox_mutex);
+
+    int result = (data != NULL) ? send_all(conn->socket, data + sent, used - sent) : 0;
+    free(data);
+    return result;
+}
+
+static int outbox_pending(ClientConn* conn) {
+    pthread_mutex_lock(&conn->outbox_mutex);
+    int pending = conn->outbox_sent < conn->outbox_used;
+    pthread_mutex_unlock(&conn->outbox_mutex);
+    return pending;
+}
+
+//release send_mutex; an I/O thread that found it taken left its replies to the holder
+static void send_unlock(ClientConn* conn) {
+    pthread_mutex_unlock(&conn->send_mutex);
+    while (outbox_pending(conn) && pthread_mutex_trylock(&conn->send_mutex) == 0) {
+        drain_outbox(conn);
+        pthread_mutex_unlock(&conn->send_mutex);
+    }
+}
+
+int conn_send_frame(ClientConn* conn, FrameType type, uint32_t request_id, const void* data, size_t length) {
+    if (sends_deferred) return conn_queue_frame(conn, type, request_id, data, length);
+
+    pthread_mutex_lock(&conn->send_mutex);
+    //queued replies go first: one of them may be a frame cut short
+    int result = drain_outbox(conn);
+    if (result == 0 && conn->framed) {
+        result = frame_write(conn->socket, type, request_id, data, (uint32_t)length);
+    } else if (result == 0 && type != FRAME_END) {
+        result = send_all(conn->socket, (const char*)data, length);
+    }
+    send_unlock(conn);
+    return result;
+}
+
+//append bytes to the outbox, growing it; caller holds outbox_mutex
+static int outbox_append(ClientConn* conn, const void* data, size_t length) {
+    if (conn->outbox_sent == conn->outbox_used) conn->outbox_sent = conn->outbox_used = 0;
+    if (conn->outbox_used - conn->outbox_sent + length > CONN_OUTBOX_MAX) return -1;
+
+    if (conn->outbox_used + length > conn->outbox_capacity) {
+        //slide the unsent bytes to the front before growing
+        memmove(conn->outbox, conn->outbox + conn->outbox_sent, conn->outbox_used - conn->outbox_sent);
+        conn->outbox_used -= conn->outbox_sent;
+        conn->outbox_sent = 0;
+
+        size_t capacity = conn->outbox_capacity ? conn->outbox_capacity : 4096;
+        while (capacity < conn->outbox_used + length) capacity *= 2;
+        if (capacity != conn->outbox_capacity) {
+            char* grown = (char*)realloc(conn->outbox, capacity);
+            if (grown == NULL) return -1;
+            conn->outbox = grown;
+            conn->outbox_capacity = capacity;
+        }
+    }
+    memcpy(conn->outbox + conn->outbox_used, data, length);
+    conn->outbox_used += length;
+    return 0;
+}
+
+int conn_queue_frame(ClientConn* conn, FrameType type, uint32_t request_id, const void* data, size_t length) {
+    if (!conn->framed && type == FRAME_END) return 0;
+
+    pthread_mutex_lock(&conn->outbox_mutex);
+    if (!conn->outbox_failed && conn->framed) {
+        unsigned char header[FRAME_HEADER_SIZE];
+        frame_header_encode(header, type, request_id, (uint32_t)length);
+        if (outbox_append(conn, header, sizeof(header)) != 0) conn->outbox_failed = 1;
+    }
+    if (!conn->outbox_failed && length > 0 && outbox_append(conn, data, length) != 0) {
+        conn->outbox_failed = 1;
+    }
+    pthread_mutex_unlock(&conn->outbox_mutex);
+
+    return conn_flush_outbox(conn) < 0 ? -1 : 0;
+}
+
+int conn_flush_outbox(ClientConn* conn) {
+    //a blocked writer holding the mutex sends the outbox before letting go
+    int locked = (pthread_mutex_trylock(&conn->send_mutex) == 0);
+
+    pthread_mutex_lock(&conn->outbox_mutex);
+    while (locked && !conn->outbox_failed && conn->outbox_sent < conn->outbox_used) {
+        ssize_t sent = send(conn->socket, conn->outbox + conn->outbox_sent, conn->outbox_used - conn->outbox_sent,
+                            MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) conn->outbox_failed = 1;
+            break;
+        }
+        conn->outbox_sent += (size_t)sent;
+    }
+    int result = conn->outbox_failed ? -1 : (conn->outbox_sent < conn->outbox_used);
+    pthread_mutex_unlock(&conn->outbox_mutex);
+
+    if (locked) pthread_mutex_unlock(&conn->send_mutex);
+    return result;
+}
+
+void conn_defer_sends() {
+    sends_deferred = 1;
+}
+
+int conn_send_error(ClientConn* conn, uint32_t request_id, const char* message) {
+    if (conn_send_frame(conn, FRAME_ERROR, request_id, message, strlen(message)) != 0) return -1;
+    return conn_send_frame(conn, FRAME_END, request_id, NULL, 0);
+}
+
+//copy fallback: read what the pipe holds and send it as one chunk
+static ssize_t copy_pipe(ClientConn* conn, uint32_t request_id, int fd) {
+    char buffer[16384];
+    ssize_t bytes = read(fd, buffer, sizeof(buffer));
+    if (bytes > 0 && conn_send_frame(conn, FRAME_OUTPUT, request_id, buffer, (size_t)bytes) != 0) {
+        errno = EPIPE;
+        return -1;
+    }
+    return bytes;
+}
+
+//legacy client: splice straight through, the byte stream needs no headers
+static ssize_t splice_raw(ClientConn* conn, int fd) {
+    pthread_mutex_lock(&conn->send_mutex);
+    ssize_t moved = -1;
+    if (drain_outbox(conn) == 0) {
+        moved = splice(fd, NULL, conn->socket, NULL, OUTPUT_CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    }
+    int saved_errno = errno;
+    send_unlock(conn);
+
+    if (moved < 0 && (saved_errno == EAGAIN || saved_errno == EWOULDBLOCK)) {
+        //EAGAIN means either the pipe is empty or the send timed out on a stalled client
+        int pending = 0;
+        if (ioctl(fd, FIONREAD, &pending) == 0 && pending > 0) saved_errno = ETIMEDOUT;
+    }
+    errno = saved_errno;
+    return moved;
+}
+
+//framed client: header sized from FIONREAD, then splice exactly that many bytes
+static ssize_t splice_framed(ClientConn* conn, uint32_t request_id, int fd) {
+    int pending = 0;
+    if (ioctl(fd, FIONREAD, &pending) < 0) return -1;
+    //an empty pipe is either still open or at EOF; read() tells which
+    if (pending == 0) return copy_pipe(conn, request_id, fd);
+    if (pending > OUTPUT_CHUNK_SIZE) pending = OUTPUT_CHUNK_SIZE;
+
+    unsigned char header[FRAME_HEADER_SIZE];
+    frame_header_encode(header, FRAME_OUTPUT, request_id, (uint32_t)pending);
+
+    pthread_mutex_lock(&conn->send_mutex);
+    ssize_t moved = -1;
+    if (drain_outbox(conn) == 0 && send_all(conn->socket, (const char*)header, sizeof(header)) == 0) {
+        //only this task reads the pipe, so the counted bytes are all there
+        moved = 0;
+        while (moved < pending) {
+            ssize_t n = splice(fd, NULL, conn->socket, NULL, (size_t)(pending - moved), SPLICE_F_MOVE);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+                //the header is out already, so finish this frame by copying
+                atomic_store(&splice_unsupported, 1);
+                char buffer[16384];
+                size_t want = (size_t)(pending - moved) < sizeof(buffer) ? (size_t)(pending - moved) : sizeof(buffer);
+                n = read(fd, buffer, want);
+                if (n > 0 && send_all(conn->socket, buffer, (size_t)n) != 0) n = -1;
+            }
+            if (n <= 0) {
+                //a frame cut short cannot be resynchronized: the connection is lost
+                if (n == 0 || errno == EAGAIN) errno = ETIMEDOUT;
+                moved = -1;
+                break;
+            }
+            moved += n;
+        }
+    }
+    int saved_errno = errno;
+    send_unlock(conn);
+
+    if (moved < 0) {
+        conn_shutdown(conn);
+        errno = saved_errno;
+    }
+    return moved;
+}
+
+ssize_t conn_forward_pipe(ClientConn* conn, uint32_t request_id, int fd) {
+    if (atomic_load(&splice_unsupported)) return copy_pipe(conn, request_id, fd);
+
+    ssize_t moved = conn->framed ? splice_framed(conn, request_id, fd) : splice_raw(conn, fd);
+    if (moved < 0 && (errno == EINVAL || errno == ENOSYS)) {
+        atomic_store(&splice_unsupported, 1);
+        return copy_pipe(conn, request_id, fd);
+    }
+    return moved;
+}
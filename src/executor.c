@@ -1,9 +1,14 @@
 // src/executor.c 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <ctype.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
 #include <sys/wait.h>
 #include "../include/executor.h"
 #include "../include/parser.h"
@@ -12,12 +17,15 @@ void execute_commands(CommandList *cmdlist) {
     if (!cmdlist) return;
 
     int num_cmds = cmdlist->count;
-    int pipefd[2*num_cmds]; //max pipes needed
+    int *pipefd = malloc(2 * (size_t)num_cmds * sizeof(int)); //max pipes needed, any pipeline length
+    if (!pipefd) { perror("malloc"); return; }
 
     //create pipes
     for (int i = 0; i < num_cmds - 1; i++) {
         if (pipe(pipefd + i*2) < 0) {
             perror("pipe");
+            for (int j = 0; j < i*2; j++) close(pipefd[j]);
+            free(pipefd);
             return;
         }
     }
@@ -72,15 +80,204 @@ void execute_commands(CommandList *cmdlist) {
             exit(1);
         } else if (pid < 0) {
             perror("fork failed");
-            return;
+            break;
         }
     }
 
     //close all pipes in parent
     for (int i = 0; i < 2*(num_cmds-1); i++)
         close(pipefd[i]);
+    free(pipefd);
 
     //wait for all children
     for (int i = 0; i < num_cmds; i++)
         wait(NULL);
-}
\ No newline at end of file
+}
+
+//characters whose meaning only /bin/sh knows; parse_input handles | < > 2> and quotes
+static const char *SHELL_METACHARACTERS = ";&$`()*?[]{}~!#\\\n";
+
+int command_needs_shell(const char *line) {
+    if (strpbrk(line, SHELL_METACHARACTERS)) return 1;
+    if (strstr(line, ">>") || strstr(line, "<<")) return 1;
+
+    //parse_input only sees a redirection at the start of a word ("a>b" stays one word)
+    for (const char *p = line; (p = strpbrk(p, "<>")) != NULL; p++) {
+        const char *before = (*p == '>' && p > line && p[-1] == '2') ? p - 1 : p;
+        if (before > line && !isspace((unsigned char)before[-1]) && before[-1] != '|') return 1;
+    }
+    return 0;
+}
+
+int resolve_executable(const char *name, char *out, size_t size) {
+    if (strchr(name, '/')) {
+        if (access(name, X_OK) != 0) return -1;
+        snprintf(out, size, "%s", name);
+        return 0;
+    }
+
+    //VAR=value prefixes and the like are shell syntax
+    if (strchr(name, '=')) return -1;
+
+    const char *path = getenv("PATH");
+    if (!path) path = "/usr/local/bin:/usr/bin:/bin";
+    while (*path) {
+        const char *end = strchr(path, ':');
+        size_t dir_len = end ? (size_t)(end - path) : strlen(path);
+        int written = snprintf(out, size, "%.*s/%s", (int)dir_len, dir_len ? path : ".", name);
+        if (written > 0 && (size_t)written < size && access(out, X_OK) == 0) return 0;
+        if (!end) break;
+        path = end + 1;
+    }
+    return -1;
+}
+
+//spawn one process with the shared attributes: own group, default SIGPIPE, no blocked signals
+static int spawn_process(pid_t *pid, const char *path, char **argv,
+                         posix_spawn_file_actions_t *actions, pid_t pgroup) {
+    posix_spawnattr_t attr;
+    sigset_t defaults, empty;
+
+    posix_spawnattr_init(&attr);
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE); //the server ignores SIGPIPE, commands expect the default
+    sigemptyset(&empty);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, &empty);
+    posix_spawnattr_setpgroup(&attr, pgroup);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    int result = posix_spawn(pid, path, actions, &attr, argv, environ);
+    posix_spawnattr_destroy(&attr);
+    return result;
+}
+
+//free spawn_commands' pipe array and resolved paths
+static void free_spawn_state(int *pipefd, char **paths, int num_cmds) {
+    if (paths) {
+        for (int i = 0; i < num_cmds; i++) free(paths[i]);
+        free(paths);
+    }
+    free(pipefd);
+}
+
+pid_t spawn_commands(const CommandList *cmdlist, int out_fd) {
+    if (!cmdlist || cmdlist->count < 1) return -1;
+
+    //pipe ends and resolved paths, sized for any pipeline length
+    int num_cmds = cmdlist->count;
+    int *pipefd = malloc(2 * (size_t)num_cmds * sizeof(int));
+    char **paths = calloc((size_t)num_cmds, sizeof(char *));
+    if (!pipefd || !paths) {
+        free_spawn_state(pipefd, paths, num_cmds);
+        return -1;
+    }
+
+    //every program must exist before anything starts
+    char resolved[SPAWN_MAX_PATH];
+    for (int i = 0; i < num_cmds; i++) {
+        Command cmd = cmdlist->commands[i];
+        if (!cmd.argv || !cmd.argv[0] || resolve_executable(cmd.argv[0], resolved, sizeof(resolved)) != 0 ||
+            !(paths[i] = strdup(resolved))) {
+            free_spawn_state(pipefd, paths, num_cmds);
+            return -1;
+        }
+    }
+
+    //create pipes (close-on-exec: only the dup2'ed copies reach the children)
+    for (int i = 0; i < num_cmds - 1; i++) {
+        if (pipe2(pipefd + i*2, O_CLOEXEC) < 0) {
+            for (int j = 0; j < i*2; j++) close(pipefd[j]);
+            free_spawn_state(pipefd, paths, num_cmds);
+            return -1;
+        }
+    }
+
+    //start from the last stage: it leads the process group, so its exit ends the job
+    pid_t leader = -1;
+    int failed = 0;
+    for (int i = num_cmds - 1; i >= 0; i--) {
+        Command cmd = cmdlist->commands[i];
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+
+        //set up pipes, the client pipe and /dev/null for the first stage's input
+        if (i != 0) posix_spawn_file_actions_adddup2(&actions, pipefd[(i-1)*2], STDIN_FILENO);
+        else posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+        posix_spawn_file_actions_adddup2(&actions, i != num_cmds - 1 ? pipefd[i*2 + 1] : out_fd, STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDERR_FILENO);
+
+        //redirections take precedence over pipes, as in sh
+        if (cmd.input_file)
+            posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, cmd.input_file, O_RDONLY, 0);
+        if (cmd.output_file)
+            posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, cmd.output_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (cmd.error_file)
+            posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, cmd.error_file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+        pid_t pid;
+        int result = spawn_process(&pid, paths[i], cmd.argv, &actions, leader > 0 ? leader : 0);
+        posix_spawn_file_actions_destroy(&actions);
+        if (result != 0) {
+            failed = 1;
+            break;
+        }
+        if (leader < 0) leader = pid;
+    }
+
+    //close all pipes in parent
+    for (int i = 0; i < 2*(num_cmds-1); i++)
+        close(pipefd[i]);
+    free_spawn_state(pipefd, paths, num_cmds);
+
+    if (failed) {
+        if (leader > 0) reap_process_group(leader);
+        return -1;
+    }
+    return leader;
+}
+
+pid_t launch_command(const char *line, int out_fd) {
+    //plain commands and pipelines are exec'ed directly, everything else goes to sh
+    if (!command_needs_shell(line)) {
+        //the whole parse lives in one arena: on the stack unless the line is unusually big
+        char arena_stack[PARSE_ARENA_STACK];
+        size_t needed = parse_arena_bytes(line);
+        void *arena_buffer = needed <= sizeof(arena_stack) ? arena_stack : malloc(needed);
+        pid_t leader = -1;
+        if (arena_buffer) {
+            ParseArena arena;
+            parse_arena_init(&arena, arena_buffer, needed <= sizeof(arena_stack) ? sizeof(arena_stack) : needed);
+
+            //a malformed pipeline falls through to sh, which reports the error to the client
+            CommandList *cmdlist = parse_input_arena(&arena, line);
+            if (cmdlist) leader = spawn_commands(cmdlist, out_fd);
+            if (arena_buffer != arena_stack) free(arena_buffer);
+        }
+        if (leader > 0) return leader;
+    }
+    return spawn_shell_command(line, out_fd);
+}
+
+pid_t spawn_shell_command(const char *line, int out_fd) {
+    char *argv[] = { "sh", "-c", (char *)line, NULL };
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out_fd, STDERR_FILENO);
+
+    pid_t pid;
+    int result = spawn_process(&pid, "/bin/sh", argv, &actions, 0);
+    posix_spawn_file_actions_destroy(&actions);
+    return result == 0 ? pid : -1;
+}
+
+void reap_process_group(pid_t leader) {
+    if (leader <= 0) return;
+    //SIGKILL also ends stopped processes
+    kill(-leader, SIGKILL);
+    //the group lives on until its last member is reaped
+    while (waitpid(-leader, NULL, 0) > 0 || errno == EINTR)
+        ;
+}
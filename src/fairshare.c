@@ -0,0 +1,269 @@
+// src/fairshare.c - Per-client and per-group shares of scheduler time, and their accounting
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/fairshare.h"
+#include "../include/scheduler.h"
+
+//one connected client (or one whose tasks outlive its connection)
+typedef struct ClientAccount {
+    int client_num;
+    int group;                          //index into groups, 0 = no group
+    int weight;
+    int tasks;                          //tasks in the system; active while > 0
+    int closed;                         //disconnected: dropped with its last task
+    long long run_us;
+    unsigned long long completed;
+    struct ClientAccount* next;         //hash bucket chain
+} ClientAccount;
+
+typedef struct {
+    char name[FAIR_SHARE_NAME_MAX];
+    int weight;
+    int members;                        //client accounts in the group
+    int active_members;
+    long long active_weight;            //sum of the active members' weights
+    long long run_us;                   //including members that have left
+    unsigned long long completed;
+} ShareGroup;
+
+//a client address whose connections are put in a group (--member)
+typedef struct {
+    char address[FAIR_SHARE_ADDRESS_MAX];
+    int group;
+} ShareMember;
+
+static pthread_mutex_t fair_share_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ShareGroup groups[FAIR_SHARE_MAX_GROUPS] = { { FAIR_SHARE_NO_GROUP, TASK_DEFAULT_WEIGHT, 0, 0, 0, 0, 0 } };
+static int group_count = 1;
+static ShareMember members[FAIR_SHARE_MAX_MEMBERS];
+static int member_count = 0;
+static ClientAccount* accounts[FAIR_SHARE_CLIENT_BUCKETS];
+static int account_count = 0;
+static long long total_run_us = 0;
+
+
+static int find_group(const char* name) {
+    for (int g = 0; g < group_count; g++) {
+        if (strcmp(groups[g].name, name) == 0) return g;
+    }
+    return -1;
+}
+
+//find a client's account, optionally creating it (ungrouped, default weight); caller holds the mutex
+static ClientAccount* client_account(int client_num, int create) {
+    unsigned bucket = (unsigned)client_num & (FAIR_SHARE_CLIENT_BUCKETS - 1);
+    for (ClientAccount* account = accounts[bucket]; account != NULL; account = account->next) {
+        if (account->client_num == client_num) return account;
+    }
+    if (!create) return NULL;
+
+    ClientAccount* account = (ClientAccount*)calloc(1, sizeof(ClientAccount));
+    if (account == NULL) return NULL;
+    account->client_num = client_num;
+    account->weight = TASK_DEFAULT_WEIGHT;
+    account->next = accounts[bucket];
+    accounts[bucket] = account;
+    groups[0].members++;
+    account_count++;
+    return account;
+}
+
+//drop a disconnected client's account once nothing of it is left in the system
+static void release_if_done(ClientAccount* account) {
+    if (!account->closed || account->tasks > 0) return;
+    unsigned bucket = (unsigned)account->client_num & (FAIR_SHARE_CLIENT_BUCKETS - 1);
+    ClientAccount** link = &accounts[bucket];
+    while (*link != account) link = &(*link)->next;
+    *link = account->next;
+    groups[account->group].members--;
+    account_count--;
+    free(account);
+}
+
+//add or remove an active client's weight from its group
+static void group_activate(ClientAccount* account, int delta) {
+    ShareGroup* group = &groups[account->group];
+    group->active_members += delta;
+    group->active_weight += delta * (long long)account->weight;
+}
+
+//the client's share of the core relative to TASK_DEFAULT_WEIGHT: its own weight outside
+//a group, its part of the group's weight inside one
+static long long effective_weight(const ClientAccount* account) {
+    const ShareGroup* group = &groups[account->group];
+    if (account->group == 0 || group->active_weight <= 0) return account->weight;
+    long long weight = (long long)group->weight * account->weight / group->active_weight;
+    return weight > 0 ? weight : 1;
+}
+
+
+int fair_share_define_group(const char* name, int weight) {
+    if (name[0] == '\0' || strlen(name) >= FAIR_SHARE_NAME_MAX || strcmp(name, FAIR_SHARE_NO_GROUP) == 0 ||
+        weight < 1 || weight > FAIR_SHARE_MAX_WEIGHT) {
+        return -1;
+    }
+    pthread_mutex_lock(&fair_share_mutex);
+    int g = find_group(name);
+    if (g < 0 && group_count < FAIR_SHARE_MAX_GROUPS) {
+        g = group_count++;
+        memset(&groups[g], 0, sizeof(ShareGroup));
+        strcpy(groups[g].name, name);
+    }
+    if (g >= 0) groups[g].weight = weight;
+    pthread_mutex_unlock(&fair_share_mutex);
+    return g >= 0 ? 0 : -1;
+}
+
+int fair_share_add_member(const char* address, const char* group) {
+    if (address[0] == '\0' || strlen(address) >= FAIR_SHARE_ADDRESS_MAX) return -1;
+    pthread_mutex_lock(&fair_share_mutex);
+    int g = find_group(group);
+    int added = (g > 0 && member_count < FAIR_SHARE_MAX_MEMBERS);
+    if (added) {
+        strcpy(members[member_count].address, address);
+        members[member_count].group = g;
+        member_count++;
+    }
+    pthread_mutex_unlock(&fair_share_mutex);
+    return added ? 0 : -1;
+}
+
+void fair_share_client_connected(int client_num, const char* address) {
+    pthread_mutex_lock(&fair_share_mutex);
+    //the last mapping of an address wins, as with repeated --share
+    int g = 0;
+    for (int m = 0; m < member_count; m++) {
+        if (strcmp(members[m].address, address) == 0) g = members[m].group;
+    }
+    ClientAccount* account = (g > 0) ? client_account(client_num, 1) : NULL;
+    if (account != NULL) {
+        groups[account->group].members--;
+        account->group = g;
+        groups[g].members++;
+    }
+    pthread_mutex_unlock(&fair_share_mutex);
+}
+
+int fair_share_set_weight(int client_num, int weight) {
+    if (weight < 1 || weight > FAIR_SHARE_MAX_WEIGHT) return -1;
+    pthread_mutex_lock(&fair_share_mutex);
+    ClientAccount* account = client_account(client_num, 1);
+    if (account != NULL) {
+        if (account->tasks > 0) group_activate(account, -1);
+        account->weight = weight;
+        if (account->tasks > 0) group_activate(account, 1);
+    }
+    pthread_mutex_unlock(&fair_share_mutex);
+    return account != NULL ? 0 : -1;
+}
+
+int fair_share_weight(int client_num) {
+    pthread_mutex_lock(&fair_share_mutex);
+    ClientAccount* account = client_account(client_num, 0);
+    int weight = (account != NULL) ? (int)effective_weight(account) : TASK_DEFAULT_WEIGHT;
+    pthread_mutex_unlock(&fair_share_mutex);
+    return weight;
+}
+
+int fair_share_task_created(int client_num) {
+    pthread_mutex_lock(&fair_share_mutex);
+    ClientAccount* account = client_account(client_num, 1);
+    if (account != NULL && account->tasks++ == 0) group_activate(account, 1);
+    int weight = (account != NULL) ? (int)effective_weight(account) : TASK_DEFAULT_WEIGHT;
+    pthread_mutex_unlock(&fair_share_mutex);
+    return weight;
+}
+
+void fair_share_task_destroyed(int client_num) {
+    pthread_mutex_lock(&fair_share_mutex);
+    ClientAccount* account = client_account(client_num, 0);
+    if (account != NULL && account->tasks > 0) {
+        if (--account->tasks == 0) group_activate(account, -1);
+        release_if_done(account);
+    }
+    pthread_mutex_unlock(&fair_share_mutex);
+}
+
+void fair_share_client_closed(int client_num) {
+    pthread_mutex_lock(&fair_share_mutex);
+    ClientAccount* account = client_account(client_num, 0);
+    if (account != NULL) {
+        account->closed = 1;
+        release_if_done(account);
+    }
+    pthread_mutex_unlock(&fair_share_mutex);
+}
+
+void fair_share_charge(int client_num, long long run_us) {
+    pthread_mutex_lock(&fair_share_mutex);
+    ClientAccount* account = client_account(client_num, 0);
+    if (account != NULL) {
+        account->run_us += run_us;
+        groups[account->group].run_us += run_us;
+    }
+    total_run_us += run_us;
+    pthread_mutex_unlock(&fair_share_mutex);
+}
+
+void fair_share_completed(int client_num) {
+    pthread_mutex_lock(&fair_share_mutex);
+    ClientAccount* account = client_account(client_num, 0);
+    if (account != NULL) {
+        account->completed++;
+        groups[account->group].completed++;
+    }
+    pthread_mutex_unlock(&fair_share_mutex);
+}
+
+
+int fair_share_groups(FairShareUsage* out, int capacity) {
+    int count = 0;
+    pthread_mutex_lock(&fair_share_mutex);
+    for (int g = 0; g < group_count && count < capacity; g++) {
+        ShareGroup* group = &groups[g];
+        if (g == 0 && group->members == 0 && group->run_us == 0 && group->completed == 0) continue;
+        FairShareUsage* usage = &out[count++];
+        memcpy(usage->group, group->name, sizeof(usage->group));
+        usage->client_num = -1;
+        usage->weight = group->weight;
+        usage->active = group->active_members;
+        usage->run_us = group->run_us;
+        usage->completed = group->completed;
+    }
+    pthread_mutex_unlock(&fair_share_mutex);
+    return count;
+}
+
+int fair_share_top_clients(FairShareUsage* out, int capacity, int* clients) {
+    int count = 0;
+    pthread_mutex_lock(&fair_share_mutex);
+    for (int b = 0; b < FAIR_SHARE_CLIENT_BUCKETS; b++) {
+        for (ClientAccount* account = accounts[b]; account != NULL; account = account->next) {
+            //insertion into the short list kept sorted by service, most first
+            int i = (count < capacity) ? count++ : capacity;
+            while (i > 0 && out[i - 1].run_us < account->run_us) {
+                if (i < capacity) out[i] = out[i - 1];
+                i--;
+            }
+            if (i >= capacity) continue;
+            FairShareUsage* usage = &out[i];
+            memcpy(usage->group, groups[account->group].name, sizeof(usage->group));
+            usage->client_num = account->client_num;
+            usage->weight = account->weight;
+            usage->active = account->tasks;
+            usage->run_us = account->run_us;
+            usage->completed = account->completed;
+        }
+    }
+    *clients = account_count;
+    pthread_mutex_unlock(&fair_share_mutex);
+    return count;
+}
+
+long long fair_share_total_run_us() {
+    pthread_mutex_lock(&fair_share_mutex);
+    long long run_us = total_run_us;
+    pthread_mutex_unlock(&fair_share_mutex);
+    return run_us;
+}
@@ -0,0 +1,60 @@
+// src/histogram.c - Lock-free log-linear (HDR-style) histograms
+#include "../include/histogram.h"
+
+
+//bucket of a value: exact below HISTOGRAM_SUB_BUCKETS, then HISTOGRAM_SUB_BUCKETS per power of two
+static int bucket_index(unsigned long long value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) return (int)value;
+    int magnitude = 63 - __builtin_clzll(value);
+    if (magnitude > HISTOGRAM_MAX_MAGNITUDE) return HISTOGRAM_BUCKETS - 1;
+    int shift = magnitude - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS + (int)((value >> shift) - HISTOGRAM_SUB_BUCKETS);
+}
+
+//largest value that falls into a bucket
+static unsigned long long bucket_upper(int index) {
+    if (index < HISTOGRAM_SUB_BUCKETS) return (unsigned long long)index;
+    int shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    unsigned long long lower = (unsigned long long)(HISTOGRAM_SUB_BUCKETS + index % HISTOGRAM_SUB_BUCKETS) << shift;
+    return lower + (1ULL << shift) - 1;
+}
+
+void histogram_record(Histogram* histogram, long long value) {
+    unsigned long long v = value > 0 ? (unsigned long long)value : 0;
+    atomic_fetch_add_explicit(&histogram->buckets[bucket_index(v)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum, v, memory_order_relaxed);
+    unsigned long long max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (v > max && !atomic_compare_exchange_weak_explicit(&histogram->max, &max, v, memory_order_relaxed,
+                                                              memory_order_relaxed)) {
+    }
+}
+
+long long histogram_quantile(Histogram* histogram, double q) {
+    unsigned long long count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    if (count == 0) return 0;
+    unsigned long long max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    unsigned long long rank = (unsigned long long)(q * (double)count + 0.5);
+    if (rank < 1) rank = 1;
+
+    unsigned long long seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        if (seen >= rank) {
+            unsigned long long upper = bucket_upper(i);
+            return (long long)(upper < max ? upper : max);
+        }
+    }
+    return (long long)max;
+}
+
+unsigned long long histogram_count_below(Histogram* histogram, long long bound) {
+    if (bound < 0) return 0;
+    //the bucket holding bound is included, so a value equal to an exported bound is never above it
+    int last = bucket_index((unsigned long long)bound);
+    unsigned long long seen = 0;
+    for (int i = 0; i <= last; i++) {
+        seen += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+    }
+    return seen;
+}
@@ -0,0 +1,571 @@
+// src/logger.c - Asynchronous server log: per-thread lock-free rings drained by one writer thread
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/uio.h>
+#include "../include/logger.h"
+
+#define LOG_CACHE_LINE 64
+#define LOG_IOV_MAX (IOV_MAX < 256 ? IOV_MAX : 256)   //segments per writev
+#define LOG_SCRATCH_BYTES 65536                        //formatted bytes per writev
+
+#define COLOR_CYAN    "\033[1;36m"    //created
+#define COLOR_GREEN   "\033[1;32m"    //started
+#define COLOR_YELLOW  "\033[1;33m"    //waiting, dropped records
+#define COLOR_MAGENTA "\033[1;35m"    //running
+#define COLOR_RED     "\033[1;31m"    //ended
+#define COLOR_BLUE    "\033[1;37;46m" //schedule summary
+#define COLOR_RESET   "\033[0m"
+
+//escape codes of a MESSAGE tag, indexed by LogColor
+static const char* const MESSAGE_COLORS[LOG_COLOR_COUNT] = {
+    COLOR_RESET, "\033[1;34m", COLOR_YELLOW, COLOR_MAGENTA, COLOR_GREEN, COLOR_RED
+};
+
+//one event as the producing thread left it; formatted only by the writer
+typedef struct {
+    int64_t time_us;                //monotonic clock
+    int64_t value;
+    char* heap_text;                //text longer than LOG_INLINE_TEXT, owned by the record
+    int32_t client_num;
+    int32_t task_id;
+    uint32_t text_length;
+    uint8_t level;
+    uint8_t event;
+    char text[LOG_INLINE_TEXT];
+} LogRecord;
+
+//single producer (its thread) / single consumer (the writer) ring
+//a thread whose ring fills moves on to a successor twice the size; the writer finishes
+//the old ring before it reads the successor, so the thread's records stay in order
+typedef struct LogRing {
+    _Alignas(LOG_CACHE_LINE) atomic_size_t tail;    //next record the thread writes
+    _Alignas(LOG_CACHE_LINE) atomic_size_t head;    //next record the writer reads
+    size_t mask;                                    //capacity - 1
+    atomic_ullong dropped;                          //records lost to a full ring, not yet reported
+    atomic_int orphaned;                            //thread exited; freed once drained
+    _Atomic(struct LogRing*) successor;             //set once the thread has moved on
+    struct LogRing* next;                           //writer's list of rings
+    LogRecord records[];
+} LogRing;
+
+//writev batch: segments point into scratch or at the records' own text
+typedef struct {
+    struct iovec iov[LOG_IOV_MAX];
+    int iov_count;
+    char scratch[LOG_SCRATCH_BYTES];
+    size_t used;
+} LogOutput;
+
+static atomic_int log_level = LOG_LEVEL_DEBUG;
+static LogFormat log_format = LOG_FORMAT_TEXT;
+static int log_fd = STDOUT_FILENO;
+static long long wall_offset_us = 0;         //wall clock minus monotonic clock, for JSON and BINARY
+
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;   //ring list; taken once per thread
+static LogRing* rings = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static __thread LogRing* thread_ring = NULL;
+
+static pthread_mutex_t writer_mutex = PTHREAD_MUTEX_INITIALIZER;  //one pass at a time
+static pthread_t writer_thread;
+static atomic_int writer_running = 0;
+static atomic_ullong total_dropped = 0;
+
+//writer-owned pass state (under writer_mutex)
+static LogRecord batch[LOG_BATCH_RECORDS];
+static LogRecord* order[LOG_BATCH_RECORDS];
+static LogOutput output;
+
+
+static long long clock_us(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (long long)now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+//the thread is gone: its ring is freed by the writer once drained
+static void release_ring(void* arg) {
+    //runs on the exiting thread: a record logged by a later destructor gets a fresh ring
+    thread_ring = NULL;
+    atomic_store_explicit(&((LogRing*)arg)->orphaned, 1, memory_order_release);
+}
+
+static void create_ring_key() {
+    pthread_key_create(&ring_key, release_ring);
+}
+
+static LogRing* allocate_ring(size_t capacity) {
+    void* memory = NULL;
+    if (posix_memalign(&memory, LOG_CACHE_LINE, sizeof(LogRing) + capacity * sizeof(LogRecord)) != 0) return NULL;
+    LogRing* ring = (LogRing*)memory;
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    ring->mask = capacity - 1;
+    atomic_init(&ring->dropped, 0);
+    atomic_init(&ring->orphaned, 0);
+    atomic_init(&ring->successor, NULL);
+    ring->next = NULL;
+    return ring;
+}
+
+//allocate and publish the calling thread's ring
+static LogRing* register_thread_ring() {
+    pthread_once(&ring_key_once, create_ring_key);
+    LogRing* ring = allocate_ring(LOG_RING_RECORDS);
+    if (ring == NULL) return NULL;
+
+    pthread_mutex_lock(&rings_mutex);
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&rings_mutex);
+
+    pthread_setspecific(ring_key, ring);
+    thread_ring = ring;
+    return ring;
+}
+
+
+int log_enabled(LogLevel level) {
+    return (int)level >= atomic_load_explicit(&log_level, memory_order_relaxed);
+}
+
+void log_event(LogLevel level, LogEvent event, int client_num, int task_id, long long value,
+               const char* text, size_t text_length) {
+    if ((int)level < atomic_load_explicit(&log_level, memory_order_relaxed)) return;
+
+    LogRing* ring = thread_ring ? thread_ring : register_thread_ring();
+    if (ring == NULL) return;
+
+    //the writer only ever moves head forward, so a stale head at worst reports full too early
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head > ring->mask) {
+        //a burst outran the writer: continue in a larger ring rather than lose records
+        LogRing* larger = ring->mask + 1 < LOG_RING_MAX_RECORDS ? allocate_ring(2 * (ring->mask + 1)) : NULL;
+        if (larger == NULL) {
+            atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+            return;
+        }
+        pthread_setspecific(ring_key, larger);
+        thread_ring = larger;
+        atomic_store_explicit(&ring->successor, larger, memory_order_release);
+        ring = larger;
+        tail = head = 0;
+    }
+
+    LogRecord* record = &ring->records[tail & ring->mask];
+    record->time_us = clock_us(CLOCK_MONOTONIC);
+    record->value = value;
+    record->client_num = client_num;
+    record->task_id = task_id;
+    record->level = (uint8_t)level;
+    record->event = (uint8_t)event;
+    record->heap_text = NULL;
+    if (text_length > LOG_INLINE_TEXT) {
+        record->heap_text = (char*)malloc(text_length);
+        if (record->heap_text != NULL) memcpy(record->heap_text, text, text_length);
+        else text_length = LOG_INLINE_TEXT;
+    }
+    if (record->heap_text == NULL && text_length > 0) memcpy(record->text, text, text_length);
+    record->text_length = (uint32_t)text_length;
+
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+
+//write out everything gathered so far
+static void output_flush() {
+    struct iovec* iov = output.iov;
+    int count = output.iov_count;
+    while (count > 0) {
+        ssize_t written = writev(log_fd, iov, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            break; //nowhere to report it; the log is lost, the server goes on
+        }
+        //skip what the kernel took, resume inside a partly written segment
+        while (count > 0 && (size_t)written >= iov->iov_len) {
+            written -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + written;
+            iov->iov_len -= (size_t)written;
+        }
+    }
+    output.iov_count = 0;
+    output.used = 0;
+}
+
+//add bytes that stay valid until the end of the pass
+static void output_ref(const char* bytes, size_t length) {
+    if (length == 0) return;
+    if (output.iov_count == LOG_IOV_MAX) output_flush();
+    output.iov[output.iov_count].iov_base = (void*)bytes;
+    output.iov[output.iov_count].iov_len = length;
+    output.iov_count++;
+}
+
+//the scratch bytes [used, used + length) were just filled: extend the last segment or start one
+static void output_commit(size_t length) {
+    char* start = output.scratch + output.used;
+    struct iovec* last = output.iov_count ? &output.iov[output.iov_count - 1] : NULL;
+    if (last != NULL && (char*)last->iov_base + last->iov_len == start) {
+        last->iov_len += length;
+    } else {
+        output_ref(start, length);
+    }
+    output.used += length;
+}
+
+static void output_copy(const char* bytes, size_t length) {
+    while (length > 0) {
+        if (output.used == LOG_SCRATCH_BYTES || output.iov_count == LOG_IOV_MAX) output_flush();
+        size_t room = LOG_SCRATCH_BYTES - output.used;
+        size_t n = length < room ? length : room;
+        memcpy(output.scratch + output.used, bytes, n);
+        output_commit(n);
+        bytes += n;
+        length -= n;
+    }
+}
+
+__attribute__((format(printf, 1, 2)))
+static void output_printf(const char* format, ...) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (output.iov_count == LOG_IOV_MAX) output_flush();
+        size_t room = LOG_SCRATCH_BYTES - output.used;
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(output.scratch + output.used, room, format, args);
+        va_end(args);
+        if (n < 0) return;
+        if ((size_t)n < room) {
+            output_commit((size_t)n);
+            return;
+        }
+        output_flush();
+    }
+}
+
+//JSON string body: quotes, backslashes and control bytes escaped
+static void output_json_string(const char* text, size_t length) {
+    size_t start = 0;
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 0x20 && c != '"' && c != '\\') continue;
+        output_copy(text + start, i - start);
+        if (c == '"' || c == '\\') {
+            char escaped[2] = { '\\', (char)c };
+            output_copy(escaped, 2);
+        } else {
+            output_printf("\\u%04x", c);
+        }
+        start = i + 1;
+    }
+    output_copy(text + start, length - start);
+}
+
+
+static const char* level_name(int level) {
+    switch (level) {
+        case LOG_LEVEL_DEBUG: return "debug";
+        case LOG_LEVEL_INFO: return "info";
+        case LOG_LEVEL_WARN: return "warn";
+        default: return "error";
+    }
+}
+
+static const char* event_name(int event) {
+    switch (event) {
+        case LOG_EVENT_CONNECTED: return "connected";
+        case LOG_EVENT_COMMAND: return "command";
+        case LOG_EVENT_BYTES_SENT: return "bytes_sent";
+        case LOG_EVENT_TASK_STATE: return "task_state";
+        case LOG_EVENT_SCHEDULE: return "schedule";
+        default: return "message";
+    }
+}
+
+static const char* state_color(const char* state, size_t length) {
+    if (length == 7 && memcmp(state, "created", 7) == 0) return COLOR_CYAN;
+    if (length == 7 && memcmp(state, "started", 7) == 0) return COLOR_GREEN;
+    if (length == 7 && memcmp(state, "waiting", 7) == 0) return COLOR_YELLOW;
+    if (length == 7 && memcmp(state, "running", 7) == 0) return COLOR_MAGENTA;
+    if (length == 5 && memcmp(state, "ended", 5) == 0) return COLOR_RED;
+    return COLOR_RESET;
+}
+
+//a MESSAGE's text is tag '\0' message
+static void split_message(const char* text, size_t length, size_t* tag_length, const char** message,
+                          size_t* message_length) {
+    const char* nul = memchr(text, '\0', length);
+    *tag_length = nul ? (size_t)(nul - text) : length;
+    *message = nul ? nul + 1 : text + length;
+    *message_length = length - (size_t)(*message - text);
+}
+
+static void format_text(const LogRecord* record, const char* text) {
+    size_t length = record->text_length;
+    switch (record->event) {
+        case LOG_EVENT_CONNECTED:
+            output_printf("[%d]<<< client connected\n", record->client_num);
+            break;
+        case LOG_EVENT_COMMAND:
+            output_printf("[%d]>>> ", record->client_num);
+            output_ref(text, length);
+            output_copy("\n", 1);
+            break;
+        case LOG_EVENT_BYTES_SENT:
+            output_printf("[%d]<<< %lld bytes sent\n", record->client_num, (long long)record->value);
+            break;
+        case LOG_EVENT_TASK_STATE:
+            //shell commands show -1 for burst time, programs show remaining seconds (ms resolution)
+            output_printf("[%d]--- %s%.*s%s ", record->client_num, state_color(text, length), (int)length,
+                          text, COLOR_RESET);
+            if (record->value < 0) {
+                output_printf("(-1)\n");
+            } else {
+                output_printf("(%lld.%03lld)\n", (long long)record->value / 1000000,
+                              ((long long)record->value % 1000000) / 1000);
+            }
+            break;
+        case LOG_EVENT_SCHEDULE:
+            output_printf("\n%s", COLOR_BLUE);
+            output_ref(text, length);
+            output_printf("%s\n", COLOR_RESET);
+            break;
+        default: {
+            size_t tag_length, message_length;
+            const char* message;
+            split_message(text, length, &tag_length, &message, &message_length);
+            LogColor color = record->value > 0 && record->value < LOG_COLOR_COUNT ? (LogColor)record->value
+                                                                                  : LOG_COLOR_NONE;
+            output_printf("%s[%.*s]%s ", MESSAGE_COLORS[color], (int)tag_length, text, COLOR_RESET);
+            output_ref(message, message_length);
+            output_copy("\n", 1);
+            break;
+        }
+    }
+}
+
+static void format_json(const LogRecord* record, const char* text) {
+    size_t length = record->text_length;
+    output_printf("{\"time_us\":%lld,\"level\":\"%s\",\"event\":\"%s\",\"client\":%d",
+                  (long long)record->time_us + wall_offset_us, level_name(record->level),
+                  event_name(record->event), record->client_num);
+    if (record->task_id != 0) output_printf(",\"task\":%d", record->task_id);
+    switch (record->event) {
+        case LOG_EVENT_COMMAND:
+            output_copy(",\"command\":\"", 12);
+            output_json_string(text, length);
+            output_copy("\"", 1);
+            break;
+        case LOG_EVENT_BYTES_SENT:
+            output_printf(",\"bytes\":%lld", (long long)record->value);
+            break;
+        case LOG_EVENT_TASK_STATE:
+            output_copy(",\"state\":\"", 10);
+            output_json_string(text, length);
+            output_printf("\",\"remaining_us\":%lld", (long long)record->value);
+            break;
+        case LOG_EVENT_SCHEDULE:
+            output_copy(",\"order\":\"", 10);
+            output_json_string(text, length);
+            output_copy("\"", 1);
+            break;
+        case LOG_EVENT_MESSAGE: {
+            size_t tag_length, message_length;
+            const char* message;
+            split_message(text, length, &tag_length, &message, &message_length);
+            output_copy(",\"tag\":\"", 8);
+            output_json_string(text, tag_length);
+            output_copy("\",\"message\":\"", 13);
+            output_json_string(message, message_length);
+            output_copy("\"", 1);
+            break;
+        }
+        default:
+            break;
+    }
+    output_copy("}\n", 2);
+}
+
+static void format_binary(const LogRecord* record, const char* text) {
+    LogBinaryRecord header;
+    memset(&header, 0, sizeof(header));
+    header.length = (uint32_t)sizeof(header) + record->text_length;
+    header.level = record->level;
+    header.event = record->event;
+    header.client_num = record->client_num;
+    header.task_id = record->task_id;
+    header.time_us = record->time_us + wall_offset_us;
+    header.value = record->value;
+    output_copy((const char*)&header, sizeof(header));
+    output_ref(text, record->text_length);
+}
+
+static void format_record(const LogRecord* record) {
+    const char* text = record->heap_text ? record->heap_text : record->text;
+    if (log_format == LOG_FORMAT_JSON) format_json(record, text);
+    else if (log_format == LOG_FORMAT_BINARY) format_binary(record, text);
+    else format_text(record, text);
+}
+
+//order by time; records of one thread keep their ring order (they sit in batch in that order)
+static int compare_records(const void* a, const void* b) {
+    const LogRecord* first = *(const LogRecord* const*)a;
+    const LogRecord* second = *(const LogRecord* const*)b;
+    if (first->time_us != second->time_us) return first->time_us < second->time_us ? -1 : 1;
+    return first < second ? -1 : (first > second);
+}
+
+//move what the rings hold into batch; frees drained rings of exited threads
+//caller holds writer_mutex
+static int collect(unsigned long long* dropped) {
+    int count = 0;
+    pthread_mutex_lock(&rings_mutex);
+    LogRing** link = &rings;
+    while (*link != NULL) {
+        LogRing* ring = *link;
+        //the thread wrote its last record to this ring before it published the successor
+        int orphaned = atomic_load_explicit(&ring->orphaned, memory_order_acquire);
+        LogRing* successor = atomic_load_explicit(&ring->successor, memory_order_acquire);
+        size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        while (head != tail && count < LOG_BATCH_RECORDS) {
+            batch[count++] = ring->records[head & ring->mask];
+            head++;
+        }
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        *dropped += atomic_exchange_explicit(&ring->dropped, 0, memory_order_relaxed);
+
+        if (successor != NULL && head == tail) {
+            //drained and abandoned: the successor takes its place in the list
+            successor->next = ring->next;
+            *link = successor;
+            free(ring);
+        } else if (orphaned && head == tail) {
+            *link = ring->next;
+            free(ring);
+        } else {
+            link = &ring->next;
+        }
+    }
+    pthread_mutex_unlock(&rings_mutex);
+    return count;
+}
+
+//one writer pass; returns the records written. Caller holds writer_mutex
+static int write_pass() {
+    unsigned long long dropped = 0;
+    int count = collect(&dropped);
+    if (count == 0 && dropped == 0) return 0;
+
+    for (int i = 0; i < count; i++) order[i] = &batch[i];
+    qsort(order, (size_t)count, sizeof(LogRecord*), compare_records);
+    for (int i = 0; i < count; i++) format_record(order[i]);
+
+    if (dropped > 0) {
+        atomic_fetch_add(&total_dropped, dropped);
+        char text[64];
+        int n = snprintf(text, sizeof(text), "LOG%c%llu records dropped (log ring full)", '\0', dropped);
+        LogRecord notice;
+        memset(&notice, 0, sizeof(notice));
+        notice.time_us = clock_us(CLOCK_MONOTONIC);
+        notice.value = LOG_COLOR_YELLOW;
+        notice.level = LOG_LEVEL_WARN;
+        notice.event = LOG_EVENT_MESSAGE;
+        notice.text_length = (uint32_t)n;
+        memcpy(notice.text, text, (size_t)n);
+        format_record(&notice);
+    }
+    output_flush();
+
+    for (int i = 0; i < count; i++) free(batch[i].heap_text);
+    return count + (dropped > 0);
+}
+
+static void* writer_main(void* arg) {
+    (void)arg;
+    long sleep_us = LOG_IDLE_SLEEP_MIN_US;
+    while (atomic_load(&writer_running)) {
+        pthread_mutex_lock(&writer_mutex);
+        int written = write_pass();
+        pthread_mutex_unlock(&writer_mutex);
+
+        //a full batch means a backlog: keep going. Otherwise let records pile up for the
+        //next writev, and back off further while the log is quiet. Producers never wake the
+        //writer (on a busy CPU that would preempt them); a burst grows the thread's ring instead
+        if (written >= LOG_BATCH_RECORDS) continue;
+        if (written > 0) sleep_us = LOG_IDLE_SLEEP_MIN_US;
+        struct timespec pause = { 0, sleep_us * 1000 };
+        nanosleep(&pause, NULL);
+        if (written == 0 && sleep_us < LOG_IDLE_SLEEP_MAX_US) sleep_us *= 2;
+    }
+    return NULL;
+}
+
+
+int logger_start(LogLevel level, LogFormat format, int fd) {
+    atomic_store(&log_level, (int)level);
+    log_format = format;
+    log_fd = fd;
+    wall_offset_us = clock_us(CLOCK_REALTIME) - clock_us(CLOCK_MONOTONIC);
+
+    atomic_store(&writer_running, 1);
+    if (pthread_create(&writer_thread, NULL, writer_main, NULL) != 0) {
+        atomic_store(&writer_running, 0);
+        return -1;
+    }
+    return 0;
+}
+
+void logger_stop() {
+    if (atomic_exchange(&writer_running, 0)) {
+        pthread_join(writer_thread, NULL);
+    }
+    logger_flush();
+}
+
+void logger_flush() {
+    pthread_mutex_lock(&writer_mutex);
+    while (write_pass() > 0) {
+    }
+    pthread_mutex_unlock(&writer_mutex);
+}
+
+unsigned long long logger_dropped() {
+    return atomic_load(&total_dropped);
+}
+
+int log_level_parse(const char* name, LogLevel* level) {
+    static const char* names[] = { "debug", "info", "warn", "error", "off" };
+    for (int i = 0; i <= LOG_LEVEL_OFF; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *level = (LogLevel)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int log_format_parse(const char* name, LogFormat* format) {
+    if (strcmp(name, "text") == 0) *format = LOG_FORMAT_TEXT;
+    else if (strcmp(name, "json") == 0) *format = LOG_FORMAT_JSON;
+    else if (strcmp(name, "binary") == 0) *format = LOG_FORMAT_BINARY;
+    else return -1;
+    return 0;
+}
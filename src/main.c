@@ -5,7 +5,8 @@
 #include "executor.h"
 
 int main() {
-    char line[1024];
+    char *line = NULL;      //grown by getline, so long generated command lines fit
+    size_t capacity = 0;
 
     while (1) {
         //print clean shell prompt
@@ -13,7 +14,7 @@ int main() {
         fflush(stdout);
 
         //read a line from stdin
-        if (!fgets(line, sizeof(line), stdin)) {
+        if (getline(&line, &capacity, stdin) < 0) {
             printf("\n");  //handle Ctrl+D
             break;
         }
@@ -43,5 +44,6 @@ int main() {
         free_command_list(cmdlist);
     }
 
+    free(line);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,370 @@
+// src/metrics.c - Scheduler metrics: lock-free counters and log-linear latency histograms
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../include/metrics.h"
+#include "../include/scheduler.h"
+#include "../include/shellpool.h"
+#include "../include/cmdcache.h"
+#include "../include/logger.h"
+#include "../include/policy.h"
+#include "../include/fairshare.h"
+
+#define METRICS_PREFIX "myshell_"
+
+SchedulerMetrics scheduler_metrics;
+
+static const char* type_names[METRICS_TYPES] = { "shell", "program" };
+
+//Prometheus bucket bounds ("le") for the time histograms, in microseconds
+static const long long time_bounds_us[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000
+};
+static const long long percent_bounds[] = { 10, 25, 50, 75, 90, 100 };
+static const long long depth_bounds[] = { 0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024 };
+
+#define BOUNDS(array) (array), (int)(sizeof(array) / sizeof((array)[0]))
+
+//growing text buffer for rendering
+typedef struct {
+    char* text;
+    size_t length, capacity;
+    int failed;
+} Text;
+
+
+__attribute__((format(printf, 2, 3)))
+static void text_printf(Text* text, const char* format, ...) {
+    if (text->failed) return;
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        size_t room = text->capacity - text->length;
+        int n = vsnprintf(text->text ? text->text + text->length : NULL, room, format, args);
+        va_end(args);
+        if (n < 0) {
+            text->failed = 1;
+            return;
+        }
+        if ((size_t)n < room) {
+            text->length += (size_t)n;
+            return;
+        }
+        size_t capacity = text->capacity ? text->capacity * 2 : 4096;
+        while (capacity < text->length + (size_t)n + 1) capacity *= 2;
+        char* grown = (char*)realloc(text->text, capacity);
+        if (grown == NULL) {
+            text->failed = 1;
+            return;
+        }
+        text->text = grown;
+        text->capacity = capacity;
+    }
+}
+
+//one Prometheus histogram; scale divides the recorded values into the exported unit
+static void prometheus_histogram(Text* text, const char* name, const char* labels, Histogram* histogram,
+                                 const long long* bounds, int bound_count, double scale) {
+    const char* separator = labels[0] ? "," : "";
+    for (int i = 0; i < bound_count; i++) {
+        text_printf(text, METRICS_PREFIX "%s_bucket{%s%sle=\"%g\"} %llu\n", name, labels, separator,
+                    (double)bounds[i] / scale, histogram_count_below(histogram, bounds[i]));
+    }
+    unsigned long long count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    text_printf(text, METRICS_PREFIX "%s_bucket{%s%sle=\"+Inf\"} %llu\n", name, labels, separator, count);
+    const char* label_open = labels[0] ? "{" : "";
+    const char* label_close = labels[0] ? "}" : "";
+    text_printf(text, METRICS_PREFIX "%s_sum%s%s%s %g\n", name, label_open, labels, label_close,
+                (double)atomic_load_explicit(&histogram->sum, memory_order_relaxed) / scale);
+    text_printf(text, METRICS_PREFIX "%s_count%s%s%s %llu\n", name, label_open, labels, label_close, count);
+}
+
+static void prometheus_typed_histogram(Text* text, const char* name, const char* help, Histogram* histograms) {
+    text_printf(text, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s histogram\n", name, help, name);
+    for (int t = 0; t < METRICS_TYPES; t++) {
+        char labels[32];
+        snprintf(labels, sizeof(labels), "type=\"%s\"", type_names[t]);
+        prometheus_histogram(text, name, labels, &histograms[t], BOUNDS(time_bounds_us), 1e6);
+    }
+}
+
+static void prometheus_counter(Text* text, const char* name, const char* help, unsigned long long value) {
+    text_printf(text, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s counter\n"
+                METRICS_PREFIX "%s %llu\n", name, help, name, name, value);
+}
+
+static void prometheus_gauge(Text* text, const char* name, const char* help, long long value) {
+    text_printf(text, "# HELP " METRICS_PREFIX "%s %s\n# TYPE " METRICS_PREFIX "%s gauge\n"
+                METRICS_PREFIX "%s %lld\n", name, help, name, name, value);
+}
+
+static void render_prometheus(Text* text) {
+    SchedulerMetrics* m = &scheduler_metrics;
+
+    prometheus_typed_histogram(text, "queue_wait_seconds", "Time from runnable to dispatched, per dispatch.",
+                               m->queue_wait_us);
+    prometheus_typed_histogram(text, "response_seconds", "Time from created to first dispatched.", m->response_us);
+    prometheus_typed_histogram(text, "turnaround_seconds", "Time from created to completed.", m->turnaround_us);
+
+    text_printf(text, "# HELP " METRICS_PREFIX "quantum_utilisation_ratio Share of its quantum a program slice used.\n"
+                "# TYPE " METRICS_PREFIX "quantum_utilisation_ratio histogram\n");
+    prometheus_histogram(text, "quantum_utilisation_ratio", "", &m->quantum_use_percent, BOUNDS(percent_bounds), 100);
+    text_printf(text, "# HELP " METRICS_PREFIX "dispatch_queue_depth Tasks left in the run queue at each program dispatch.\n"
+                "# TYPE " METRICS_PREFIX "dispatch_queue_depth histogram\n");
+    prometheus_histogram(text, "dispatch_queue_depth", "", &m->queue_depth, BOUNDS(depth_bounds), 1);
+
+    text_printf(text, "# HELP " METRICS_PREFIX "tasks_submitted_total Tasks accepted by a queue.\n"
+                "# TYPE " METRICS_PREFIX "tasks_submitted_total counter\n");
+    for (int t = 0; t < METRICS_TYPES; t++) {
+        text_printf(text, METRICS_PREFIX "tasks_submitted_total{type=\"%s\"} %llu\n", type_names[t],
+                    atomic_load(&m->submitted[t]));
+    }
+    text_printf(text, "# HELP " METRICS_PREFIX "tasks_completed_total Tasks run to completion.\n"
+                "# TYPE " METRICS_PREFIX "tasks_completed_total counter\n");
+    for (int t = 0; t < METRICS_TYPES; t++) {
+        text_printf(text, METRICS_PREFIX "tasks_completed_total{type=\"%s\"} %llu\n", type_names[t],
+                    atomic_load(&m->completed[t]));
+    }
+    prometheus_counter(text, "tasks_rejected_total", "Tasks refused because a queue was full.", atomic_load(&m->rejected));
+    prometheus_counter(text, "slices_total", "Program quanta started.", atomic_load(&m->slices));
+    prometheus_counter(text, "preemptions_total", "Program slices that ended before the program did.",
+                       atomic_load(&m->preemptions));
+    text_printf(text, "# HELP " METRICS_PREFIX "deadlines_total Tasks with a deadline, by whether they completed by it.\n"
+                "# TYPE " METRICS_PREFIX "deadlines_total counter\n"
+                METRICS_PREFIX "deadlines_total{result=\"met\"} %llu\n"
+                METRICS_PREFIX "deadlines_total{result=\"missed\"} %llu\n",
+                atomic_load(&m->deadlines_met), atomic_load(&m->deadlines_missed));
+
+    prometheus_gauge(text, "tasks_in_system", "Tasks queued or running on the scheduler workers.",
+                     scheduler_tasks_in_system());
+    prometheus_gauge(text, "shell_queue_depth", "Shell commands waiting for an executor thread.", shell_pool_pending());
+    text_printf(text, "# HELP " METRICS_PREFIX "run_queue_depth Tasks in a worker's run queue and inbox.\n"
+                "# TYPE " METRICS_PREFIX "run_queue_depth gauge\n");
+    for (int w = 0; w < scheduler_worker_count; w++) {
+        text_printf(text, METRICS_PREFIX "run_queue_depth{worker=\"%d\"} %d\n", w, scheduler_worker_depth(w));
+    }
+
+    //per group only: client numbers are not stable enough to be label values
+    FairShareUsage groups[FAIR_SHARE_MAX_GROUPS];
+    int group_count = fair_share_groups(groups, FAIR_SHARE_MAX_GROUPS);
+    text_printf(text, "# HELP " METRICS_PREFIX "group_run_seconds_total Scheduler time given to a group's clients.\n"
+                "# TYPE " METRICS_PREFIX "group_run_seconds_total counter\n");
+    for (int g = 0; g < group_count; g++) {
+        text_printf(text, METRICS_PREFIX "group_run_seconds_total{group=\"%s\"} %g\n", groups[g].group,
+                    (double)groups[g].run_us / USEC_PER_SEC);
+    }
+    text_printf(text, "# HELP " METRICS_PREFIX "group_tasks_completed_total Tasks of a group's clients run to completion.\n"
+                "# TYPE " METRICS_PREFIX "group_tasks_completed_total counter\n");
+    for (int g = 0; g < group_count; g++) {
+        text_printf(text, METRICS_PREFIX "group_tasks_completed_total{group=\"%s\"} %llu\n", groups[g].group,
+                    groups[g].completed);
+    }
+    text_printf(text, "# HELP " METRICS_PREFIX "group_active_clients Clients of a group with tasks in the system.\n"
+                "# TYPE " METRICS_PREFIX "group_active_clients gauge\n");
+    for (int g = 0; g < group_count; g++) {
+        text_printf(text, METRICS_PREFIX "group_active_clients{group=\"%s\"} %d\n", groups[g].group, groups[g].active);
+    }
+
+    CommandCacheStats cache;
+    command_cache_stats(&cache);
+    prometheus_counter(text, "command_cache_hits_total", "Commands answered from the parse cache.", cache.hits);
+    prometheus_counter(text, "command_cache_misses_total", "Commands that had to be classified or parsed.", cache.misses);
+    prometheus_counter(text, "command_cache_evictions_total", "Parse cache entries evicted.", cache.evictions);
+    prometheus_counter(text, "log_records_dropped_total", "Log records lost to full log rings.", logger_dropped());
+}
+
+//one share row: weight, activity, scheduler time and its part of all time given out
+static void share_row(Text* text, const char* name, const FairShareUsage* usage, long long total_run_us) {
+    text_printf(text, "  %-22s %9d %9d %10.3f %9.1f%% %10llu\n", name, usage->weight, usage->active,
+                (double)usage->run_us / USEC_PER_SEC, total_run_us > 0 ? 100.0 * usage->run_us / total_run_us : 0.0,
+                usage->completed);
+}
+
+static void render_shares(Text* text) {
+    FairShareUsage groups[FAIR_SHARE_MAX_GROUPS];
+    FairShareUsage clients[FAIR_SHARE_REPORT_CLIENTS];
+    char name[FAIR_SHARE_NAME_MAX + 32]; //"client <n> (<group>)"
+    int client_count;
+    int group_count = fair_share_groups(groups, FAIR_SHARE_MAX_GROUPS);
+    int listed = fair_share_top_clients(clients, FAIR_SHARE_REPORT_CLIENTS, &client_count);
+    long long total_run_us = fair_share_total_run_us();
+
+    text_printf(text, "  %-22s %9s %9s %10s %10s %10s\n", "shares", "weight", "active", "run (s)", "share",
+                "completed");
+    for (int g = 0; g < group_count; g++) {
+        snprintf(name, sizeof(name), "group %.*s", FAIR_SHARE_NAME_MAX, groups[g].group);
+        share_row(text, name, &groups[g], total_run_us);
+    }
+    for (int c = 0; c < listed; c++) {
+        snprintf(name, sizeof(name), "client %d (%.*s)", clients[c].client_num, FAIR_SHARE_NAME_MAX,
+                 clients[c].group);
+        share_row(text, name, &clients[c], total_run_us);
+    }
+    if (client_count > listed) text_printf(text, "  (%d more clients)\n", client_count - listed);
+}
+
+//one summary row; values are microseconds shown as milliseconds unless unit_ms is 0
+static void summary_row(Text* text, const char* name, Histogram* histogram, int unit_ms) {
+    static const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    unsigned long long count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    text_printf(text, "  %-22s %9llu", name, count);
+    for (int i = 0; i < 4; i++) {
+        long long value = histogram_quantile(histogram, quantiles[i]);
+        if (unit_ms) text_printf(text, " %10.3f", (double)value / 1000.0);
+        else text_printf(text, " %10lld", value);
+    }
+    long long max = (long long)atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    if (unit_ms) text_printf(text, " %10.3f\n", (double)max / 1000.0);
+    else text_printf(text, " %10lld\n", max);
+}
+
+static void render_summary(Text* text) {
+    SchedulerMetrics* m = &scheduler_metrics;
+    char name[32];
+
+    text_printf(text, "tasks: shell %llu submitted, %llu completed; program %llu submitted, %llu completed; "
+                "%llu rejected\n", atomic_load(&m->submitted[0]), atomic_load(&m->completed[0]),
+                atomic_load(&m->submitted[1]), atomic_load(&m->completed[1]), atomic_load(&m->rejected));
+    text_printf(text, "programs: %llu slices, %llu preemptions (policy %s)\n", atomic_load(&m->slices),
+                atomic_load(&m->preemptions), scheduler_policy->name);
+    text_printf(text, "deadlines: %llu met, %llu missed\n", atomic_load(&m->deadlines_met),
+                atomic_load(&m->deadlines_missed));
+    text_printf(text, "queues: %d tasks in system, %d shell commands waiting, run queues", scheduler_tasks_in_system(),
+                shell_pool_pending());
+    for (int w = 0; w < scheduler_worker_count; w++) {
+        text_printf(text, " %d", scheduler_worker_depth(w));
+    }
+    text_printf(text, "\n");
+
+    text_printf(text, "  %-22s %9s %10s %10s %10s %10s %10s\n", "latency (ms)", "count", "p50", "p90", "p99",
+                "p99.9", "max");
+    for (int t = 0; t < METRICS_TYPES; t++) {
+        snprintf(name, sizeof(name), "queue wait %s", type_names[t]);
+        summary_row(text, name, &m->queue_wait_us[t], 1);
+        snprintf(name, sizeof(name), "response %s", type_names[t]);
+        summary_row(text, name, &m->response_us[t], 1);
+        snprintf(name, sizeof(name), "turnaround %s", type_names[t]);
+        summary_row(text, name, &m->turnaround_us[t], 1);
+    }
+    summary_row(text, "quantum use (%)", &m->quantum_use_percent, 0);
+    summary_row(text, "dispatch queue depth", &m->queue_depth, 0);
+
+    CommandCacheStats cache;
+    render_shares(text);
+
+    command_cache_stats(&cache);
+    text_printf(text, "command cache: %llu hits, %llu misses, %llu evictions, %d/%d entries\n", cache.hits,
+                cache.misses, cache.evictions, cache.entries, cache.capacity);
+    text_printf(text, "log: %llu records dropped\n", logger_dropped());
+}
+
+char* metrics_render(MetricsFormat format, size_t* length) {
+    Text text = { NULL, 0, 0, 0 };
+    if (format == METRICS_PROMETHEUS) render_prometheus(&text);
+    else render_summary(&text);
+    if (text.failed) {
+        free(text.text);
+        return NULL;
+    }
+    *length = text.length;
+    return text.text;
+}
+
+
+static int send_all(int fd, const char* bytes, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, bytes, length, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        bytes += sent;
+        length -= (size_t)sent;
+    }
+    return 0;
+}
+
+//answer one scrape: any GET of /metrics (or /) gets the text, everything else 404
+static void serve_scrape(int client) {
+    char request[METRICS_REQUEST_MAX + 1];
+    size_t received = 0;
+    while (received < METRICS_REQUEST_MAX) {
+        ssize_t n = recv(client, request + received, METRICS_REQUEST_MAX - received, 0);
+        if (n <= 0) break;
+        received += (size_t)n;
+        request[received] = '\0';
+        if (strstr(request, "\r\n\r\n") != NULL || strstr(request, "\n\n") != NULL) break;
+    }
+    request[received] = '\0';
+
+    int found = strncmp(request, "GET /metrics", 12) == 0 || strncmp(request, "GET / ", 6) == 0;
+    size_t length = 0;
+    char* body = found ? metrics_render(METRICS_PROMETHEUS, &length) : NULL;
+    char header[160];
+    int header_length;
+    if (body != NULL) {
+        header_length = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+                                 "Content-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n\r\n", length);
+    } else {
+        header_length = snprintf(header, sizeof(header), "HTTP/1.0 %s\r\nContent-Length: 0\r\n\r\n",
+                                 found ? "500 Internal Server Error" : "404 Not Found");
+    }
+    if (send_all(client, header, (size_t)header_length) == 0 && body != NULL) {
+        send_all(client, body, length);
+    }
+    free(body);
+}
+
+static void* metrics_endpoint_main(void* arg) {
+    int listener = (int)(long)arg;
+    while (1) {
+        int client = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("Metrics accept failed");
+            continue;
+        }
+        //a stalled scraper must not hold the endpoint
+        struct timeval timeout = { 2, 0 };
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        serve_scrape(client);
+        close(client);
+    }
+    return NULL;
+}
+
+int start_metrics_endpoint(int port) {
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) return -1;
+    int opt = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    //local only: the numbers are for the operator's scraper, not for clients
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short)port);
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 16) < 0) {
+        close(listener);
+        return -1;
+    }
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, metrics_endpoint_main, (void*)(long)listener) != 0) {
+        close(listener);
+        return -1;
+    }
+    pthread_detach(thread);
+    return 0;
+}
@@ -0,0 +1,74 @@
+// src/mpscring.c - Bounded lock-free multi-producer / single-consumer ring of pointers
+#include <stdlib.h>
+#include <stdint.h>
+#include "../include/mpscring.h"
+
+
+int mpsc_ring_init(MpscRing* ring, size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+
+    ring->slots = (MpscSlot*)malloc(size * sizeof(MpscSlot));
+    if (ring->slots == NULL) return -1;
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&ring->slots[i].sequence, i);
+        ring->slots[i].item = NULL;
+    }
+    ring->mask = size - 1;
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->head, 0);
+    return 0;
+}
+
+void mpsc_ring_destroy(MpscRing* ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+int mpsc_ring_push(MpscRing* ring, void* item) {
+    size_t position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    MpscSlot* slot;
+    for (;;) {
+        slot = &ring->slots[position & ring->mask];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t lag = (intptr_t)sequence - (intptr_t)position;
+        if (lag == 0) {
+            //the slot is free for this position: claim it (a failed CAS reloads position)
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (lag < 0) {
+            //the consumer has not freed this slot from the previous lap yet
+            return -1;
+        } else {
+            //another producer took this position
+            position = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+
+    slot->item = item;
+    atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+    return 0;
+}
+
+size_t mpsc_ring_drain(MpscRing* ring, void** items, size_t max) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t count = 0;
+    while (count < max) {
+        MpscSlot* slot = &ring->slots[head & ring->mask];
+        if (atomic_load_explicit(&slot->sequence, memory_order_acquire) != head + 1) break;
+        items[count++] = slot->item;
+        //hand the slot to the producer of the next lap
+        atomic_store_explicit(&slot->sequence, head + ring->mask + 1, memory_order_release);
+        head++;
+    }
+    atomic_store_explicit(&ring->head, head, memory_order_relaxed);
+    return count;
+}
+
+size_t mpsc_ring_size(MpscRing* ring) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    return tail > head ? tail - head : 0;
+}
@@ -3,10 +3,13 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <stdint.h>
 #include "../include/parser.h"
+#include "../include/tokenize.h"
 
-#define MAX_TOKENS 64 //define max number of arguments per command
-#define MAX_COMMANDS 32 //define max number of commands in a pipeline
+#define INITIAL_TOKENS 16 //argv slots per command before the first doubling
+#define INITIAL_COMMANDS 4 //pipeline stages before the first doubling
 
 // builtin echo command implementation
 void builtin_echo(char **argv) {
@@ -60,7 +63,18 @@ char *strip_quotes(char *token) {
 }
 
 
+//start a new, empty command; argv always stays NULL-terminated so free_command_list works mid-parse
+static int init_command(Command *cmd, int *argv_capacity) {
+    cmd->argv = malloc(INITIAL_TOKENS * sizeof(char *));
+    cmd->input_file = cmd->output_file = cmd->error_file = NULL; //initialize redirections
+    if (!cmd->argv) return -1;
+    cmd->argv[0] = NULL;
+    *argv_capacity = INITIAL_TOKENS;
+    return 0;
+}
+
 //parse input line into command list
+//argv arrays and the command array double when full, so a line with n words costs O(n)
 CommandList *parse_input(char *line) {
     if (!line) return NULL;
 
@@ -68,19 +82,30 @@ CommandList *parse_input(char *line) {
     if (!cmdlist) { perror("malloc"); return NULL; } // handle malloc failure
 
     cmdlist->count = 1; //at least one command by default
-    cmdlist->commands = malloc(MAX_COMMANDS * sizeof(Command));
+    int command_capacity = INITIAL_COMMANDS;
+    cmdlist->commands = malloc(command_capacity * sizeof(Command));
     if (!cmdlist->commands) { perror("malloc"); free(cmdlist); return NULL; }
 
     //Initialize first command
+    int argv_capacity;
     Command *cmd = &cmdlist->commands[0];
-    cmd->argv = malloc(MAX_TOKENS * sizeof(char *)); //allocate argv array
-    for (int k = 0; k < MAX_TOKENS; k++) cmd->argv[k] = NULL; //initialize argv to null
-    cmd->input_file = cmd->output_file = cmd->error_file = NULL; //initialize redirections
+    if (init_command(cmd, &argv_capacity) != 0) {
+        perror("malloc");
+        free_command_list(cmdlist);
+        return NULL;
+    }
+
+    //one scratch buffer for every token: no token can be longer than the line
+    size_t len = strlen(line);
+    char stack_buffer[1024];
+    char *buffer = len < sizeof(stack_buffer) ? stack_buffer : malloc(len + 1);
+    if (!buffer) { perror("malloc"); free_command_list(cmdlist); return NULL; }
 
      //argument index for current command
     int i = 0;
     int current_command = 0;
     char *p = line;
+    const char *error = NULL;
 
     while (*p) {
         while (*p && isspace(*p)) p++;
@@ -89,22 +114,25 @@ CommandList *parse_input(char *line) {
         //handle pipe
         if (*p == '|') {
             if (i == 0) {
-                fprintf(stderr, "Error: Empty command before or after pipe\n");
-                free_command_list(cmdlist);
-                return NULL;
+                error = "Error: Empty command before or after pipe\n";
+                break;
             }
-            cmd->argv[i] = NULL;
             current_command++;
-            if (current_command >= MAX_COMMANDS) {
-                fprintf(stderr, "Error: Too many commands in pipeline\n");
-                free_command_list(cmdlist);
-                return NULL;
+            if (current_command == command_capacity) {
+                Command *grown = realloc(cmdlist->commands, 2 * command_capacity * sizeof(Command));
+                if (!grown) { error = "Error: Out of memory\n"; current_command--; break; }
+                cmdlist->commands = grown;
+                command_capacity *= 2;
             }
             //initialize new command
             cmd = &cmdlist->commands[current_command];
-            cmd->argv = malloc(MAX_TOKENS * sizeof(char *));
-            for (int k = 0; k < MAX_TOKENS; k++) cmd->argv[k] = NULL;
-            cmd->input_file = cmd->output_file = cmd->error_file = NULL;
+            if (init_command(cmd, &argv_capacity) != 0) {
+                error = "Error: Out of memory\n";
+                free(cmd->argv);
+                current_command--;
+                break;
+            }
+            cmdlist->count = current_command + 1;
             i = 0;
             p++;
             continue;
@@ -119,25 +147,23 @@ CommandList *parse_input(char *line) {
         if (target) {
             while (*p && isspace(*p)) p++;
             if (!*p) {
-                fprintf(stderr, "Error: Missing file for redirection\n");
-                free_command_list(cmdlist);
-                return NULL;
+                error = "Error: Missing file for redirection\n";
+                break;
             }
-            char buffer[1024];  //temp buffer for filename
-            int j = 0;
-            while (*p && !isspace(*p) && *p != '|' && j < 1023) buffer[j++] = *p++;
+            size_t j = 0;
+            while (*p && !isspace(*p) && *p != '|') buffer[j++] = *p++;
             buffer[j] = '\0';
+            free(*target); //a repeated redirection replaces the earlier one
             *target = strdup(buffer);
             continue;
         }
 
         //handle normal arguments
-        char buffer[1024]; //buffer for normal argument
-        int j = 0;
+        size_t j = 0;
         while (*p && !isspace(*p) && *p != '|') {
             if (*p == '"' || *p == '\'') {
                 char quote = *p++;
-                while (*p && *p != quote && j < 1023) buffer[j++] = *p++;
+                while (*p && *p != quote) buffer[j++] = *p++;
                 if (*p == quote) p++;
             } else {
                 buffer[j++] = *p++;
@@ -146,15 +172,24 @@ CommandList *parse_input(char *line) {
         buffer[j] = '\0';
         if (j == 0) continue;
 
+        //room for this token and the NULL terminator
+        if (i + 2 > argv_capacity) {
+            char **grown = realloc(cmd->argv, 2 * argv_capacity * sizeof(char *));
+            if (!grown) { error = "Error: Out of memory\n"; break; }
+            cmd->argv = grown;
+            argv_capacity *= 2;
+        }
         cmd->argv[i++] = strdup(buffer);
+        cmd->argv[i] = NULL;
     }
 
-    if (i == 0) {  //empty command at end
-        fprintf(stderr, "Error: Empty command at end of pipeline\n");
+    if (buffer != stack_buffer) free(buffer);
+    if (!error && i == 0) error = "Error: Empty command at end of pipeline\n"; //empty command at end
+    if (error) {
+        fprintf(stderr, "%s", error);
         free_command_list(cmdlist);
         return NULL;
     }
-    cmd->argv[i] = NULL;  //null terminate last argv
     cmdlist->count = current_command + 1;
 
     return cmdlist;
@@ -166,7 +201,7 @@ void free_command_list(CommandList *cmdlist) {
     for (int c = 0; c < cmdlist->count; c++) {
         Command cmd = cmdlist->commands[c];
         if (cmd.argv) {
-            for (int i = 0; i < MAX_TOKENS && cmd.argv[i]; i++)
+            for (int i = 0; cmd.argv[i]; i++)
                 free(cmd.argv[i]);
             free(cmd.argv);
         }
@@ -176,4 +211,130 @@ void free_command_list(CommandList *cmdlist) {
     }
     free(cmdlist->commands); //free command array
     free(cmdlist);  //free command list struct
-}
\ No newline at end of file
+}
+
+void parse_arena_init(ParseArena *arena, void *buffer, size_t size) {
+    arena->base = (char *)buffer;
+    arena->size = size;
+    arena->used = 0;
+}
+
+void parse_arena_reset(ParseArena *arena) {
+    arena->used = 0;
+}
+
+//bump-allocate size bytes aligned for pointers, NULL when the arena is full
+static void *arena_alloc(ParseArena *arena, size_t size) {
+    uintptr_t start = (uintptr_t)(arena->base + arena->used);
+    size_t padding = (size_t)((sizeof(void *) - start % sizeof(void *)) % sizeof(void *));
+    if (padding + size > arena->size - arena->used) return NULL;
+    void *block = arena->base + arena->used + padding;
+    arena->used += padding + size;
+    return block;
+}
+
+//upper bounds for sizing the arena: every '|' may start a command, and every run of
+//characters other than whitespace and '|' may be a word (quotes only merge runs)
+static void count_bounds(const char *line, size_t *len, size_t *commands, size_t *words) {
+    size_t pipes, runs;
+    *len = strlen(line);
+    scan_bounds(line, line + *len, &pipes, &runs);
+    *commands = pipes + 1;
+    *words = runs;
+}
+
+size_t parse_arena_bytes(const char *line) {
+    size_t len, commands, words;
+    count_bounds(line, &len, &commands, &words);
+    //list, commands, argv slots (words + one NULL per command), the copy, alignment slack
+    return sizeof(CommandList) + commands * sizeof(Command) +
+           (words + commands) * sizeof(char *) + len + 1 + 4 * sizeof(void *);
+}
+
+CommandList *parse_input_arena(ParseArena *arena, const char *line) {
+    if (!line) return NULL;
+
+    size_t len, max_commands, max_words;
+    count_bounds(line, &len, &max_commands, &max_words);
+
+    //one block each, carved once: no per-token or per-command allocation
+    CommandList *cmdlist = arena_alloc(arena, sizeof(CommandList));
+    Command *commands = cmdlist ? arena_alloc(arena, max_commands * sizeof(Command)) : NULL;
+    char **slots = commands ? arena_alloc(arena, (max_words + max_commands) * sizeof(char *)) : NULL;
+    char *out = slots ? arena_alloc(arena, len + 1) : NULL;
+    if (!out) { errno = ENOMEM; return NULL; }
+
+    //every command's argv is a run of slots ended by NULL, so the next one starts right after
+    cmdlist->commands = commands;
+    Command *cmd = &commands[0];
+    cmd->argv = slots;
+    cmd->input_file = cmd->output_file = cmd->error_file = NULL;
+    int i = 0;
+    int current_command = 0;
+    const char *p = line;
+    const char *end = line + len;
+
+    //tokens are unescaped into out; each takes at most its own bytes plus the separator after it
+    while (*p) {
+        while (*p && is_space(*p)) p++;
+        if (!*p) break;
+
+        //handle pipe
+        if (*p == '|') {
+            if (i == 0) { errno = EINVAL; return NULL; } //empty command before or after pipe
+            cmd->argv[i] = NULL;
+            current_command++;
+            cmd = &commands[current_command];
+            cmd->argv = &commands[current_command - 1].argv[i + 1];
+            cmd->input_file = cmd->output_file = cmd->error_file = NULL;
+            i = 0;
+            p++;
+            continue;
+        }
+
+        //handle redirection: the file name is taken verbatim up to whitespace or '|'
+        char **target = NULL;
+        if (*p == '<') { target = &cmd->input_file; p++; }
+        else if (*p == '>') { target = &cmd->output_file; p++; }
+        else if (*p == '2' && *(p+1) == '>') { target = &cmd->error_file; p+=2; }
+
+        if (target) {
+            while (*p && is_space(*p)) p++;
+            if (!*p) { errno = EINVAL; return NULL; } //missing file for redirection
+            *target = out;
+            size_t n = scan_field(p, end);
+            memcpy(out, p, n);
+            out += n;
+            p += n;
+            *out++ = '\0';
+            continue;
+        }
+
+        //handle normal arguments, dropping the quotes; plain stretches are copied a block at a time
+        char *token = out;
+        while (1) {
+            size_t n = scan_word(p, end);
+            memcpy(out, p, n);
+            out += n;
+            p += n;
+            if (*p != '"' && *p != '\'') break;
+
+            char quote = *p++;
+            const char *close = memchr(p, quote, (size_t)(end - p));
+            n = close ? (size_t)(close - p) : (size_t)(end - p);
+            memcpy(out, p, n);
+            out += n;
+            p += n;
+            if (close) p++;
+        }
+        if (out == token) continue;
+        *out++ = '\0';
+        cmd->argv[i++] = token;
+    }
+
+    if (i == 0) { errno = EINVAL; return NULL; } //empty command at end
+    cmd->argv[i] = NULL;  //null terminate last argv
+    cmdlist->count = current_command + 1;
+
+    return cmdlist;
+}
@@ -0,0 +1,265 @@
+// src/policy.c - Scheduling policies shared by the scheduler workers and the simulator
+#include <stdio.h>
+#include <string.h>
+#include "../include/policy.h"
+
+long long first_round_quantum_us = FIRST_ROUND_QUANTUM_US;
+long long default_quantum_us = DEFAULT_QUANTUM_US;
+
+
+//rr+sjrf: shortest remaining burst first
+static long long sjrf_queue_key(WaitingQueue* queue, Task* task) {
+    (void)queue;
+    return task->remaining_burst_us;
+}
+
+//a short first round lets new programs show their output quickly
+static long long rr_quantum_us(const WaitingQueue* queue, const Task* task) {
+    (void)queue;
+    return (task->round_number == 0) ? first_round_quantum_us : default_quantum_us;
+}
+
+//a job that will finish sooner takes the core
+static int sjrf_preempts(const Task* best, const Task* running) {
+    return best->remaining_burst_us > 0 && best->remaining_burst_us < running->remaining_burst_us;
+}
+
+const SchedPolicy policy_rr_sjrf = {
+    "rr-sjrf",
+    "round robin quanta, shortest remaining job first",
+    sjrf_queue_key,
+    rr_quantum_us,
+    sjrf_preempts,
+    NULL,
+    NULL,
+    1
+};
+
+
+//cfs: virtual runtime is run time scaled by the task's weight, so a task of twice the
+//weight advances half as fast and gets twice the share of the core
+static long long cfs_vruntime(const Task* task) {
+    return task->vruntime_base_us + task->run_time_us * TASK_DEFAULT_WEIGHT / task->weight;
+}
+
+//a task new to this queue (just created or stolen from a peer) starts at the queue's
+//virtual time, so it neither starves the others nor is owed the time it was away
+static long long cfs_queue_key(WaitingQueue* queue, Task* task) {
+    if (task->vruntime_queue != queue) {
+        task->vruntime_base_us = queue->min_vruntime_us - task->run_time_us * TASK_DEFAULT_WEIGHT / task->weight;
+        task->vruntime_queue = queue;
+    }
+    return cfs_vruntime(task);
+}
+
+//the default quantum is the period every runnable task gets a turn in
+static long long cfs_quantum_us(const WaitingQueue* queue, const Task* task) {
+    (void)task;
+    long long slice = default_quantum_us / (queue->count + 1);
+    return (slice < CFS_MIN_SLICE_US) ? CFS_MIN_SLICE_US : slice;
+}
+
+//only a clear vruntime lead preempts, so two tasks do not ping-pong the core
+static int cfs_preempts(const Task* best, const Task* running) {
+    return cfs_vruntime(best) + CFS_WAKEUP_GRANULARITY_US < cfs_vruntime(running);
+}
+
+//the queue's virtual time follows the smallest vruntime that ran
+static void cfs_on_select(WaitingQueue* queue, const Task* task) {
+    long long vruntime = cfs_vruntime(task);
+    if (vruntime > queue->min_vruntime_us) queue->min_vruntime_us = vruntime;
+}
+
+const SchedPolicy policy_cfs = {
+    "cfs",
+    "weighted fair share: smallest virtual runtime first, slices split the default quantum",
+    cfs_queue_key,
+    cfs_quantum_us,
+    cfs_preempts,
+    cfs_on_select,
+    NULL,
+    0
+};
+
+
+//mlfq: each level down doubles the time a task may use before it drops again
+static long long mlfq_allotment_us(int level) {
+    return first_round_quantum_us << level;
+}
+
+//top level first, FCFS within a level; a level is a delay on the time the task became
+//ready rather than a separate queue, so a demoted task still runs once it has waited
+//MLFQ_LEVEL_DELAY_US per level (aging instead of a periodic priority boost)
+static long long mlfq_queue_key(WaitingQueue* queue, Task* task) {
+    (void)queue;
+    return task->ready_us + task->level * MLFQ_LEVEL_DELAY_US;
+}
+
+//whatever is left of the level's allotment
+static long long mlfq_quantum_us(const WaitingQueue* queue, const Task* task) {
+    (void)queue;
+    return mlfq_allotment_us(task->level) - task->level_run_us;
+}
+
+static int mlfq_preempts(const Task* best, const Task* running) {
+    return best->level < running->level;
+}
+
+//a task that used up its level's allotment drops a level; being preempted does not reset it
+static void mlfq_on_slice_end(Task* task, long long slice_us) {
+    task->level_run_us += slice_us;
+    if (task->level_run_us >= mlfq_allotment_us(task->level)) {
+        if (task->level < MLFQ_LEVELS - 1) task->level++;
+        task->level_run_us = 0;
+    }
+}
+
+const SchedPolicy policy_mlfq = {
+    "mlfq",
+    "multi-level feedback queue: programs drop a level per used-up allotment, waiting lifts them back",
+    mlfq_queue_key,
+    mlfq_quantum_us,
+    mlfq_preempts,
+    NULL,
+    mlfq_on_slice_end,
+    0
+};
+
+
+//edf: earliest deadline first; tasks without one follow in arrival order
+static long long edf_queue_key(WaitingQueue* queue, Task* task) {
+    (void)queue;
+    return task->deadline_us ? task->deadline_us : EDF_NO_DEADLINE;
+}
+
+static long long edf_quantum_us(const WaitingQueue* queue, const Task* task) {
+    (void)queue;
+    (void)task;
+    return default_quantum_us;
+}
+
+static int edf_preempts(const Task* best, const Task* running) {
+    return best->deadline_us != 0 && (running->deadline_us == 0 || best->deadline_us < running->deadline_us);
+}
+
+const SchedPolicy policy_edf = {
+    "edf",
+    "earliest deadline first (\"" DEADLINE_PREFIX " <ms> <command>\"), then arrival order",
+    edf_queue_key,
+    edf_quantum_us,
+    edf_preempts,
+    NULL,
+    NULL,
+    0
+};
+
+
+//fair: start-time fair queueing over clients. Each slice is tagged with its client's
+//next start tag in the queue (runqueue_share_tag), which advances by the slice divided
+//by the task's weight, so clients take turns in proportion to their weights and groups
+//however many tasks each queues; a client's own tasks run in arrival order
+static long long fair_queue_key(WaitingQueue* queue, Task* task) {
+    //the slice the task will most likely get: its quantum, or less if it is about to finish
+    long long service_us = rr_quantum_us(queue, task);
+    if (task->remaining_burst_us > 0 && task->remaining_burst_us < service_us) service_us = task->remaining_burst_us;
+
+    long long start_us = queue->min_vruntime_us;
+    ShareTag* tag = runqueue_share_tag(queue, task->client_num);
+    if (tag != NULL) {
+        if (tag->finish_us > start_us) start_us = tag->finish_us;
+        tag->finish_us = start_us + service_us * TASK_DEFAULT_WEIGHT / task->weight;
+    }
+    task->share_charge_us = service_us;
+    task->share_queue = queue;
+    task->share_tag_us = start_us;
+    return start_us;
+}
+
+//tags already interleave the clients; a running slice is not cut short for another one
+static int fair_preempts(const Task* best, const Task* running) {
+    (void)best;
+    (void)running;
+    return 0;
+}
+
+//the queue's virtual time is the start tag of the slice in service
+static void fair_on_select(WaitingQueue* queue, const Task* task) {
+    if (task->share_tag_us > queue->min_vruntime_us) queue->min_vruntime_us = task->share_tag_us;
+}
+
+//charge the client what the slice really used instead of what it was tagged with
+//the tag is in the queue the task was taken from (a thief runs a peer's task), under its lock
+static void fair_on_slice_end(Task* task, long long slice_us) {
+    WaitingQueue* queue = task->share_queue;
+    if (queue == NULL) return;
+    pthread_mutex_lock(&queue->mutex);
+    ShareTag* tag = runqueue_share_tag(queue, task->client_num);
+    if (tag != NULL) tag->finish_us += (slice_us - task->share_charge_us) * TASK_DEFAULT_WEIGHT / task->weight;
+    pthread_mutex_unlock(&queue->mutex);
+    task->share_queue = NULL;
+}
+
+const SchedPolicy policy_fair = {
+    "fair",
+    "weighted fair share between clients and groups (--share), each client's tasks in arrival order",
+    fair_queue_key,
+    rr_quantum_us,
+    fair_preempts,
+    fair_on_select,
+    fair_on_slice_end,
+    0
+};
+
+
+const SchedPolicy* const scheduling_policies[] = {
+    &policy_rr_sjrf,
+    &policy_cfs,
+    &policy_mlfq,
+    &policy_edf,
+    &policy_fair,
+    NULL
+};
+
+const SchedPolicy* scheduler_policy = &policy_rr_sjrf;
+
+
+const SchedPolicy* policy_find(const char* name) {
+    for (int i = 0; scheduling_policies[i] != NULL; i++) {
+        if (strcmp(scheduling_policies[i]->name, name) == 0) return scheduling_policies[i];
+    }
+    return NULL;
+}
+
+Task* policy_select(const SchedPolicy* policy, WaitingQueue* queue) {
+    if (queue->count == 0) return NULL;
+
+    //the heap is ordered by the policy's key; a rotating policy skips the last selected
+    //task unless nothing else is queued
+    Task* selected = runqueue_pop_next(queue, policy->rotate ? queue->last_selected_id : -1);
+    if (selected != NULL) {
+        queue->last_selected_id = selected->task_id;
+        if (policy->on_select != NULL) policy->on_select(queue, selected);
+    }
+    return selected;
+}
+
+int policy_preempts(const SchedPolicy* policy, const Task* best, const Task* running) {
+    return policy->preempts(best, running);
+}
+
+void policy_slice_end(const SchedPolicy* policy, Task* task, long long slice_us) {
+    task->round_number++;
+    if (policy->on_slice_end != NULL) policy->on_slice_end(task, slice_us);
+}
+
+void task_account_run_time(Task* task, long long run_time_us) {
+    task->run_time_us = run_time_us;
+    task->remaining_burst_us = task->total_burst_us - run_time_us;
+    //the estimate ran out but the process is still going: it stays the shortest job
+    if (task->remaining_burst_us < 0) task->remaining_burst_us = 0;
+}
+
+int schedule_entry_format(char* out, size_t capacity, const ScheduleEntry* entry, int first) {
+    return snprintf(out, capacity, "%sP%d-(%lld.%03lld)", first ? "" : "-", entry->task_id,
+                    entry->completion_us / USEC_PER_SEC, (entry->completion_us % USEC_PER_SEC) / 1000);
+}
@@ -0,0 +1,149 @@
+// src/protocol.c - Length-prefixed framing between client and server
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "../include/protocol.h"
+
+
+void frame_header_encode(unsigned char* out, FrameType type, uint32_t request_id, uint32_t length) {
+    uint32_t net_length = htonl(length);
+    uint32_t net_id = htonl(request_id);
+    memcpy(out, &net_length, 4);
+    memcpy(out + 4, &net_id, 4);
+    out[8] = (unsigned char)type;
+    out[9] = out[10] = out[11] = 0;
+}
+
+//send an iovec completely, advancing it past partial sends
+static int send_iov(int socket, struct iovec* iov, int iov_count) {
+    while (iov_count > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_count;
+
+        ssize_t sent = sendmsg(socket, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        while (iov_count > 0 && (size_t)sent >= iov->iov_len) {
+            sent -= iov->iov_len;
+            iov++;
+            iov_count--;
+        }
+        if (iov_count > 0) {
+            iov->iov_base = (char*)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    return 0;
+}
+
+int frame_write(int socket, FrameType type, uint32_t request_id, const void* payload, uint32_t length) {
+    unsigned char header[FRAME_HEADER_SIZE];
+    frame_header_encode(header, type, request_id, length);
+
+    struct iovec iov[2];
+    iov[0].iov_base = header;
+    iov[0].iov_len = FRAME_HEADER_SIZE;
+    iov[1].iov_base = (void*)payload;
+    iov[1].iov_len = length;
+    return send_iov(socket, iov, length > 0 ? 2 : 1);
+}
+
+int protocol_send_hello(int socket) {
+    unsigned char hello[PROTOCOL_HELLO_SIZE];
+    uint32_t version = htonl(PROTOCOL_VERSION);
+    memcpy(hello, PROTOCOL_MAGIC, 4);
+    memcpy(hello + 4, &version, 4);
+
+    struct iovec iov;
+    iov.iov_base = hello;
+    iov.iov_len = sizeof(hello);
+    return send_iov(socket, &iov, 1);
+}
+
+void frame_decoder_init(FrameDecoder* decoder, ProtocolMode mode) {
+    memset(decoder, 0, sizeof(FrameDecoder));
+    decoder->mode = mode;
+}
+
+void frame_decoder_free(FrameDecoder* decoder) {
+    free(decoder->data);
+    decoder->data = NULL;
+    decoder->used = decoder->consumed = decoder->capacity = 0;
+}
+
+int frame_decoder_append(FrameDecoder* decoder, const char* data, size_t length) {
+    //drop bytes already handed out as frames
+    if (decoder->consumed > 0) {
+        memmove(decoder->data, decoder->data + decoder->consumed, decoder->used - decoder->consumed);
+        decoder->used -= decoder->consumed;
+        decoder->consumed = 0;
+    }
+
+    if (decoder->used + length > decoder->capacity) {
+        size_t capacity = decoder->capacity ? decoder->capacity : 4096;
+        while (capacity < decoder->used + length) capacity *= 2;
+        char* grown = (char*)realloc(decoder->data, capacity);
+        if (grown == NULL) return -1;
+        decoder->data = grown;
+        decoder->capacity = capacity;
+    }
+
+    memcpy(decoder->data + decoder->used, data, length);
+    decoder->used += length;
+    return 0;
+}
+
+int frame_decoder_next(FrameDecoder* decoder, FrameHeader* header, const char** payload) {
+    size_t available = decoder->used - decoder->consumed;
+    const unsigned char* bytes = (const unsigned char*)decoder->data + decoder->consumed;
+
+    //the first byte tells a framed client (hello starts with NUL) from a legacy one
+    if (decoder->mode == PROTOCOL_UNKNOWN) {
+        if (available == 0) return 0;
+        if (bytes[0] != '\0') {
+            decoder->mode = PROTOCOL_LEGACY;
+        } else {
+            if (available < PROTOCOL_HELLO_SIZE) return 0;
+            uint32_t version;
+            memcpy(&version, bytes + 4, 4);
+            if (memcmp(bytes, PROTOCOL_MAGIC, 4) != 0 || ntohl(version) != PROTOCOL_VERSION) return -1;
+            decoder->mode = PROTOCOL_FRAMED;
+            decoder->consumed += PROTOCOL_HELLO_SIZE;
+            available -= PROTOCOL_HELLO_SIZE;
+            bytes += PROTOCOL_HELLO_SIZE;
+        }
+    }
+
+    //legacy: whatever arrived is one command
+    if (decoder->mode == PROTOCOL_LEGACY) {
+        if (available == 0) return 0;
+        header->length = (uint32_t)available;
+        header->request_id = 0;
+        header->type = FRAME_COMMAND;
+        *payload = (const char*)bytes;
+        decoder->consumed += available;
+        return 1;
+    }
+
+    if (available < FRAME_HEADER_SIZE) return 0;
+    uint32_t length, request_id;
+    memcpy(&length, bytes, 4);
+    memcpy(&request_id, bytes + 4, 4);
+    length = ntohl(length);
+    if (length > FRAME_MAX_PAYLOAD) return -1;
+    if (available < FRAME_HEADER_SIZE + (size_t)length) return 0;
+
+    header->length = length;
+    header->request_id = ntohl(request_id);
+    header->type = bytes[8];
+    *payload = (const char*)bytes + FRAME_HEADER_SIZE;
+    decoder->consumed += FRAME_HEADER_SIZE + length;
+    return 1;
+}
@@ -0,0 +1,286 @@
+// src/reactor.c - Edge-triggered epoll reactor for client connections
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "../include/reactor.h"
+#include "../include/server.h"
+#include "../include/scheduler.h"
+
+
+//per-connection state, owned by exactly one I/O thread
+typedef struct ReactorConn {
+    ClientConn* conn;                 //client socket and number, shared with its tasks
+    FrameDecoder decoder;             //reassembles commands split or coalesced by TCP
+    int ready;                        //1 if queued on the ready list (unread data left)
+    struct ReactorConn* next_ready;   //ready list link
+    struct ReactorConn* prev;         //all-connections list links
+    struct ReactorConn* next;
+} ReactorConn;
+
+//one I/O thread with its own epoll instance
+typedef struct {
+    int epoll_fd;                     //epoll instance for this thread's connections
+    int wake_fd;                      //eventfd used to wake the thread on shutdown
+    pthread_t thread;
+    ReactorConn* conns;               //all live connections (for shutdown cleanup)
+    ReactorConn* ready_head;          //connections that hit the per-event read cap
+    ReactorConn* ready_tail;
+    pthread_mutex_t conns_mutex;      //protects conns against the acceptor thread
+} IoThread;
+
+static IoThread* io_threads = NULL;
+static int io_thread_count = 0;
+static int next_io_thread = 0;
+static volatile int reactor_running = 0;
+
+
+//queue a connection that still has unread data
+static void push_ready(IoThread* io, ReactorConn* conn) {
+    if (conn->ready) return;
+    conn->ready = 1;
+    conn->next_ready = NULL;
+    if (io->ready_tail) io->ready_tail->next_ready = conn;
+    else io->ready_head = conn;
+    io->ready_tail = conn;
+}
+
+//pop the oldest connection from the ready list
+static ReactorConn* pop_ready(IoThread* io) {
+    ReactorConn* conn = io->ready_head;
+    if (conn == NULL) return NULL;
+    io->ready_head = conn->next_ready;
+    if (io->ready_head == NULL) io->ready_tail = NULL;
+    conn->ready = 0;
+    conn->next_ready = NULL;
+    return conn;
+}
+
+//unregister, purge queued tasks and free a connection
+static void close_conn(IoThread* io, ReactorConn* conn) {
+    int client_socket = conn->conn->socket;
+
+    epoll_ctl(io->epoll_fd, EPOLL_CTL_DEL, client_socket, NULL);
+
+    //drop it from the ready list if it is still there
+    if (conn->ready) {
+        ReactorConn** link = &io->ready_head;
+        ReactorConn* prev = NULL;
+        while (*link && *link != conn) {
+            prev = *link;
+            link = &(*link)->next_ready;
+        }
+        if (*link) *link = conn->next_ready;
+        if (io->ready_tail == conn) io->ready_tail = prev;
+    }
+
+    pthread_mutex_lock(&io->conns_mutex);
+    if (conn->prev) conn->prev->next = conn->next;
+    else io->conns = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+    pthread_mutex_unlock(&io->conns_mutex);
+
+    //stop running tasks from writing (and tasks still in an inbox from being queued);
+    //the socket closes with the last reference
+    conn_shutdown(conn->conn);
+
+    //remove all tasks for this client from the queue
+    remove_client_tasks(conn->conn->client_num);
+    conn_release(conn->conn);
+    frame_decoder_free(&conn->decoder);
+    free(conn);
+}
+
+/**
+ * Reads up to REACTOR_READS_PER_EVENT times from one connection and handles every
+ * command that became complete
+ * Edge-triggered epoll only reports new data once, so a connection that hits the
+ * cap before EAGAIN is put on the ready list and revisited after other clients
+ */
+static void service_conn(IoThread* io, ReactorConn* conn) {
+    char receive_buffer[BUFFER_SIZE];
+
+    for (int reads = 0; reads < REACTOR_READS_PER_EVENT; reads++) {
+        ssize_t bytes_received = recv(conn->conn->socket, receive_buffer, BUFFER_SIZE - 1, MSG_DONTWAIT);
+
+        if (bytes_received < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return; //drained
+            close_conn(io, conn);
+            return;
+        }
+        if (bytes_received == 0) {
+            close_conn(io, conn); //client disconnected
+            return;
+        }
+
+        //replies are queued (conn_defer_sends); a client that let too many pile up is dropped
+        if (frame_decoder_append(&conn->decoder, receive_buffer, (size_t)bytes_received) != 0 ||
+            dispatch_client_frames(conn->conn, &conn->decoder) || conn_flush_outbox(conn->conn) < 0) {
+            close_conn(io, conn);
+            return;
+        }
+    }
+
+    //read cap reached with data possibly still pending
+    push_ready(io, conn);
+}
+
+//I/O thread loop: wait for readable or writable sockets and service them
+static void* io_thread_main(void* arg) {
+    IoThread* io = (IoThread*)arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+
+    //builtin and error replies must not block this thread on one slow client
+    conn_defer_sends();
+
+    while (reactor_running) {
+        //don't block while connections with unread data are waiting
+        int timeout = (io->ready_head != NULL) ? 0 : -1;
+        int n = epoll_wait(io->epoll_fd, events, REACTOR_MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait failed");
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            ReactorConn* conn = (ReactorConn*)events[i].data.ptr;
+            if (conn == NULL) continue; //wake_fd: shutdown requested
+
+            //the socket took more: send the replies still queued for it
+            if ((events[i].events & EPOLLOUT) && conn_flush_outbox(conn->conn) < 0) {
+                close_conn(io, conn);
+                continue;
+            }
+
+            //EPOLLIN/EPOLLRDHUP/EPOLLHUP/EPOLLERR all end in recv(), which
+            //returns the data, the EOF or the error
+            if (events[i].events & ~EPOLLOUT) service_conn(io, conn);
+        }
+
+        //give every connection that hit the read cap one more turn
+        ReactorConn* pending = io->ready_tail;
+        ReactorConn* conn;
+        while (pending != NULL && (conn = pop_ready(io)) != NULL) {
+            int last = (conn == pending);
+            service_conn(io, conn);
+            if (last) break;
+        }
+    }
+    return NULL;
+}
+
+//start I/O threads, each with its own epoll instance
+int start_reactor(int thread_count) {
+    if (thread_count < 1) thread_count = 1;
+    if (thread_count > MAX_IO_THREADS) thread_count = MAX_IO_THREADS;
+
+    io_threads = (IoThread*)calloc(thread_count, sizeof(IoThread));
+    if (io_threads == NULL) return -1;
+
+    reactor_running = 1;
+    for (int i = 0; i < thread_count; i++) {
+        IoThread* io = &io_threads[i];
+        pthread_mutex_init(&io->conns_mutex, NULL);
+
+        io->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        io->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        if (io->epoll_fd < 0 || io->wake_fd < 0) {
+            perror("Failed to create epoll instance");
+            return -1;
+        }
+
+        //wake_fd is registered with a NULL pointer so the loop can tell it apart
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+        epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, io->wake_fd, &ev);
+
+        if (pthread_create(&io->thread, NULL, io_thread_main, io) != 0) {
+            perror("Failed to create I/O thread");
+            return -1;
+        }
+        io_thread_count++;
+    }
+    return 0;
+}
+
+//hand an accepted socket to the next I/O thread (round-robin)
+int reactor_add_client(ClientInfo* client_info) {
+    if (io_thread_count == 0) return -1;
+
+    ReactorConn* conn = (ReactorConn*)calloc(1, sizeof(ReactorConn));
+    if (conn == NULL) return -1;
+    conn->conn = conn_create(client_info->socket, client_info->client_num);
+    if (conn->conn == NULL) {
+        free(conn);
+        return -1;
+    }
+    frame_decoder_init(&conn->decoder, PROTOCOL_UNKNOWN);
+
+    //only the acceptor thread calls this, so no lock is needed for the cursor
+    IoThread* io = &io_threads[next_io_thread];
+    next_io_thread = (next_io_thread + 1) % io_thread_count;
+
+    pthread_mutex_lock(&io->conns_mutex);
+    conn->next = io->conns;
+    if (io->conns) io->conns->prev = conn;
+    io->conns = conn;
+    pthread_mutex_unlock(&io->conns_mutex);
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    if (epoll_ctl(io->epoll_fd, EPOLL_CTL_ADD, client_info->socket, &ev) < 0) {
+        perror("epoll_ctl failed");
+        pthread_mutex_lock(&io->conns_mutex);
+        io->conns = conn->next;
+        if (conn->next) conn->next->prev = NULL;
+        pthread_mutex_unlock(&io->conns_mutex);
+        //the caller still owns (and closes) the socket
+        conn->conn->socket = -1;
+        conn_release(conn->conn);
+        frame_decoder_free(&conn->decoder);
+        free(conn);
+        return -1;
+    }
+    free(client_info);
+    return 0;
+}
+
+//stop all I/O threads and close their connections
+void stop_reactor() {
+    reactor_running = 0;
+
+    for (int i = 0; i < io_thread_count; i++) {
+        uint64_t one = 1;
+        if (write(io_threads[i].wake_fd, &one, sizeof(one)) < 0) {
+            perror("Failed to wake I/O thread");
+        }
+    }
+
+    for (int i = 0; i < io_thread_count; i++) {
+        IoThread* io = &io_threads[i];
+        pthread_join(io->thread, NULL);
+
+        while (io->conns != NULL) {
+            close_conn(io, io->conns);
+        }
+        close(io->wake_fd);
+        close(io->epoll_fd);
+        pthread_mutex_destroy(&io->conns_mutex);
+    }
+
+    free(io_threads);
+    io_threads = NULL;
+    io_thread_count = 0;
+}
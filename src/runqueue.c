@@ -0,0 +1,262 @@
+// src/runqueue.c - Indexed min-heap run queue used by each scheduler worker
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/runqueue.h"
+#include "../include/scheduler.h"
+#include "../include/policy.h"
+
+
+//heap order: the policy's key, then arrival order
+static int slot_before(const RunQueueSlot* a, const RunQueueSlot* b) {
+    if (a->key != b->key) return a->key < b->key;
+    return a->seq < b->seq;
+}
+
+//place a slot at index i and record the index in its task
+static void heap_set(WaitingQueue* queue, int i, RunQueueSlot slot) {
+    queue->heap[i] = slot;
+    slot.task->heap_index = i;
+}
+
+//move the slot at index i towards the root while it beats its parent
+static void sift_up(WaitingQueue* queue, int i) {
+    RunQueueSlot slot = queue->heap[i];
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (!slot_before(&slot, &queue->heap[parent])) break;
+        heap_set(queue, i, queue->heap[parent]);
+        i = parent;
+    }
+    heap_set(queue, i, slot);
+}
+
+//move the slot at index i towards the leaves while a child beats it
+static void sift_down(WaitingQueue* queue, int i) {
+    RunQueueSlot slot = queue->heap[i];
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= queue->count) break;
+        if (child + 1 < queue->count && slot_before(&queue->heap[child + 1], &queue->heap[child])) {
+            child++;
+        }
+        if (!slot_before(&queue->heap[child], &slot)) break;
+        heap_set(queue, i, queue->heap[child]);
+        i = child;
+    }
+    heap_set(queue, i, slot);
+}
+
+//find the client index entry for client_num, optionally creating it
+static ClientTaskList* client_list(WaitingQueue* queue, int client_num, int create) {
+    unsigned bucket = (unsigned)client_num & (RUNQUEUE_CLIENT_BUCKETS - 1);
+    for (ClientTaskList* list = queue->clients[bucket]; list != NULL; list = list->next) {
+        if (list->client_num == client_num) return list;
+    }
+    if (!create) return NULL;
+
+    ClientTaskList* list = (ClientTaskList*)calloc(1, sizeof(ClientTaskList));
+    if (list == NULL) return NULL;
+    list->client_num = client_num;
+    list->next = queue->clients[bucket];
+    queue->clients[bucket] = list;
+    return list;
+}
+
+//unlink a task from its client's list, dropping the entry when it empties
+static void client_unlink(WaitingQueue* queue, Task* task) {
+    ClientTaskList* list = client_list(queue, task->client_num, 0);
+    if (list == NULL) return;
+
+    if (task->client_prev) task->client_prev->client_next = task->client_next;
+    else list->head = task->client_next;
+    if (task->client_next) task->client_next->client_prev = task->client_prev;
+    else list->tail = task->client_prev;
+    task->client_prev = task->client_next = NULL;
+
+    if (--list->count == 0) {
+        unsigned bucket = (unsigned)task->client_num & (RUNQUEUE_CLIENT_BUCKETS - 1);
+        ClientTaskList** link = &queue->clients[bucket];
+        while (*link != list) link = &(*link)->next;
+        *link = list->next;
+        free(list);
+    }
+}
+
+//insert a task into the heap only, snapshotting its keys (caller guarantees capacity)
+static void heap_insert(WaitingQueue* queue, Task* task) {
+    RunQueueSlot slot;
+    slot.key = queue->policy->queue_key(queue, task);
+    slot.seq = task->queue_seq;
+    slot.task_id = task->task_id;
+    slot.task = task;
+    heap_set(queue, queue->count, slot);
+    queue->count++;
+    sift_up(queue, queue->count - 1);
+}
+
+//remove the task at heap slot i from the heap only
+static Task* heap_take(WaitingQueue* queue, int i) {
+    Task* task = queue->heap[i].task;
+    queue->count--;
+    if (i != queue->count) {
+        Task* moved = queue->heap[queue->count].task;
+        heap_set(queue, i, queue->heap[queue->count]);
+        //the moved task may belong either above or below slot i
+        sift_up(queue, i);
+        if (moved->heap_index == i) sift_down(queue, i);
+    }
+    task->heap_index = -1;
+    return task;
+}
+
+//remove the task at heap slot i from the heap and its client's list
+static Task* take_slot(WaitingQueue* queue, int i) {
+    Task* task = heap_take(queue, i);
+    client_unlink(queue, task);
+    return task;
+}
+
+
+void runqueue_init(WaitingQueue* queue, const SchedPolicy* policy) {
+    memset(queue, 0, sizeof(WaitingQueue));
+    queue->policy = policy;
+    queue->min_vruntime_us = 0;
+    queue->count = 0;
+    queue->last_selected_id = -1;
+
+    //create synchronization primitives for thread-safe access
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->task_complete, NULL);
+}
+
+void runqueue_destroy(WaitingQueue* queue) {
+    pthread_mutex_lock(&queue->mutex);
+    //free all remaining tasks in queue
+    while (queue->count > 0) {
+        destroy_task(take_slot(queue, queue->count - 1));
+    }
+    free(queue->heap);
+    queue->heap = NULL;
+    queue->capacity = 0;
+    for (int b = 0; b < RUNQUEUE_CLIENT_BUCKETS; b++) {
+        while (queue->share_tags[b] != NULL) {
+            ShareTag* tag = queue->share_tags[b];
+            queue->share_tags[b] = tag->next;
+            free(tag);
+        }
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    //destroy all synchronization primitives
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->task_complete);
+}
+
+int runqueue_push(WaitingQueue* queue, Task* task) {
+    if (queue->count >= MAX_TASKS) return -1;
+
+    //grow the heap geometrically
+    if (queue->count == queue->capacity) {
+        int new_capacity = queue->capacity ? queue->capacity * 2 : RUNQUEUE_INITIAL_CAPACITY;
+        if (new_capacity > MAX_TASKS) new_capacity = MAX_TASKS;
+        RunQueueSlot* heap = (RunQueueSlot*)realloc(queue->heap, new_capacity * sizeof(RunQueueSlot));
+        if (heap == NULL) return -1;
+        queue->heap = heap;
+        queue->capacity = new_capacity;
+    }
+
+    //append to the client's list in arrival order
+    ClientTaskList* list = client_list(queue, task->client_num, 1);
+    if (list == NULL) return -1;
+    task->client_next = NULL;
+    task->client_prev = list->tail;
+    if (list->tail) list->tail->client_next = task;
+    else list->head = task;
+    list->tail = task;
+    list->count++;
+
+    task->queue_seq = queue->next_seq++;
+    heap_insert(queue, task);
+    return 0;
+}
+
+Task* runqueue_peek(WaitingQueue* queue) {
+    return queue->count > 0 ? queue->heap[0].task : NULL;
+}
+
+ShareTag* runqueue_share_tag(WaitingQueue* queue, int client_num) {
+    unsigned bucket = (unsigned)client_num & (RUNQUEUE_CLIENT_BUCKETS - 1);
+    ShareTag** link = &queue->share_tags[bucket];
+    ShareTag* found = NULL;
+    while (*link != NULL) {
+        ShareTag* tag = *link;
+        if (tag->client_num == client_num) {
+            found = tag;
+        } else if (tag->finish_us <= queue->min_vruntime_us) {
+            //a client that went quiet: its next tag starts at the virtual time anyway
+            *link = tag->next;
+            free(tag);
+            continue;
+        }
+        link = &tag->next;
+    }
+    if (found != NULL) return found;
+
+    found = (ShareTag*)calloc(1, sizeof(ShareTag));
+    if (found == NULL) return NULL;
+    found->client_num = client_num;
+    found->finish_us = queue->min_vruntime_us;
+    found->next = queue->share_tags[bucket];
+    queue->share_tags[bucket] = found;
+    return found;
+}
+
+Task* runqueue_pop_next(WaitingQueue* queue, int skip_id) {
+    if (queue->count == 0) return NULL;
+    if (skip_id < 0 || queue->heap[0].task_id != skip_id) return take_slot(queue, 0);
+
+    //every queued task has skip_id (task ids are client numbers): run the best of them anyway
+    ClientTaskList* skipped = client_list(queue, skip_id, 0);
+    if (skipped == NULL || skipped->count == queue->count) return take_slot(queue, 0);
+
+    //the best other task is the best node whose ancestors all have skip_id: walk down
+    //through skipped nodes only, since any other node beats its whole subtree
+    int stack[2 * 32];                  //depth-first: at most one pending sibling per level
+    int depth = 0, best = -1;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        int i = stack[--depth];
+        if (queue->heap[i].task_id != skip_id) {
+            if (best < 0 || slot_before(&queue->heap[i], &queue->heap[best])) best = i;
+            continue;
+        }
+        for (int child = 2 * i + 2; child >= 2 * i + 1; child--) {
+            if (child < queue->count) stack[depth++] = child;
+        }
+    }
+    return take_slot(queue, best);
+}
+
+void runqueue_remove(WaitingQueue* queue, Task* task) {
+    if (task->heap_index < 0 || task->heap_index >= queue->count) return;
+    if (queue->heap[task->heap_index].task != task) return;
+    take_slot(queue, task->heap_index);
+}
+
+Task* runqueue_find_id(WaitingQueue* queue, int task_id) {
+    ClientTaskList* list = client_list(queue, task_id, 0);
+    if (list == NULL) return NULL;
+    for (Task* task = list->head; task != NULL; task = task->client_next) {
+        if (task->task_id == task_id) return task;
+    }
+    return NULL;
+}
+
+Task* runqueue_pop_client(WaitingQueue* queue, int client_num) {
+    ClientTaskList* list = client_list(queue, client_num, 0);
+    if (list == NULL || list->head == NULL) return NULL;
+    Task* task = list->head;
+    take_slot(queue, task->heap_index);
+    return task;
+}
@@ -1,369 +1,499 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <sys/time.h>
 #include <signal.h>
 #include <errno.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
 #include "../include/scheduler.h"
 #include "../include/server.h"
-
-
-
-WaitingQueue waiting_queue;
+#include "../include/shellpool.h"
+#include "../include/connection.h"
+#include "../include/zygote.h"
+#include "../include/taskpool.h"
+#include "../include/cmdcache.h"
+#include "../include/classify.h"
+#include "../include/burstmodel.h"
+#include "../include/logger.h"
+#include "../include/metrics.h"
+#include "../include/policy.h"
+#include "../include/fairshare.h"
+
+
+
+SchedulerWorker* scheduler_workers = NULL;
+int scheduler_worker_count = 0;
 ScheduleSummary schedule_summary;
 pthread_mutex_t scheduler_mutex = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t scheduler_cond = PTHREAD_COND_INITIALIZER;
 int scheduler_running = 0;
-int currently_running_task_id = -1;
 
 static pthread_mutex_t task_id_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+//tasks queued or running on any worker; 0 means the whole system is idle
+static atomic_int tasks_in_system = 0;
 
-#define COLOR_CYAN    "\033[1;36m"    //bold Cyan for created
-#define COLOR_GREEN   "\033[1;32m"    //bold Green for started
-#define COLOR_YELLOW  "\033[1;33m"    //bold Yellow for waiting
-#define COLOR_MAGENTA "\033[1;35m"    //bold Magenta for running
-#define COLOR_RED     "\033[1;31m"    //bold Red for ended
-#define COLOR_BLUE    "\033[1;37;46m" 
-#define COLOR_RESET   "\033[0m"       //reset color
+//arrival time of the first task after an idle period, applied to the schedule by a worker
+static atomic_llong schedule_restart_us = 0;
 
 
-//calculate how many seconds have elapsed since scheduler started
-int get_elapsed_seconds() {
-    struct timeval now;
-    gettimeofday(&now, NULL);
-    return (int)(now.tv_sec - schedule_summary.start_time.tv_sec);
+//read the monotonic clock in microseconds
+long long monotonic_us() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * USEC_PER_SEC + now.tv_nsec / 1000;
+}
+
+//calculate how many microseconds have elapsed since scheduler started
+long long get_elapsed_us() {
+    return monotonic_us() - schedule_summary.start_us;
 }
 
 //determine if command is a shell builtin or a program
 TaskType get_task_type(const char* command) {
-    //list of all shell commands that get highest priority
-    const char* shell_commands[] = {
-        "ls", "pwd", "cd", "echo", "cat", "mkdir", "rmdir", "rm", "cp", "mv",
-        "touch", "head", "tail", "grep", "find", "wc", "sort", "uniq", "date",
-        "whoami", "hostname", "uname", "env", "export", "clear", "man", "help",
-        "ps", "kill", "chmod", "chown", "df", "du", "tar", "gzip", "gunzip",
-        NULL
-    };
-
-    char cmd_copy[4096];
-    strncpy(cmd_copy, command, sizeof(cmd_copy) - 1);
-    cmd_copy[sizeof(cmd_copy) - 1] = '\0';
-
-    //extract first token of command
-    char* first_word = strtok(cmd_copy, " \t");
-    if (first_word == NULL) return TASK_TYPE_SHELL;
-
-    //programs always start with ./
-    if (strncmp(first_word, "./", 2) == 0) return TASK_TYPE_PROGRAM;
-
-    //check if it matches any shell command
-    for (int i = 0; shell_commands[i] != NULL; i++) {
-        if (strcmp(first_word, shell_commands[i]) == 0) return TASK_TYPE_SHELL;
-    }
-
-    //default to shell if unknown
-    return TASK_TYPE_SHELL;
+    return classify_command(command);
 }
 
 //extract execution time from demo command
 int extract_burst_time(const char* command) {
-    char cmd_copy[4096];
-    strncpy(cmd_copy, command, sizeof(cmd_copy) - 1);
-    cmd_copy[sizeof(cmd_copy) - 1] = '\0';
-
-    //get first token
-    char* token = strtok(cmd_copy, " \t");
-    if (token == NULL) return DEFAULT_BURST_TIME;
+    //first word, in place
+    const char* word = command + strspn(command, " \t");
+    size_t length = strcspn(word, " \t");
+    if (length == 0) return DEFAULT_BURST_TIME;
 
     //if this is a demo program, extract the duration argument
-    if (strstr(token, "demo") != NULL) {
-        token = strtok(NULL, " \t");
-        if (token != NULL) {
-            int n = atoi(token);
-            //return the duration or default if invalid
-            if (n > 0) return n;
-        }
+    for (size_t i = 0; i + 4 <= length; i++) {
+        if (memcmp(word + i, "demo", 4) != 0) continue;
+        const char* argument = word + length + strspn(word + length, " \t");
+        int n = atoi(argument);
+        //return the duration or default if invalid
+        return n > 0 ? n : DEFAULT_BURST_TIME;
     }
     return DEFAULT_BURST_TIME;
 }
 
 
 
-//initialize queue, mutexes, and condition variables
-void init_waiting_queue() {
-    memset(&waiting_queue, 0, sizeof(WaitingQueue));
-    waiting_queue.count = 0;
-    waiting_queue.last_selected_id = -1;
+//initialize all worker run queues and the schedule summary
+void init_waiting_queue(int worker_count) {
+    if (worker_count < 1) worker_count = 1;
+    if (worker_count > MAX_SCHEDULER_WORKERS) worker_count = MAX_SCHEDULER_WORKERS;
+
+    scheduler_workers = (SchedulerWorker*)calloc(worker_count, sizeof(SchedulerWorker));
+    if (scheduler_workers == NULL) {
+        perror("Failed to allocate scheduler workers");
+        exit(EXIT_FAILURE);
+    }
+    scheduler_worker_count = worker_count;
+
+    for (int w = 0; w < worker_count; w++) {
+        SchedulerWorker* worker = &scheduler_workers[w];
+        worker->worker_id = w;
+        atomic_init(&worker->currently_running_task_id, -1);
+        worker->idle = 0;
+        runqueue_init(&worker->queue, scheduler_policy);
+        if (mpsc_ring_init(&worker->inbox, SUBMIT_RING_CAPACITY) != 0) {
+            perror("Failed to allocate scheduler worker inbox");
+            exit(EXIT_FAILURE);
+        }
 
-    //create synchronization primitives for thread-safe access
-    pthread_mutex_init(&waiting_queue.mutex, NULL);
-    pthread_cond_init(&waiting_queue.not_empty, NULL);
-    pthread_cond_init(&waiting_queue.task_complete, NULL);
+        //arrival notifications and quantum expiry for the running program
+        worker->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        worker->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (worker->wake_fd < 0 || worker->timer_fd < 0) {
+            perror("Failed to create scheduler worker timers");
+            exit(EXIT_FAILURE);
+        }
+    }
+    atomic_store(&tasks_in_system, 0);
 
     //initialize schedule summary with start time
     memset(&schedule_summary, 0, sizeof(ScheduleSummary));
-    gettimeofday(&schedule_summary.start_time, NULL);
+    schedule_summary.start_us = monotonic_us();
 }
 
-//clean up queue and all synchronization objects
+//clean up every run queue and all synchronization objects
 void destroy_waiting_queue() {
-    pthread_mutex_lock(&waiting_queue.mutex);
-    //free all remaining tasks in queue
-    for (int i = 0; i < waiting_queue.count; i++) {
-        if (waiting_queue.tasks[i] != NULL) {
-            free(waiting_queue.tasks[i]);
+    //free remaining tasks and destroy each queue's synchronization primitives
+    for (int w = 0; w < scheduler_worker_count; w++) {
+        //tasks submitted after the worker's last drain
+        void* batch[SUBMIT_DRAIN_BATCH];
+        size_t count;
+        while ((count = mpsc_ring_drain(&scheduler_workers[w].inbox, batch, SUBMIT_DRAIN_BATCH)) > 0) {
+            for (size_t i = 0; i < count; i++) destroy_task((Task*)batch[i]);
         }
+        mpsc_ring_destroy(&scheduler_workers[w].inbox);
+        runqueue_destroy(&scheduler_workers[w].queue);
+        close(scheduler_workers[w].wake_fd);
+        close(scheduler_workers[w].timer_fd);
     }
-    waiting_queue.count = 0;
-    pthread_mutex_unlock(&waiting_queue.mutex);
 
-    //destroy all synchronization primitives
-    pthread_mutex_destroy(&waiting_queue.mutex);
-    pthread_cond_destroy(&waiting_queue.not_empty);
-    pthread_cond_destroy(&waiting_queue.task_complete);
+    free(scheduler_workers);
+    scheduler_workers = NULL;
+    scheduler_worker_count = 0;
+}
+
+//strip a leading "deadline <ms> " from a command, returning the rest and the deadline (0 if none)
+static const char* strip_deadline(const char* command, long long* deadline_ms) {
+    *deadline_ms = 0;
+    size_t prefix_len = strlen(DEADLINE_PREFIX);
+    if (strncmp(command, DEADLINE_PREFIX, prefix_len) != 0 || command[prefix_len] != ' ') return command;
+
+    char* end;
+    long long ms = strtoll(command + prefix_len + 1, &end, 10);
+    if (end == command + prefix_len + 1 || *end != ' ' || ms <= 0) return command;
+    while (*end == ' ') end++;
+    if (*end == '\0') return command;
+
+    *deadline_ms = ms;
+    return end;
 }
 
 //create a new task from a command string
-Task* create_task(const char* command, int client_num, int client_socket) {
-    Task* task = (Task*)malloc(sizeof(Task));
+Task* create_task(const char* command, ClientConn* conn, uint32_t request_id) {
+    long long deadline_ms;
+    command = strip_deadline(command, &deadline_ms);
+    Task* task = task_alloc();
     if (task == NULL) return NULL;
+    task->command = command_dup(command, &task->command_class);
+    if (task->command == NULL) {
+        task_free(task);
+        return NULL;
+    }
 
     //assign unique task id
     pthread_mutex_lock(&task_id_mutex);
-    task->task_id = client_num;
+    task->task_id = conn->client_num;
     pthread_mutex_unlock(&task_id_mutex);
 
-    //store client info
-    task->client_num = client_num;
-    task->client_socket = client_socket;
-    strncpy(task->command, command, sizeof(task->command) - 1);
-    task->command[sizeof(task->command) - 1] = '\0';
+    //store client info; the task keeps the connection open until it is freed
+    task->client_num = conn->client_num;
+    task->conn = conn_retain(conn);
+    task->request_id = request_id;
 
-    //determine if shell command or program
-    task->type = get_task_type(command);
+    //determine if shell command or program, and its burst time; repeated commands come from the cache
+    const ParsedCommand* cached = command_cache_get(command);
+    task->type = cached ? cached->type : get_task_type(command);
     task->state = TASK_CREATED;
 
     //set burst time based on task type
     if (task->type == TASK_TYPE_SHELL) {
-        task->total_burst_time = SHELL_COMMAND_BURST;
-        task->remaining_burst_time = SHELL_COMMAND_BURST;
+        task->total_burst_us = SHELL_COMMAND_BURST;
+        task->remaining_burst_us = SHELL_COMMAND_BURST;
     } else {
-        task->total_burst_time = extract_burst_time(command);
-        task->remaining_burst_time = task->total_burst_time;
+        //measured history beats the static guess once the program has run before
+        int burst_seconds = cached ? cached->burst_seconds : extract_burst_time(command);
+        task->total_burst_us = burst_model_predict_us(command, burst_seconds * USEC_PER_SEC);
+        task->remaining_burst_us = task->total_burst_us;
     }
+    command_cache_release(cached);
 
     //initialize scheduling fields
-    task->current_iteration = 0;
     task->round_number = 0;
-    task->quantum = FIRST_ROUND_QUANTUM;
+    task->quantum_us = first_round_quantum_us;
 
     //record arrival time
-    gettimeofday(&task->arrival_time, NULL);
-    memset(&task->start_time, 0, sizeof(struct timeval));
-    memset(&task->end_time, 0, sizeof(struct timeval));
-
-    //initialize output buffer
-    task->output_buffer[0] = '\0';
-    task->output_length = 0;
+    task->arrival_us = monotonic_us();
+    task->ready_us = task->arrival_us;
+    task->start_us = 0;
+    task->end_us = 0;
+    task->deadline_us = deadline_ms ? task->arrival_us + deadline_ms * 1000 : 0;
+
+    //policy state: placed by the policy when first queued
+    task->vruntime_base_us = 0;
+    task->vruntime_queue = NULL;
+    task->level = 0;
+    task->level_run_us = 0;
+    task->share_tag_us = 0;
+    task->share_charge_us = 0;
+    task->share_queue = NULL;
+    //cfs and fair weigh the task with its client's share of the core
+    task->weight = fair_share_task_created(task->client_num);
+
+    //nothing streamed yet
+    task->output_bytes = 0;
+
+    //no process until the first dispatch of a program
+    task->pid = -1;
+    task->output_fd = -1;
+    task->exit_fd = -1;
+    task->run_time_us = 0;
+
+    //not in any run queue yet
+    task->heap_index = -1;
+    task->queue_seq = 0;
+    task->client_prev = NULL;
+    task->client_next = NULL;
 
     return task;
 }
 
-//add task to waiting queue in thread-safe manner
-int add_task_to_queue(Task* task) {
-    pthread_mutex_lock(&waiting_queue.mutex);
-
-    //check if queue is full
-    if (waiting_queue.count >= MAX_TASKS) {
-        pthread_mutex_unlock(&waiting_queue.mutex);
-        return -1;
+//free a task, killing its process group if a program is still stopped or running
+void destroy_task(Task* task) {
+    if (task == NULL) return;
+    if (task->pid > 0) {
+        zygote_kill(task->pid, task->exit_fd);
     }
-
-    //reset start time only if system is completely idle
-    pthread_mutex_lock(&scheduler_mutex);
-    if (waiting_queue.count == 0 && schedule_summary.count == 0 && currently_running_task_id == -1) {
-        gettimeofday(&schedule_summary.start_time, NULL);
+    if (task->output_fd >= 0) {
+        close(task->output_fd);
     }
-    pthread_mutex_unlock(&scheduler_mutex);
+    fair_share_task_destroyed(task->client_num);
+    conn_release(task->conn);
+    command_free(task->command, task->command_class);
+    task_free(task);
+}
 
-    //add task to queue and increment count
-    waiting_queue.tasks[waiting_queue.count] = task;
-    waiting_queue.count++;
+//pick the worker whose queue is shortest, counting a running task as load
+static SchedulerWorker* least_loaded_worker() {
+    static atomic_uint next_start = 0;
+    int start = (int)(atomic_fetch_add(&next_start, 1) % (unsigned)scheduler_worker_count);
+    SchedulerWorker* best = NULL;
+    int best_load = 0;
+
+    //unlocked reads: an approximate snapshot is good enough for placement,
+    //and rotating the start spreads ties across workers
+    for (int i = 0; i < scheduler_worker_count; i++) {
+        SchedulerWorker* worker = &scheduler_workers[(start + i) % scheduler_worker_count];
+        int load = worker->queue.count + (int)mpsc_ring_size(&worker->inbox) +
+                   (atomic_load_explicit(&worker->currently_running_task_id, memory_order_relaxed) != -1 ? 1 : 0);
+        if (best == NULL || load < best_load) {
+            best = worker;
+            best_load = load;
+            if (load == 0) break;
+        }
+    }
+    return best;
+}
 
-    //signal scheduler that queue is not empty
-    pthread_cond_signal(&waiting_queue.not_empty);
-    pthread_mutex_unlock(&waiting_queue.mutex);
-    return 0;
+//wake a worker: an idle one looks for work, a running slice re-evaluates preemption
+static void notify_worker(SchedulerWorker* worker) {
+    uint64_t one = 1;
+    if (write(worker->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("Failed to notify scheduler worker");
+    }
 }
 
-//remove specific task from queue by id
-Task* remove_task_from_queue(int task_id) {
-    pthread_mutex_lock(&waiting_queue.mutex);
-    Task* removed_task = NULL;
-    //search queue for matching task id
-    for (int i = 0; i < waiting_queue.count; i++) {
-        if (waiting_queue.tasks[i] != NULL && waiting_queue.tasks[i]->task_id == task_id) {
-            removed_task = waiting_queue.tasks[i];
-            //shift remaining tasks forward
-            for (int j = i; j < waiting_queue.count - 1; j++) {
-                waiting_queue.tasks[j] = waiting_queue.tasks[j + 1];
-            }
-            waiting_queue.tasks[waiting_queue.count - 1] = NULL;
-            waiting_queue.count--;
-            break;
+//wake one idle worker so it can steal surplus work from a busy peer
+static void wake_idle_worker(SchedulerWorker* self) {
+    for (int i = 1; i < scheduler_worker_count; i++) {
+        SchedulerWorker* peer = &scheduler_workers[(self->worker_id + i) % scheduler_worker_count];
+        if (peer->idle) {
+            notify_worker(peer);
+            return;
         }
     }
-    pthread_mutex_unlock(&waiting_queue.mutex);
-    return removed_task;
 }
 
-//remove all tasks belonging to a specific client
-void remove_client_tasks(int client_num) {
-    pthread_mutex_lock(&waiting_queue.mutex);
-    int i = 0;
-    //iterate through queue removing matching client tasks
-    while (i < waiting_queue.count) {
-        if (waiting_queue.tasks[i] != NULL && waiting_queue.tasks[i]->client_num == client_num) {
-            //free the task memory
-            free(waiting_queue.tasks[i]);
-            //shift remaining tasks forward
-            for (int j = i; j < waiting_queue.count - 1; j++) {
-                waiting_queue.tasks[j] = waiting_queue.tasks[j + 1];
+//discard pending notifications on an eventfd or timerfd
+static void drain_fd(int fd) {
+    uint64_t count;
+    while (read(fd, &count, sizeof(count)) > 0) {}
+}
+
+//move the tasks submitted to a worker into its run queue
+//only the worker itself calls this (the inbox has one consumer); caller holds queue->mutex
+static void drain_inbox(SchedulerWorker* worker) {
+    void* batch[SUBMIT_DRAIN_BATCH];
+    size_t count;
+    do {
+        count = mpsc_ring_drain(&worker->inbox, batch, SUBMIT_DRAIN_BATCH);
+        for (size_t i = 0; i < count; i++) {
+            Task* task = (Task*)batch[i];
+            //the client left after submitting: remove_client_tasks has already run or is
+            //waiting for this queue's lock, so the task must not become visible to it
+            if (atomic_load(&task->conn->closed) || runqueue_push(&worker->queue, task) != 0) {
+                destroy_task(task);
+                atomic_fetch_sub(&tasks_in_system, 1);
             }
-            waiting_queue.tasks[waiting_queue.count - 1] = NULL;
-            waiting_queue.count--;
-        } else {
-            i++;
         }
+    } while (count == SUBMIT_DRAIN_BATCH);
+
+    //the first submission after an idle period starts a new schedule
+    long long restart_us = atomic_exchange(&schedule_restart_us, 0);
+    if (restart_us != 0) {
+        pthread_mutex_lock(&scheduler_mutex);
+        if (schedule_summary.count == 0) schedule_summary.start_us = restart_us;
+        pthread_mutex_unlock(&scheduler_mutex);
     }
-    pthread_mutex_unlock(&waiting_queue.mutex);
 }
 
+//hand a task to a worker without locking; 0 on success, -1 if its queue is full
+static int submit_to_worker(SchedulerWorker* worker, Task* task) {
+    //the worker queues it the next time it looks for work
+    if (mpsc_ring_push(&worker->inbox, task) == 0) return 0;
+
+    //inbox full: a burst the worker has not caught up with yet, queue it directly
+    WaitingQueue* queue = &worker->queue;
+    pthread_mutex_lock(&queue->mutex);
+    int pushed = runqueue_push(queue, task);
+    pthread_mutex_unlock(&queue->mutex);
+    return pushed;
+}
 
-//select next task using hybrid rr+sjrf scheduling
-Task* select_next_task() {
-    if (waiting_queue.count == 0) return NULL;
+//add task to the least loaded worker's queue in thread-safe manner
+int add_task_to_queue(Task* task) {
+    return add_tasks_to_queue(&task, 1) == 1 ? 0 : -1;
+}
 
-    Task* selected = NULL;
-    int selected_index = -1;
+//add tasks to the least loaded workers' queues, waking each worker once
+int add_tasks_to_queue(Task** tasks, int count) {
+    if (count <= 0) return 0;
 
-    //shell commands have absolute priority
-    for (int i = 0; i < waiting_queue.count; i++) {
-        Task* task = waiting_queue.tasks[i];
-        if (task != NULL && task->remaining_burst_time == SHELL_COMMAND_BURST) {
-            //avoid consecutive selection unless only task left
-            if (task->task_id != waiting_queue.last_selected_id || waiting_queue.count == 1) {
-                selected = task;
-                selected_index = i;
-                break;
-            }
-        }
+    //the first tasks after an idle period restart the schedule's clock
+    if (atomic_fetch_add(&tasks_in_system, count) == 0) {
+        atomic_store(&schedule_restart_us, tasks[0]->arrival_us);
     }
 
-    //if no shell command, use shortest remaining time first
-    if (selected == NULL) {
-        int shortest_time = -1;
+    char woken[MAX_SCHEDULER_WORKERS] = { 0 };
+    int rejected = 0;
+    for (int i = 0; i < count; i++) {
+        //inbox sizes count as load, so a batch spreads over the workers
+        SchedulerWorker* worker = least_loaded_worker();
+        if (submit_to_worker(worker, tasks[i]) == 0) {
+            woken[worker->worker_id] = 1;
+        } else {
+            tasks[rejected++] = tasks[i];
+        }
+    }
+    if (rejected > 0) {
+        atomic_fetch_sub(&tasks_in_system, rejected);
+        atomic_fetch_add_explicit(&scheduler_metrics.rejected, (unsigned long long)rejected, memory_order_relaxed);
+    }
+    atomic_fetch_add_explicit(&scheduler_metrics.submitted[TASK_TYPE_PROGRAM], (unsigned long long)(count - rejected),
+                              memory_order_relaxed);
 
-        for (int i = 0; i < waiting_queue.count; i++) {
-            Task* task = waiting_queue.tasks[i];
-            if (task == NULL) continue;
+    //an idle worker picks its tasks up, a busy one re-checks preemption right away
+    for (int w = 0; w < scheduler_worker_count; w++) {
+        if (woken[w]) notify_worker(&scheduler_workers[w]);
+    }
+    return count - rejected;
+}
 
-            //prevent same task from being selected consecutively
-            if (task->task_id == waiting_queue.last_selected_id && waiting_queue.count > 1) {
-                continue;
-            }
+//remove specific task from whichever queue holds it
+Task* remove_task_from_queue(int task_id) {
+    for (int w = 0; w < scheduler_worker_count; w++) {
+        WaitingQueue* queue = &scheduler_workers[w].queue;
+        Task* removed_task = NULL;
+
+        pthread_mutex_lock(&queue->mutex);
+        //look up the task through the queue's index
+        removed_task = runqueue_find_id(queue, task_id);
+        if (removed_task != NULL) {
+            runqueue_remove(queue, removed_task);
+        }
+        pthread_mutex_unlock(&queue->mutex);
 
-            //select task with smallest remaining burst time
-            if (shortest_time == -1 || task->remaining_burst_time < shortest_time) {
-                shortest_time = task->remaining_burst_time;
-                selected = task;
-                selected_index = i;
-            }
+        if (removed_task != NULL) {
+            atomic_fetch_sub(&tasks_in_system, 1);
+            return removed_task;
         }
     }
+    return NULL;
+}
 
-    //fallback to first task if nothing selected
-    if (selected == NULL && waiting_queue.count > 0) {
-        selected = waiting_queue.tasks[0];
-        selected_index = 0;
-    }
+//remove all tasks belonging to a specific client from every queue
+void remove_client_tasks(int client_num) {
+    for (int w = 0; w < scheduler_worker_count; w++) {
+        WaitingQueue* queue = &scheduler_workers[w].queue;
 
-    //remove selected task from queue
-    if (selected != NULL && selected_index >= 0) {
-        for (int j = selected_index; j < waiting_queue.count - 1; j++) {
-            waiting_queue.tasks[j] = waiting_queue.tasks[j + 1];
+        pthread_mutex_lock(&queue->mutex);
+        //pop the client's tasks straight off its list in the queue index
+        Task* task;
+        while ((task = runqueue_pop_client(queue, client_num)) != NULL) {
+            //free the task memory
+            destroy_task(task);
+            atomic_fetch_sub(&tasks_in_system, 1);
         }
-        waiting_queue.tasks[waiting_queue.count - 1] = NULL;
-        waiting_queue.count--;
-
-        //update last selected to prevent consecutive selection
-        waiting_queue.last_selected_id = selected->task_id;
+        pthread_mutex_unlock(&queue->mutex);
     }
 
-    return selected;
+    //shell commands still waiting on the executor pool
+    shell_pool_remove_client(client_num);
+
+    //its account goes once the tasks still running are gone
+    fair_share_client_closed(client_num);
 }
 
 
-//log task state transition with color coding and remaining time
-void log_task_state(Task* task, const char* state_msg) {
-    char log_buffer[512];
-    //select color based on state
-    const char* color = COLOR_RESET;
+//select next task using the scheduling policy (rr+sjrf by default)
+Task* select_next_task(WaitingQueue* queue) {
+    return policy_select(queue->policy, queue);
+}
 
-    if (strcmp(state_msg, "created") == 0) color = COLOR_CYAN;
-    else if (strcmp(state_msg, "started") == 0) color = COLOR_GREEN;
-    else if (strcmp(state_msg, "waiting") == 0) color = COLOR_YELLOW;
-    else if (strcmp(state_msg, "running") == 0) color = COLOR_MAGENTA;
-    else if (strcmp(state_msg, "ended") == 0) color = COLOR_RED;
+//steal one queued task from a busy peer for an idle worker
+Task* steal_task(SchedulerWorker* thief) {
+    for (int i = 1; i < scheduler_worker_count; i++) {
+        SchedulerWorker* victim = &scheduler_workers[(thief->worker_id + i) % scheduler_worker_count];
 
-    pthread_mutex_lock(&scheduler_mutex);
+        //only busy workers have spare work; an idle victim will run its own queue
+        if (atomic_load(&victim->currently_running_task_id) == -1) continue;
 
-    //shell commands show -1 for burst time, programs show remaining time
-    if (task->remaining_burst_time == SHELL_COMMAND_BURST) {
-        snprintf(log_buffer, sizeof(log_buffer), "[%d]--- %s%s%s (-1)",
-                 task->client_num, color, state_msg, COLOR_RESET);
-    } else {
-        snprintf(log_buffer, sizeof(log_buffer), "[%d]--- %s%s%s (%d)",
-                 task->client_num, color, state_msg, COLOR_RESET,
-                 task->remaining_burst_time);
+        //never block on a contended peer, just move on to the next one
+        if (pthread_mutex_trylock(&victim->queue.mutex) != 0) continue;
+
+        //take the task the victim would run next (top of its heap); the queue is only
+        //looked at under its lock
+        Task* stolen = NULL;
+        if (victim->queue.count > 0 && atomic_load(&victim->currently_running_task_id) != -1) {
+            stolen = runqueue_pop_next(&victim->queue, -1);
+        }
+        pthread_mutex_unlock(&victim->queue.mutex);
+
+        if (stolen != NULL) return stolen;
     }
+    return NULL;
+}
 
-    //output to stdout
-    printf("%s\n", log_buffer);
-    fflush(stdout);
 
-    pthread_mutex_unlock(&scheduler_mutex);
+
+
+//log task state transition with its remaining time; per-quantum transitions are debug records
+void log_task_state(Task* task, const char* state_msg) {
+    int per_quantum = strcmp(state_msg, "running") == 0 || strcmp(state_msg, "waiting") == 0;
+    //shell commands show -1 for burst time, programs their remaining time
+    long long remaining_us = (task->remaining_burst_us == SHELL_COMMAND_BURST) ? -1 : task->remaining_burst_us;
+    log_event(per_quantum ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO, LOG_EVENT_TASK_STATE, task->client_num,
+              task->task_id, remaining_us, state_msg, strlen(state_msg));
 }
 
 //add entry to schedule summary after task execution
 void add_schedule_entry(int task_id) {
     pthread_mutex_lock(&scheduler_mutex);
     //record task id and time when it executed
-    if (schedule_summary.count < MAX_TASKS * 10) {
+    if (schedule_summary.count < MAX_SCHEDULE_ENTRIES) {
         schedule_summary.entries[schedule_summary.count].task_id = task_id;
-        schedule_summary.entries[schedule_summary.count].completion_time = get_elapsed_seconds();
+        schedule_summary.entries[schedule_summary.count].completion_us = get_elapsed_us();
         schedule_summary.count++;
     }
     pthread_mutex_unlock(&scheduler_mutex);
 }
 
-//print final schedule summary in blue highlighting
+//log final schedule summary (printed in blue highlighting)
 void print_schedule_summary() {
     pthread_mutex_lock(&scheduler_mutex);
 
-    //print schedule in format: P1-(3)-P2-(3)-...
-    printf("\n%s", COLOR_BLUE);
-    for (int i = 0; i < schedule_summary.count; i++) {
-        if (i > 0) printf("-");
-        printf("P%d-(%d)", schedule_summary.entries[i].task_id,
-               schedule_summary.entries[i].completion_time);
+    //format: P1-(3.000)-P2-(3.004)-...
+    size_t capacity = (size_t)schedule_summary.count * 64 + 1;
+    char* order = log_enabled(LOG_LEVEL_INFO) ? (char*)malloc(capacity) : NULL;
+    if (order != NULL) {
+        size_t length = 0;
+        for (int i = 0; i < schedule_summary.count; i++) {
+            length += (size_t)schedule_entry_format(order + length, capacity - length, &schedule_summary.entries[i],
+                                                    i == 0);
+        }
+        log_event(LOG_LEVEL_INFO, LOG_EVENT_SCHEDULE, 0, 0, 0, order, length);
+        free(order);
     }
-    printf("%s\n", COLOR_RESET);
-    fflush(stdout);
 
     //reset summary for the next batch
     schedule_summary.count = 0;
@@ -372,255 +502,478 @@ void print_schedule_summary() {
 }
 
 
-//execute shell command and capture output
+/**
+ * Forwards everything currently buffered in a non-blocking output pipe to the task's client
+ * The client socket blocks (bounded by CLIENT_SEND_TIMEOUT_SEC), so a slow client
+ * fills the pipe and the command blocks on write instead of output piling up in the server
+ * Closes *fd and sets it to -1 at EOF
+ *
+ * @return 0 while the pipe is open, 1 once it reached EOF, -1 if the client is gone or stalled
+ */
+static int forward_output(Task* task, int* fd) {
+    while (*fd >= 0) {
+        ssize_t moved = conn_forward_pipe(task->conn, task->request_id, *fd);
+
+        if (moved > 0) {
+            task->output_bytes += moved;
+            continue;
+        }
+        if (moved == 0) {
+            close(*fd);
+            *fd = -1;
+            return 1; //every writer closed the pipe
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0; //pipe drained
+        return -1; //EPIPE, ECONNRESET, ETIMEDOUT, ...: the client went away or stopped reading
+    }
+    return 1;
+}
+
+//execute shell command, streaming its output to the client as it is produced
 int execute_shell_command(Task* task) {
     int pipe_fd[2];
-    //create pipe to capture child output
-    if (pipe(pipe_fd) == -1) return -1;
+    //create pipe to capture child output (close-on-exec so concurrent children don't hold it open)
+    if (pipe2(pipe_fd, O_CLOEXEC) == -1) return -1;
 
-    pid_t pid = fork();
+    //the zygote spawns it; sh only for shell syntax
+    int exit_fd = -1;
+    pid_t pid = zygote_spawn(task->command, pipe_fd[1], &exit_fd);
+    close(pipe_fd[1]);
     if (pid < 0) {
-        close(pipe_fd[0]); close(pipe_fd[1]);
-        return -1;
-    } else if (pid == 0) {
-        //child process
         close(pipe_fd[0]);
-        //redirect stdout and stderr to pipe
-        dup2(pipe_fd[1], STDOUT_FILENO);
-        dup2(pipe_fd[1], STDERR_FILENO);
-        close(pipe_fd[1]);
-        //execute the command
-        execlp("/bin/sh", "sh", "-c", task->command, NULL);
-        exit(1);
-    } else {
-        //parent process
-        close(pipe_fd[1]);
-        //read output from child process
-        ssize_t bytes = read(pipe_fd[0], task->output_buffer, sizeof(task->output_buffer) - 1);
-        if (bytes > 0) {
-            task->output_buffer[bytes] = '\0';
-            task->output_length = bytes;
-        } else {
-            task->output_buffer[0] = '\0';
-            task->output_length = 0;
+        return -1;
+    }
+
+    int output_fd = pipe_fd[0];
+    fcntl(output_fd, F_SETFL, O_NONBLOCK);
+
+    //stream output until the command closes its end of the pipe
+    while (output_fd >= 0) {
+        struct pollfd pfd;
+        pfd.fd = output_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) break;
+
+        if (forward_output(task, &output_fd) < 0) {
+            //client gone or not reading: stop the command instead of blocking on it
+            kill(-pid, SIGKILL);
+            break;
         }
+    }
+    if (output_fd >= 0) close(output_fd);
+
+    //wait for the zygote to report the command complete (it clears out the rest of the group)
+    zygote_wait(exit_fd);
+    return 0;
+}
+
+//spawn a program task into its own process group with stdout/stderr on a pipe
+static int launch_program(Task* task) {
+    int pipe_fd[2];
+    if (pipe2(pipe_fd, O_CLOEXEC) == -1) return -1;
+
+    //the whole group exists before the zygote reports the pid, so SIGSTOP can't miss a member
+    int exit_fd = -1;
+    pid_t pid = zygote_spawn(task->command, pipe_fd[1], &exit_fd);
+    close(pipe_fd[1]);
+    if (pid < 0) {
         close(pipe_fd[0]);
-        //wait for child to complete
-        waitpid(pid, NULL, 0);
+        return -1;
+    }
+    fcntl(pipe_fd[0], F_SETFL, O_NONBLOCK);
+    task->exit_fd = exit_fd;
+
+    task->pid = pid;
+    task->output_fd = pipe_fd[0];
+    return 0;
+}
+
+//check whether the zygote has reported the program's exit
+static int program_exited(Task* task) {
+    if (task->pid <= 0) return 1;
+    struct pollfd pfd;
+    pfd.fd = task->exit_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 0) > 0) {
+        zygote_wait(task->exit_fd);
+        task->pid = -1;
+        task->exit_fd = -1;
+        return 1;
     }
     return 0;
 }
 
-//execute program task with quantum time and preemption support
-int execute_program_task(Task* task) {
-    //determine quantum based on round number
-    int quantum = (task->round_number == 0) ? FIRST_ROUND_QUANTUM : DEFAULT_QUANTUM;
-    task->quantum = quantum;
+//kill a program's whole process group and wait until it is reaped
+static void kill_program(Task* task) {
+    if (task->pid <= 0) return;
+    zygote_kill(task->pid, task->exit_fd);
+    task->pid = -1;
+    task->exit_fd = -1;
+}
 
-    //run for quantum or remaining time, whichever is less
-    int iterations_to_run = (task->remaining_burst_time < quantum) ?
-                             task->remaining_burst_time : quantum;
+//arm (or with 0, disarm) the worker's quantum timer at an absolute monotonic time
+static void arm_quantum_timer(SchedulerWorker* worker, long long expiry_us) {
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    spec.it_value.tv_sec = expiry_us / USEC_PER_SEC;
+    spec.it_value.tv_nsec = (expiry_us % USEC_PER_SEC) * 1000;
+    timerfd_settime(worker->timer_fd, expiry_us ? TFD_TIMER_ABSTIME : 0, &spec, NULL);
+}
 
-    //execute task one iteration (second) at a time
-    for (int i = 0; i < iterations_to_run; i++) {
-        char line[128];
-        //output progress to client
-        snprintf(line, sizeof(line), "Demo %d/%d\n",
-                 task->current_iteration + 1, task->total_burst_time);
 
-        send(task->client_socket, line, strlen(line), 0);
+//true if a queued task should take this worker's core from the running program
+static int should_preempt(SchedulerWorker* worker, Task* task) {
+    WaitingQueue* queue = &worker->queue;
+    int preempt = 0;
 
-        //simulate one second of work
-        sleep(1);
+    pthread_mutex_lock(&queue->mutex);
+    drain_inbox(worker);
+    //the heap top is the best waiting task; the policy decides whether it beats the running one
+    Task* best = runqueue_peek(queue);
+    if (best != NULL) {
+        preempt = policy_preempts(queue->policy, best, task);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return preempt;
+}
 
-        //update progress
-        task->current_iteration++;
-        task->remaining_burst_time--;
+/**
+ * Executes a program task for one quantum, stopping it with SIGSTOP when preempted
+ * The worker sleeps in poll() on the program's output pipe, its exit (zygote status pipe), the
+ * quantum timerfd and the worker's arrival eventfd, so it never polls on a clock:
+ * output is forwarded as it is written and preemption is decided the moment a
+ * task arrives in this worker's queue
+ */
+int execute_program_task(SchedulerWorker* worker, Task* task) {
+    //the policy sizes the slice (rr+sjrf: short first round, longer later ones)
+    long long quantum_us = worker->queue.policy->quantum_us(&worker->queue, task);
+    task->quantum_us = quantum_us;
+
+    //fork on first dispatch, resume the stopped process group afterwards
+    if (task->pid <= 0) {
+        if (launch_program(task) != 0) {
+            const char* error_msg = "Server error: Failed to start program\n";
+            conn_send_frame(task->conn, FRAME_ERROR, task->request_id, error_msg, strlen(error_msg));
+            return 1;
+        }
+    } else {
+        kill(-task->pid, SIGCONT);
+    }
 
-        //check if preemption is needed
-        pthread_mutex_lock(&waiting_queue.mutex);
-        int should_preempt = 0;
+    long long slice_start_us = monotonic_us();
+    long long run_before_us = task->run_time_us;
+    int finished = 0;
+    int exited = 0;
+
+    //stale arrivals were already seen by select_next_task; anything newer wakes us
+    drain_fd(worker->wake_fd);
+    drain_fd(worker->timer_fd);
+    arm_quantum_timer(worker, slice_start_us + quantum_us);
+
+    //a task may have arrived between selection and arming the wake-up
+    int preempted = should_preempt(worker, task);
+
+    while (!finished && !preempted) {
+        struct pollfd pfds[4];
+        int nfds = 0;
+        pfds[nfds].fd = worker->timer_fd; pfds[nfds++].events = POLLIN;
+        pfds[nfds].fd = worker->wake_fd; pfds[nfds++].events = POLLIN;
+        int output_slot = -1, exit_slot = -1;
+        if (task->output_fd >= 0) {
+            output_slot = nfds;
+            pfds[nfds].fd = task->output_fd; pfds[nfds++].events = POLLIN;
+        }
+        if (task->exit_fd >= 0) {
+            exit_slot = nfds;
+            pfds[nfds].fd = task->exit_fd; pfds[nfds++].events = POLLIN;
+        }
+        for (int i = 0; i < nfds; i++) pfds[i].revents = 0;
 
-        //check for shell commands in queue
-        for (int j = 0; j < waiting_queue.count; j++) {
-            if (waiting_queue.tasks[j] != NULL &&
-                waiting_queue.tasks[j]->remaining_burst_time == SHELL_COMMAND_BURST) {
-                should_preempt = 1;
-                break;
-            }
+        int ready = poll(pfds, nfds, -1);
+        if (ready < 0 && errno != EINTR) break;
+
+        task_account_run_time(task, run_before_us + (monotonic_us() - slice_start_us));
+
+        //forward output first so nothing written before exit is lost
+        if (output_slot >= 0 && pfds[output_slot].revents != 0 &&
+            forward_output(task, &task->output_fd) < 0) {
+            //client disconnected: nobody is left to read the output
+            kill_program(task);
+            finished = 1;
+            break;
         }
 
-        //check for shorter job in queue (sjrf)
-        for (int j = 0; j < waiting_queue.count && !should_preempt; j++) {
-            if (waiting_queue.tasks[j] != NULL &&
-                waiting_queue.tasks[j]->remaining_burst_time > 0 &&
-                waiting_queue.tasks[j]->remaining_burst_time < task->remaining_burst_time) {
-                should_preempt = 1;
+        //done once the process has exited; pass on whatever it wrote last
+        if ((exit_slot >= 0 && pfds[exit_slot].revents != 0) || output_slot < 0 ||
+            (pfds[output_slot].revents & (POLLHUP | POLLERR))) {
+            if (program_exited(task)) {
+                forward_output(task, &task->output_fd);
+                finished = 1;
+                exited = 1;
                 break;
             }
         }
 
-        pthread_mutex_unlock(&waiting_queue.mutex);
+        //quantum used up
+        if (pfds[0].revents != 0) break;
 
-        //return to queue if preempted
-        if (should_preempt && task->remaining_burst_time > 0) {
-            task->round_number++;
-            return 0; //preempted
+        //a task arrived in this worker's queue: preempt for a shorter job
+        if (pfds[1].revents != 0) {
+            drain_fd(worker->wake_fd);
+            preempted = should_preempt(worker, task);
         }
     }
 
-    task->round_number++;
-
-    //check if task is done
-    if (task->remaining_burst_time <= 0) {
+    arm_quantum_timer(worker, 0);
+    long long slice_us = monotonic_us() - slice_start_us;
+    task_account_run_time(task, run_before_us + slice_us);
+    policy_slice_end(worker->queue.policy, task, slice_us);
+    fair_share_charge(task->client_num, slice_us);
+    atomic_fetch_add_explicit(&scheduler_metrics.slices, 1, memory_order_relaxed);
+    histogram_record(&scheduler_metrics.quantum_use_percent, slice_us * 100 / quantum_us);
+
+    if (finished) {
+        //only a run to completion says how long the program takes
+        if (exited) burst_model_record(task->command, task->run_time_us);
+        if (task->output_fd >= 0) {
+            close(task->output_fd);
+            task->output_fd = -1;
+        }
+        task->remaining_burst_us = 0;
         return 1; //completed
     }
 
-    return 0; //yielding
+    //freeze the process group until the task is selected again
+    kill(-task->pid, SIGSTOP);
+    if (forward_output(task, &task->output_fd) < 0) {
+        kill_program(task);
+        return 1;
+    }
+    return 0; //preempted or yielding
+}
+
+//output was streamed while the task ran; a framed client gets the END marker,
+//a legacy client gets an empty line for a silent shell command so it knows it finished
+static void report_output_sent(Task* task) {
+    if (task->conn->framed) {
+        conn_send_frame(task->conn, FRAME_END, task->request_id, NULL, 0);
+    } else if (task->type == TASK_TYPE_SHELL && task->output_bytes == 0) {
+        conn_send_frame(task->conn, FRAME_OUTPUT, task->request_id, "\n", 1);
+        task->output_bytes = 1;
+    }
+    log_bytes_sent(task->client_num, task->output_bytes);
+}
+
+//a task is dispatched: how long it was runnable, and for its first dispatch since it was created
+static void record_dispatch(Task* task, long long now_us) {
+    histogram_record(&scheduler_metrics.queue_wait_us[task->type], now_us - task->ready_us);
+    if (task->start_us == 0) {
+        task->start_us = now_us;
+        histogram_record(&scheduler_metrics.response_us[task->type], now_us - task->arrival_us);
+    }
+}
+
+//a task finished: its turnaround
+static void record_completion(Task* task) {
+    atomic_fetch_add_explicit(&scheduler_metrics.completed[task->type], 1, memory_order_relaxed);
+    fair_share_completed(task->client_num);
+    histogram_record(&scheduler_metrics.turnaround_us[task->type], task->end_us - task->arrival_us);
+    if (task->deadline_us != 0) {
+        atomic_fetch_add_explicit(task->end_us <= task->deadline_us ? &scheduler_metrics.deadlines_met
+                                                                    : &scheduler_metrics.deadlines_missed,
+                                  1, memory_order_relaxed);
+    }
+}
+
+//run a shell command to completion on a shell executor thread
+void run_shell_task(Task* task) {
+    record_dispatch(task, monotonic_us());
+    task->state = TASK_RUNNING;
+    log_task_state(task, "running");
+
+    execute_shell_command(task);
+
+    task->end_us = monotonic_us();
+    task->state = TASK_ENDED;
+    log_task_state(task, "ended");
+    record_completion(task);
+    report_output_sent(task);
 }
 
 //execute a single task
-int execute_task(Task* task) {
+int execute_task(SchedulerWorker* worker, Task* task) {
     //record start time on first execution
-    if (task->start_time.tv_sec == 0) {
-        gettimeofday(&task->start_time, NULL);
-    }
+    record_dispatch(task, monotonic_us());
 
     //mark task as running
     task->state = TASK_RUNNING;
-    currently_running_task_id = task->task_id;
+    atomic_store(&worker->currently_running_task_id, task->task_id);
     log_task_state(task, "running");
 
-    int completed = 0;
-
-    //execute based on task type
-    if (task->type == TASK_TYPE_SHELL) {
-        execute_shell_command(task);
-        completed = 1;
-    } else {
-        completed = execute_program_task(task);
-    }
+    //only programs reach the run queues; shell commands run on the shell pool
+    int completed = execute_program_task(worker, task);
 
-    currently_running_task_id = -1;
+    atomic_store(&worker->currently_running_task_id, -1);
 
     //handle task completion
     if (completed) {
-        gettimeofday(&task->end_time, NULL);
+        task->end_us = monotonic_us();
         task->state = TASK_ENDED;
         log_task_state(task, "ended");
+        record_completion(task);
 
-        //record in schedule summary for programs only
-        if (task->type != TASK_TYPE_SHELL) {
-            add_schedule_entry(task->task_id);
-        }
+        //record in schedule summary
+        add_schedule_entry(task->task_id);
 
-        //send output back to client
-        if (task->type == TASK_TYPE_SHELL) {
-            if (task->output_length > 0) {
-                send(task->client_socket, task->output_buffer, task->output_length, 0);
-                log_bytes_sent(task->client_num, task->output_length);
-            } else {
-                send(task->client_socket, "\n", 1, 0);
-                log_bytes_sent(task->client_num, 1);
-            }
-        } else {
-            //estimate bytes sent for demo output
-            int total_bytes = task->current_iteration * 12;
-            log_bytes_sent(task->client_num, total_bytes);
-        }
+        report_output_sent(task);
 
-        //print summary when all tasks done
-        pthread_mutex_lock(&waiting_queue.mutex);
-        int queue_empty = (waiting_queue.count == 0);
-        pthread_mutex_unlock(&waiting_queue.mutex);
+        //print summary when all tasks on all workers are done
+        int system_empty = (atomic_fetch_sub(&tasks_in_system, 1) == 1);
 
-        if (queue_empty && schedule_summary.count > 0) {
+        if (system_empty && schedule_summary.count > 0) {
             print_schedule_summary();
         }
 
+        //persist what this batch taught the burst model while the system is idle
+        if (system_empty) {
+            burst_model_save();
+        }
+
         return 1;
     } else {
         //task not complete, return to waiting
         task->state = TASK_WAITING;
+        task->ready_us = monotonic_us();
         log_task_state(task, "waiting");
+        atomic_fetch_add_explicit(&scheduler_metrics.preemptions, 1, memory_order_relaxed);
 
         //record in schedule summary
-        if (task->type != TASK_TYPE_SHELL) {
-            add_schedule_entry(task->task_id);
-        }
+        add_schedule_entry(task->task_id);
 
         return 0;
     }
 }
 
-//main scheduler thread loop
+//scheduler worker loop: run own queue, steal from peers when it is empty
 void* scheduler_thread(void* arg) {
-    (void)arg;
+    SchedulerWorker* worker = (SchedulerWorker*)arg;
+    WaitingQueue* queue = &worker->queue;
 
     //keep running until stopped
     while (scheduler_running) {
-        pthread_mutex_lock(&waiting_queue.mutex);
-
-        //wait for tasks to arrive if queue is empty
-        while (waiting_queue.count == 0 && scheduler_running) {
-            pthread_cond_wait(&waiting_queue.not_empty, &waiting_queue.mutex);
+        pthread_mutex_lock(&queue->mutex);
+        drain_inbox(worker);
+
+        Task* task = NULL;
+        if (queue->count == 0) {
+            //own queue is dry: try to take spare work from a busy peer
+            pthread_mutex_unlock(&queue->mutex);
+            task = steal_task(worker);
+
+            //wait for a submission or a peer's wake-up, waking periodically to retry stealing;
+            //the eventfd is level-triggered, so a task submitted after the drain ends the wait at once
+            if (task == NULL) {
+                struct pollfd pfd = { worker->wake_fd, POLLIN, 0 };
+                worker->idle = 1;
+                if (scheduler_running && mpsc_ring_size(&worker->inbox) == 0) {
+                    poll(&pfd, 1, STEAL_RETRY_MS);
+                }
+                worker->idle = 0;
+                drain_fd(worker->wake_fd);
+                continue;
+            }
+            pthread_mutex_lock(&queue->mutex);
         }
 
         //check if should exit
         if (!scheduler_running) {
-            pthread_mutex_unlock(&waiting_queue.mutex);
+            //keep a stolen task queued so destroy_waiting_queue frees it
+            if (task != NULL && runqueue_push(queue, task) != 0) {
+                destroy_task(task);
+            }
+            pthread_mutex_unlock(&queue->mutex);
             break;
         }
 
         //select next task using scheduling algorithm
-        Task* task = select_next_task();
+        if (task == NULL) {
+            task = select_next_task(queue);
+        }
+        int surplus = queue->count;
+
+        pthread_mutex_unlock(&queue->mutex);
+
+        if (task == NULL) continue;
+
+        histogram_record(&scheduler_metrics.queue_depth, surplus);
 
-        pthread_mutex_unlock(&waiting_queue.mutex);
+        //tasks left waiting behind this one can be run by an idle peer
+        if (surplus > 0) {
+            wake_idle_worker(worker);
+        }
 
         //execute the selected task
-        if (task != NULL) {
-            int completed = execute_task(task);
-
-            //if task is done, free it; otherwise return to queue
-            if (completed) {
-                free(task);
-            } else {
-                pthread_mutex_lock(&waiting_queue.mutex);
-                if (waiting_queue.count < MAX_TASKS) {
-                    waiting_queue.tasks[waiting_queue.count] = task;
-                    waiting_queue.count++;
-                }
-                pthread_mutex_unlock(&waiting_queue.mutex);
+        int completed = execute_task(worker, task);
+
+        //if task is done, free it; otherwise return to this worker's queue
+        if (completed) {
+            destroy_task(task);
+        } else {
+            pthread_mutex_lock(&queue->mutex);
+            if (runqueue_push(queue, task) != 0) {
+                //queue is full: the task cannot be rescheduled
+                destroy_task(task);
+                atomic_fetch_sub(&tasks_in_system, 1);
             }
+            pthread_mutex_unlock(&queue->mutex);
         }
     }
     return NULL;
 }
 
-//start scheduler in separate thread
+//start one scheduler thread per worker
 void start_scheduler() {
     scheduler_running = 1;
-    pthread_t tid;
-    //create scheduler thread
-    if (pthread_create(&tid, NULL, scheduler_thread, NULL) != 0) {
-        perror("Failed to create scheduler thread");
-        return;
+    for (int w = 0; w < scheduler_worker_count; w++) {
+        pthread_t tid;
+        //create scheduler worker thread
+        if (pthread_create(&tid, NULL, scheduler_thread, &scheduler_workers[w]) != 0) {
+            perror("Failed to create scheduler thread");
+            return;
+        }
+        //detach thread so it cleans up automatically
+        pthread_detach(tid);
     }
-    //detach thread so it cleans up automatically
-    pthread_detach(tid);
+}
+
+//snapshot of the tasks the workers hold
+int scheduler_tasks_in_system() {
+    return atomic_load(&tasks_in_system);
+}
+
+//snapshot of one worker's backlog
+int scheduler_worker_depth(int worker) {
+    WaitingQueue* queue = &scheduler_workers[worker].queue;
+    pthread_mutex_lock(&queue->mutex);
+    int depth = queue->count;
+    pthread_mutex_unlock(&queue->mutex);
+    return depth + (int)mpsc_ring_size(&scheduler_workers[worker].inbox);
 }
 
 //stop scheduler gracefully
 void stop_scheduler() {
     //signal scheduler to stop running
     scheduler_running = 0;
-    //wake up scheduler thread if waiting
-    pthread_mutex_lock(&waiting_queue.mutex);
-    pthread_cond_signal(&waiting_queue.not_empty);
-    pthread_mutex_unlock(&waiting_queue.mutex);
+    //wake up every worker thread if waiting
+    for (int w = 0; w < scheduler_worker_count; w++) {
+        notify_worker(&scheduler_workers[w]);
+    }
 
     //print final summary if there were any tasks
     if (schedule_summary.count > 0) {
         print_schedule_summary();
     }
-}
\ No newline at end of file
+}
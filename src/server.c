@@ -1,35 +1,68 @@
 // src/server.c - Phase 4: Server with Scheduling Capabilities
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <errno.h>
 #include <sys/wait.h>
 #include <fcntl.h>
 #include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <sys/resource.h>
 #include "../include/server.h"
+#include "../include/reactor.h"
 #include "../include/parser.h"
 #include "../include/executor.h"
 #include "../include/scheduler.h"
+#include "../include/policy.h"
+#include "../include/shellpool.h"
+#include "../include/zygote.h"
+#include "../include/cmdcache.h"
+#include "../include/classify.h"
+#include "../include/burstmodel.h"
+#include "../include/metrics.h"
+#include "../include/fairshare.h"
 
 
 //client management
 static int client_counter = 0;
 static pthread_mutex_t counter_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+//the logger's enum for one of the COLOR_ codes, so no pointer travels in a log record
+static LogColor log_color(const char* color) {
+    if (color == NULL) return LOG_COLOR_NONE;
+    if (strcmp(color, COLOR_INFO) == 0) return LOG_COLOR_BLUE;
+    if (strcmp(color, COLOR_RECEIVED) == 0) return LOG_COLOR_YELLOW;
+    if (strcmp(color, COLOR_EXECUTING) == 0) return LOG_COLOR_MAGENTA;
+    if (strcmp(color, COLOR_OUTPUT) == 0) return LOG_COLOR_GREEN;
+    if (strcmp(color, COLOR_ERROR) == 0) return LOG_COLOR_RED;
+    return LOG_COLOR_NONE;
+}
 
 /**
- * Prints formatted and color-coded log messages to the server console
- * Thread-safe using mutex to prevent interleaved output from multiple threads
+ * Logs a color-coded tagged message; ERROR and WARN tags log at those levels
+ * The color (one of the COLOR_ macros) travels to the writer thread as a LogColor
  */
 void log_message(const char *color, const char *tag, const char *message) {
-    pthread_mutex_lock(&log_mutex);
-    printf("%s[%s]%s %s\n", color, tag, COLOR_RESET, message);
-    fflush(stdout);
-    pthread_mutex_unlock(&log_mutex);
+    LogLevel level = strcmp(tag, "ERROR") == 0 ? LOG_LEVEL_ERROR :
+                     strcmp(tag, "WARN") == 0 ? LOG_LEVEL_WARN : LOG_LEVEL_INFO;
+    if (!log_enabled(level)) return;
+    size_t tag_length = strlen(tag);
+    size_t message_length = strlen(message);
+    char stack_text[256];
+    char* text = tag_length + message_length + 1 <= sizeof(stack_text) ? stack_text
+               : (char*)malloc(tag_length + message_length + 1);
+    if (text == NULL) return;
+    memcpy(text, tag, tag_length + 1);
+    memcpy(text + tag_length + 1, message, message_length);
+    log_event(level, LOG_EVENT_MESSAGE, 0, 0, log_color(color), text, tag_length + 1 + message_length);
+    if (text != stack_text) free(text);
 }
 
 /**
@@ -37,10 +70,7 @@ void log_message(const char *color, const char *tag, const char *message) {
  * Format: [client_num]<<< client connected
  */
 void log_client_connected(int client_num) {
-    pthread_mutex_lock(&log_mutex);
-    printf("[%d]<<< client connected\n", client_num);
-    fflush(stdout);
-    pthread_mutex_unlock(&log_mutex);
+    log_event(LOG_LEVEL_INFO, LOG_EVENT_CONNECTED, client_num, 0, 0, NULL, 0);
 }
 
 /**
@@ -48,37 +78,30 @@ void log_client_connected(int client_num) {
  * Format: [client_num]>>> command
  */
 void log_command_received(int client_num, const char* command) {
-    pthread_mutex_lock(&log_mutex);
-    printf("[%d]>>> %s\n", client_num, command);
-    fflush(stdout);
-    pthread_mutex_unlock(&log_mutex);
+    log_event(LOG_LEVEL_INFO, LOG_EVENT_COMMAND, client_num, 0, 0, command, strlen(command));
 }
 
 /**
  * Logs bytes sent to a client
  * Format: [client_num]<<< N bytes sent
  */
-void log_bytes_sent(int client_num, int bytes) {
-    pthread_mutex_lock(&log_mutex);
-    printf("[%d]<<< %d bytes sent\n", client_num, bytes);
-    fflush(stdout);
-    pthread_mutex_unlock(&log_mutex);
+void log_bytes_sent(int client_num, long long bytes) {
+    log_event(LOG_LEVEL_INFO, LOG_EVENT_BYTES_SENT, client_num, 0, bytes, NULL, 0);
 }
 
 /**
  * Processes a command from a client by adding it to the scheduler queue
- * Shell commands get high priority (burst_time = -1)
- * Program commands are scheduled using RR + SJRF
+ * Shell commands get high priority (burst = -1)
+ * Program commands are scheduled by the selected policy (RR + SJRF by default)
  */
-void process_command_with_scheduler(const char* command, int client_num, int client_socket) {
+void process_command_with_scheduler(const char* command, ClientConn* conn, uint32_t request_id) {
     //log the received command
-    log_command_received(client_num, command);
+    log_command_received(conn->client_num, command);
     
     //create a task for this command
-    Task* task = create_task(command, client_num, client_socket);
+    Task* task = create_task(command, conn, request_id);
     if (task == NULL) {
-        const char* error_msg = "Server error: Failed to create task\n";
-        send(client_socket, error_msg, strlen(error_msg), 0);
+        conn_send_error(conn, request_id, "Server error: Failed to create task\n");
         return;
     }
     
@@ -93,16 +116,225 @@ void process_command_with_scheduler(const char* command, int client_num, int cli
         log_task_state(task, "started");
     }
     
-    //add task to the waiting queue - scheduler will pick it up
-    if (add_task_to_queue(task) != 0) {
-        const char* error_msg = "Server error: Task queue is full\n";
-        send(client_socket, error_msg, strlen(error_msg), 0);
-        free(task);
+    //shell commands run on the executor pool, programs go to the scheduler's run queues
+    int queued = (task->type == TASK_TYPE_SHELL) ? shell_pool_submit(task) : add_task_to_queue(task);
+    if (queued != 0) {
+        conn_send_error(conn, request_id, "Server error: Task queue is full\n");
+        destroy_task(task);
         return;
     }
 }
 
 
+//submit a batch's tasks of one kind in bulk and answer the ones that did not fit
+static void submit_batch_tasks(Task** tasks, int count, int shell) {
+    if (count == 0) return;
+    int queued = shell ? shell_pool_submit_batch(tasks, count) : add_tasks_to_queue(tasks, count);
+    for (int i = 0; i < count - queued; i++) {
+        conn_send_error(tasks[i]->conn, tasks[i]->request_id, "Server error: Task queue is full\n");
+        destroy_task(tasks[i]);
+    }
+}
+
+
+/**
+ * Answers the commands the server handles itself instead of scheduling them
+ * "exit" says goodbye, "stats" sends the scheduler metrics summary, "weight N" lowers the
+ * client's own weight (its share within its group, or against other ungrouped clients).
+ * Only the operator raises shares (--share, --member), so no client can take the core
+ *
+ * @return 1 for exit, 0 for another builtin, -1 if command is not a builtin
+ */
+static int handle_builtin(const char* command, ClientConn* conn, uint32_t request_id) {
+    if (strcmp(command, "exit") == 0) {
+        const char *exit_msg = "Disconnected from server.\n";
+        conn_send_frame(conn, FRAME_OUTPUT, request_id, exit_msg, strlen(exit_msg));
+        conn_send_frame(conn, FRAME_END, request_id, NULL, 0);
+        return 1;
+    }
+    if (strcmp(command, "stats") == 0) {
+        size_t length = 0;
+        char* summary = metrics_render(METRICS_SUMMARY, &length);
+        if (summary == NULL) {
+            conn_send_error(conn, request_id, "Server error: Out of memory\n");
+            return 0;
+        }
+        conn_send_frame(conn, FRAME_OUTPUT, request_id, summary, length);
+        conn_send_frame(conn, FRAME_END, request_id, NULL, 0);
+        free(summary);
+        return 0;
+    }
+    if (strncmp(command, "weight ", 7) == 0) {
+        //tasks created from now on are weighed with it (cfs), and the client's tags follow it (fair);
+        //a client may give up share but never claim more than the default
+        char* end;
+        long weight = strtol(command + 7, &end, 10);
+        while (*end == ' ') end++;
+        char reply[96];
+        if (*end != '\0' || weight < 1 || weight > TASK_DEFAULT_WEIGHT ||
+            fair_share_set_weight(conn->client_num, (int)weight) != 0) {
+            snprintf(reply, sizeof(reply), "Invalid weight: expected 1..%d (%d = one client's share)\n",
+                     TASK_DEFAULT_WEIGHT, TASK_DEFAULT_WEIGHT);
+            conn_send_error(conn, request_id, reply);
+            return 0;
+        }
+        snprintf(reply, sizeof(reply), "Weight set to %ld\n", weight);
+        conn_send_frame(conn, FRAME_OUTPUT, request_id, reply, strlen(reply));
+        conn_send_frame(conn, FRAME_END, request_id, NULL, 0);
+        return 0;
+    }
+    return -1;
+}
+
+
+/**
+ * Handles a BATCH frame: every line is a command answered under its own request id
+ * Tasks are created first and then queued in bulk, so the whole batch costs one
+ * shell pool lock and one wake-up per scheduler worker
+ */
+int handle_client_batch(const char* payload, size_t length, ClientConn* conn, uint32_t first_id) {
+    //split a private copy in place; a trailing newline does not start another command
+    int lines = 0;
+    for (const char* p = payload; p < payload + length; p++) {
+        if (*p == '\n') lines++;
+    }
+    if (length > 0 && payload[length - 1] != '\n') lines++;
+
+    //a batch that runs nothing is still answered, so the client is not left waiting for first_id
+    if (lines == 0) {
+        conn_send_frame(conn, FRAME_END, first_id, NULL, 0);
+        return 0;
+    }
+    if (lines > BATCH_MAX_COMMANDS) {
+        char message[64];
+        snprintf(message, sizeof(message), "Batch too large: %d commands (max %d)\n", lines, BATCH_MAX_COMMANDS);
+        conn_send_error(conn, first_id, message);
+        return 0;
+    }
+
+    char* commands = (char*)malloc(length + 1);
+    Task** tasks = (Task**)malloc((lines ? 2 * (size_t)lines : 1) * sizeof(Task*));
+    if (commands == NULL || tasks == NULL) {
+        for (int i = 0; i < lines; i++) {
+            conn_send_error(conn, first_id + (uint32_t)i, "Server error: Out of memory\n");
+        }
+        free(commands);
+        free(tasks);
+        return 0;
+    }
+    memcpy(commands, payload, length);
+    commands[length] = '\0';
+
+    //shell tasks go to the first half of tasks, programs to the second
+    int shells = 0, programs = 0, exiting = 0;
+    char* command = commands;
+    for (int i = 0; i < lines && !exiting; i++) {
+        uint32_t request_id = first_id + (uint32_t)i;
+        char* end = strchr(command, '\n');
+        if (end != NULL) *end = '\0';
+
+        int builtin = command[0] ? handle_builtin(command, conn, request_id) : 0;
+        if (command[0] == '\0') {
+            conn_send_frame(conn, FRAME_END, request_id, NULL, 0);
+        } else if (builtin == 1) {
+            //lines after exit are dropped with the connection
+            exiting = 1;
+        } else if (builtin < 0) {
+            log_command_received(conn->client_num, command);
+            Task* task = create_task(command, conn, request_id);
+            if (task == NULL) {
+                conn_send_error(conn, request_id, "Server error: Failed to create task\n");
+            } else {
+                log_task_state(task, "created");
+                log_task_state(task, "started");
+                if (task->type == TASK_TYPE_SHELL) tasks[shells++] = task;
+                else tasks[lines + programs++] = task;
+            }
+        }
+        if (end != NULL) command = end + 1;
+    }
+
+    submit_batch_tasks(tasks, shells, 1);
+    submit_batch_tasks(tasks + lines, programs, 0);
+    free(tasks);
+    free(commands);
+    return exiting;
+}
+
+
+/**
+ * Handles one received command: trims it, answers "exit" and otherwise
+ * hands it to the scheduler. Used by the per-client threads and the reactor
+ */
+int handle_client_command(char* command_buffer, ClientConn* conn, uint32_t request_id) {
+    //remove trailing newline if present
+    size_t len = strlen(command_buffer);
+    if (len > 0 && command_buffer[len - 1] == '\n') {
+        command_buffer[len - 1] = '\0';
+    }
+    
+    //skip empty commands (a framed client still gets its END)
+    if (strlen(command_buffer) == 0) {
+        conn_send_frame(conn, FRAME_END, request_id, NULL, 0);
+        return 0;
+    }
+    
+    //exit and stats are answered here
+    int builtin = handle_builtin(command_buffer, conn, request_id);
+    if (builtin >= 0) {
+        return builtin;
+    }
+    
+    //process command through the scheduler
+    process_command_with_scheduler(command_buffer, conn, request_id);
+    return 0;
+}
+
+
+/**
+ * Pulls complete commands out of the decoder and handles them in order
+ * Legacy clients yield one command per recv(); framed clients any number
+ */
+int dispatch_client_frames(ClientConn* conn, FrameDecoder* decoder) {
+    FrameHeader header;
+    const char* payload;
+    int result;
+    
+    while ((result = frame_decoder_next(decoder, &header, &payload)) > 0) {
+        conn->framed = (decoder->mode == PROTOCOL_FRAMED);
+        
+        //clients only ever send commands
+        if (header.type == FRAME_BATCH) {
+            if (handle_client_batch(payload, header.length, conn, header.request_id)) {
+                return 1;
+            }
+            continue;
+        }
+        if (header.type != FRAME_COMMAND) {
+            return 1;
+        }
+        //usual commands fit on the stack; generated ones may be up to FRAME_MAX_PAYLOAD
+        char stack_buffer[BUFFER_SIZE];
+        char* command_buffer = header.length < sizeof(stack_buffer) ? stack_buffer : (char*)malloc(header.length + 1);
+        if (command_buffer == NULL) {
+            conn_send_error(conn, header.request_id, "Server error: Out of memory\n");
+            continue;
+        }
+        memcpy(command_buffer, payload, header.length);
+        command_buffer[header.length] = '\0';
+        
+        int exiting = handle_client_command(command_buffer, conn, header.request_id);
+        if (command_buffer != stack_buffer) free(command_buffer);
+        if (exiting) {
+            return 1;
+        }
+    }
+    
+    //a bad hello or an oversized frame cannot be recovered from
+    return result < 0;
+}
+
+
 /**
  * Handles all communication with a single connected client
  * Receives commands and passes them to the scheduler
@@ -123,54 +355,43 @@ void* handle_client_thread(void* arg) {
     //detach thread so resources are automatically released when it exits
     pthread_detach(pthread_self());
     
-    char command_buffer[BUFFER_SIZE];
+    ClientConn* conn = conn_create(client_socket, client_num);
+    if (conn == NULL) {
+        close(client_socket);
+        return NULL;
+    }
+    
+    //commands may arrive split or coalesced; the decoder reassembles them
+    FrameDecoder decoder;
+    frame_decoder_init(&decoder, PROTOCOL_UNKNOWN);
+    char receive_buffer[BUFFER_SIZE];
     
     //main client communication loop
     while (1) {
-        //clear buffer before each iteration
-        memset(command_buffer, 0, BUFFER_SIZE);
-        
-        //receive command from client
-        ssize_t bytes_received = recv(client_socket, command_buffer, BUFFER_SIZE - 1, 0);
+        //receive command bytes from client
+        ssize_t bytes_received = recv(client_socket, receive_buffer, sizeof(receive_buffer) - 1, 0);
         
         if (bytes_received <= 0) {
             break; //client disconnected
         }
         
-        //null-terminate the received command
-        command_buffer[bytes_received] = '\0';
-        
-        //remove trailing newline if present
-        size_t len = strlen(command_buffer);
-        if (len > 0 && command_buffer[len - 1] == '\n') {
-            command_buffer[len - 1] = '\0';
-        }
-        
-        //skip empty commands
-        if (strlen(command_buffer) == 0) {
-            continue;
-        }
-        
-        //check for exit command
-        if (strcmp(command_buffer, "exit") == 0) {
-            const char *exit_msg = "Disconnected from server.\n";
-            send(client_socket, exit_msg, strlen(exit_msg), 0);
+        if (frame_decoder_append(&decoder, receive_buffer, (size_t)bytes_received) != 0) {
             break;
         }
         
-        //process command through the scheduler
-        process_command_with_scheduler(command_buffer, client_num, client_socket);
-        
-        //small delay to allow scheduler to process
-        //this helps maintain order for quick successive commands
-        usleep(100000); // 100ms
+        if (dispatch_client_frames(conn, &decoder)) {
+            break; //client asked to exit or broke the protocol
+        }
     }
     
+    //stop running tasks from writing (and tasks still in an inbox from being queued);
+    //the socket closes with the last reference
+    conn_shutdown(conn);
+    
     //remove all tasks for this client from the queue
     remove_client_tasks(client_num);
-    
-    //close the client socket when done
-    close(client_socket);
+    conn_release(conn);
+    frame_decoder_free(&decoder);
     
     return NULL;
 }
@@ -179,17 +400,76 @@ void* handle_client_thread(void* arg) {
  * Main server function that sets up the socket and listens for connections
  * Initializes the scheduler and creates threads for each client
  */
-void start_server() {
+void start_server(const ServerConfig* config) {
     int server_socket, client_socket;
     struct sockaddr_in server_addr, client_addr;
     socklen_t client_addr_len = sizeof(client_addr);
+    int use_epoll = (config->mode == SERVER_MODE_EPOLL);
+    
+    //a client that disconnects mid-send must not kill the whole server
+    signal(SIGPIPE, SIG_IGN);
+    
+    //the command table is read without locking, so it is complete before any thread starts
+    if (config->command_table != NULL && load_command_table(config->command_table) != 0) {
+        fprintf(stderr, "Failed to load command table %s\n", config->command_table);
+        exit(EXIT_FAILURE);
+    }
+    
+    //predictions start from what earlier runs of the server measured
+    if (config->burst_model != NULL && burst_model_load(config->burst_model) != 0) {
+        fprintf(stderr, "Failed to load burst model %s\n", config->burst_model);
+        exit(EXIT_FAILURE);
+    }
+    
+    //size the command cache first so the zygote inherits an empty cache of the same size
+    if (command_cache_init(config->command_cache_entries) != 0) {
+        fprintf(stderr, "Failed to allocate the command cache, continuing without it\n");
+    }
+    
+    //fork the spawn helper while the server is still small and single-threaded
+    if (start_zygote() != 0) {
+        fprintf(stderr, "Failed to start zygote\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    //log writer thread; started after the fork so the zygote stays single-threaded
+    if (logger_start(config->log_level, config->log_format, STDOUT_FILENO) != 0) {
+        fprintf(stderr, "Failed to start log writer\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    //each epoll client costs one descriptor, so lift the soft limit to the hard one
+    if (use_epoll) {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
     
     //initialize the scheduler
-    init_waiting_queue();
+    first_round_quantum_us = config->first_quantum_us;
+    default_quantum_us = config->default_quantum_us;
+    scheduler_policy = policy_find(config->policy);
+    init_waiting_queue(config->scheduler_workers);
     start_scheduler();
+    if (start_shell_pool(config->shell_workers) != 0) {
+        fprintf(stderr, "Failed to start shell executor pool\n");
+        exit(EXIT_FAILURE);
+    }
+    if (config->metrics_port > 0 && start_metrics_endpoint(config->metrics_port) != 0) {
+        fprintf(stderr, "Failed to start metrics endpoint on port %d\n", config->metrics_port);
+        exit(EXIT_FAILURE);
+    }
+    
+    //start the I/O threads before accepting anyone
+    if (use_epoll && start_reactor(config->io_threads) != 0) {
+        fprintf(stderr, "Failed to start epoll reactor\n");
+        exit(EXIT_FAILURE);
+    }
     
     //create TCP socket
-    server_socket = socket(AF_INET, SOCK_STREAM, 0);
+    server_socket = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
     if (server_socket < 0) {
         perror("Socket creation failed");
         exit(EXIT_FAILURE);
@@ -217,28 +497,43 @@ void start_server() {
     }
     
     //listen for incoming connections
-    if (listen(server_socket, MAX_PENDING) < 0) {
+    //the reactor accepts bursts of thousands of clients, so use the system maximum backlog
+    if (listen(server_socket, use_epoll ? SOMAXCONN : MAX_PENDING) < 0) {
         perror("Listen failed");
         close(server_socket);
         exit(EXIT_FAILURE);
     }
     
-    //server display startup banner
-    printf("------------------------\n");
-    printf("| Hello, Server Started |\n");
-    printf("------------------------\n");
-    fflush(stdout);
+    //server display startup banner (machine-readable logs get nothing but records)
+    if (config->log_format == LOG_FORMAT_TEXT) {
+        printf("------------------------\n");
+        printf("| Hello, Server Started |\n");
+        printf("------------------------\n");
+        fflush(stdout);
+    }
     
     //main server loop: accept clients and create threads
     while (1) {
         //accept incoming client connection (blocking call)
-        client_socket = accept(server_socket, (struct sockaddr *)&client_addr, &client_addr_len);
+        //close-on-exec keeps forked commands from holding client connections open
+        client_socket = accept4(server_socket, (struct sockaddr *)&client_addr, &client_addr_len, SOCK_CLOEXEC);
         
         if (client_socket < 0) {
             perror("Accept failed");
             continue;
         }
         
+        //bound how long a task can block on a client that stopped reading its output
+        struct timeval send_timeout;
+        send_timeout.tv_sec = CLIENT_SEND_TIMEOUT_SEC;
+        send_timeout.tv_usec = 0;
+        setsockopt(client_socket, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
+        
+        //a command's END frame is a small write right after its output; without this it waits
+        //for the client's delayed ACK of the output (~40ms per command)
+        int nodelay = 1;
+        setsockopt(client_socket, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+        
         //increment client counter (thread-safe)
         pthread_mutex_lock(&counter_mutex);
         client_counter++;
@@ -261,6 +556,18 @@ void start_server() {
         client_info->thread_id = current_client_num;
         client_info->port = ntohs(client_addr.sin_port);
         strncpy(client_info->ip_address, inet_ntoa(client_addr.sin_addr), INET_ADDRSTRLEN);
+
+        //the operator's --member mapping decides the client's group before it submits anything
+        fair_share_client_connected(current_client_num, client_info->ip_address);
+        
+        //epoll mode: the reactor owns the connection from here on
+        if (use_epoll) {
+            if (reactor_add_client(client_info) != 0) {
+                free(client_info);
+                close(client_socket);
+            }
+            continue;
+        }
         
         //create a new thread to handle this client
         pthread_t thread_id;
@@ -273,15 +580,168 @@ void start_server() {
     }
     
     //cleanup (never reached in current implementation)
+    if (use_epoll) {
+        stop_reactor();
+    }
+    stop_shell_pool();
     stop_scheduler();
     destroy_waiting_queue();
+    stop_zygote();
     close(server_socket);
 }
 
+//print command line usage
+static void print_usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [--epoll] [--io-threads N] [--workers N] [--shell-workers N] [--policy NAME] [--share GROUP=WEIGHT] [--member ADDRESS=GROUP] [--quantum-ms FIRST[,REST]] [--command-cache N] [--command-table FILE] [--burst-model FILE] [--log-level L] [--log-format F] [--metrics-port N]\n", prog);
+    fprintf(stderr, "  --epoll          multiplex clients on an epoll reactor instead of one thread per client\n");
+    fprintf(stderr, "  --io-threads N   number of reactor I/O threads (default %d, max %d)\n",
+            DEFAULT_IO_THREADS, MAX_IO_THREADS);
+    fprintf(stderr, "  --workers N      scheduler workers with per-worker run queues, 0 = one per CPU (default %d)\n",
+            DEFAULT_SCHEDULER_WORKERS);
+    fprintf(stderr, "  --shell-workers N threads running shell commands in parallel with programs (default %d, max %d)\n",
+            DEFAULT_SHELL_WORKERS, MAX_SHELL_WORKERS);
+    fprintf(stderr, "  --policy NAME    scheduling policy of the run queues (default %s):\n", scheduling_policies[0]->name);
+    for (int i = 0; scheduling_policies[i] != NULL; i++) {
+        fprintf(stderr, "    %-14s %s\n", scheduling_policies[i]->name, scheduling_policies[i]->description);
+    }
+    fprintf(stderr, "  --share G=W      define group G with weight W (%d = one client's share); its members split\n"
+                    "                   its share (fair and cfs policies; repeatable)\n", TASK_DEFAULT_WEIGHT);
+    fprintf(stderr, "  --member A=G     clients connecting from address A are members of group G (after its\n"
+                    "                   --share; repeatable). A client can only lower its weight, with \"weight W\"\n");
+    fprintf(stderr, "  --quantum-ms F,R program quantum for the first round and later rounds in ms (default %lld,%lld)\n",
+            FIRST_ROUND_QUANTUM_US / 1000, DEFAULT_QUANTUM_US / 1000);
+    fprintf(stderr, "  --command-cache N parsed commands cached by text, 0 = off (default %d, max %d)\n",
+            COMMAND_CACHE_DEFAULT_CAPACITY, COMMAND_CACHE_MAX_CAPACITY);
+    fprintf(stderr, "  --command-table FILE \"<name> shell|program\" lines added to the built-in command table\n");
+    fprintf(stderr, "  --burst-model FILE keep measured program run times in FILE across restarts\n");
+    fprintf(stderr, "  --log-level L    debug (default, every quantum), info, warn, error or off\n");
+    fprintf(stderr, "  --log-format F   text (default, colored console lines), json or binary\n");
+    fprintf(stderr, "  --metrics-port N serve Prometheus metrics on http://127.0.0.1:N/metrics (default off)\n");
+}
+
 /**
  * Main entry point for the server program
+ * Parses the connection model from the command line and starts the server
  */
-int main() {
-    start_server();
+int main(int argc, char* argv[]) {
+    ServerConfig config;
+    config.mode = SERVER_MODE_THREADED;
+    config.io_threads = DEFAULT_IO_THREADS;
+    config.scheduler_workers = DEFAULT_SCHEDULER_WORKERS;
+    config.shell_workers = DEFAULT_SHELL_WORKERS;
+    config.policy = scheduling_policies[0]->name;
+    config.first_quantum_us = FIRST_ROUND_QUANTUM_US;
+    config.default_quantum_us = DEFAULT_QUANTUM_US;
+    config.command_cache_entries = COMMAND_CACHE_DEFAULT_CAPACITY;
+    config.command_table = NULL;
+    config.burst_model = NULL;
+    config.log_level = LOG_LEVEL_DEBUG;
+    config.log_format = LOG_FORMAT_TEXT;
+    config.metrics_port = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--epoll") == 0) {
+            config.mode = SERVER_MODE_EPOLL;
+        } else if (strcmp(argv[i], "--io-threads") == 0 && i + 1 < argc) {
+            config.io_threads = atoi(argv[++i]);
+            if (config.io_threads < 1 || config.io_threads > MAX_IO_THREADS) {
+                fprintf(stderr, "Invalid I/O thread count: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+            config.scheduler_workers = atoi(argv[++i]);
+            if (config.scheduler_workers == 0) {
+                config.scheduler_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+            }
+            if (config.scheduler_workers < 1 || config.scheduler_workers > MAX_SCHEDULER_WORKERS) {
+                fprintf(stderr, "Invalid scheduler worker count: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--shell-workers") == 0 && i + 1 < argc) {
+            config.shell_workers = atoi(argv[++i]);
+            if (config.shell_workers < 1 || config.shell_workers > MAX_SHELL_WORKERS) {
+                fprintf(stderr, "Invalid shell worker count: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            config.policy = argv[++i];
+            if (policy_find(config.policy) == NULL) {
+                fprintf(stderr, "Unknown scheduling policy: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--share") == 0 && i + 1 < argc) {
+            //"name=weight"; groups are defined before any client can be put in them
+            char name[FAIR_SHARE_NAME_MAX];
+            const char* equals = strchr(argv[++i], '=');
+            size_t name_length = equals ? (size_t)(equals - argv[i]) : 0;
+            if (equals == NULL || name_length >= sizeof(name)) {
+                fprintf(stderr, "Invalid share: %s\n", argv[i]);
+                return 1;
+            }
+            memcpy(name, argv[i], name_length);
+            name[name_length] = '\0';
+            if (fair_share_define_group(name, atoi(equals + 1)) != 0) {
+                fprintf(stderr, "Invalid share: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--member") == 0 && i + 1 < argc) {
+            //"address=group"; the group must already be defined with --share
+            char address[FAIR_SHARE_ADDRESS_MAX];
+            const char* equals = strchr(argv[++i], '=');
+            size_t address_length = equals ? (size_t)(equals - argv[i]) : 0;
+            if (equals == NULL || address_length >= sizeof(address)) {
+                fprintf(stderr, "Invalid member: %s\n", argv[i]);
+                return 1;
+            }
+            memcpy(address, argv[i], address_length);
+            address[address_length] = '\0';
+            if (fair_share_add_member(address, equals + 1) != 0) {
+                fprintf(stderr, "Invalid member: %s (define the group with --share first)\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--quantum-ms") == 0 && i + 1 < argc) {
+            //"F" sets both rounds, "F,R" sets them separately
+            char* rest = NULL;
+            long first_ms = strtol(argv[++i], &rest, 10);
+            long rest_ms = (*rest == ',') ? strtol(rest + 1, NULL, 10) : first_ms;
+            if (first_ms <= 0 || rest_ms <= 0) {
+                fprintf(stderr, "Invalid quantum: %s\n", argv[i]);
+                return 1;
+            }
+            config.first_quantum_us = first_ms * 1000LL;
+            config.default_quantum_us = rest_ms * 1000LL;
+        } else if (strcmp(argv[i], "--command-cache") == 0 && i + 1 < argc) {
+            config.command_cache_entries = atoi(argv[++i]);
+            if (config.command_cache_entries < 0 || config.command_cache_entries > COMMAND_CACHE_MAX_CAPACITY) {
+                fprintf(stderr, "Invalid command cache size: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--command-table") == 0 && i + 1 < argc) {
+            config.command_table = argv[++i];
+        } else if (strcmp(argv[i], "--burst-model") == 0 && i + 1 < argc) {
+            config.burst_model = argv[++i];
+        } else if (strcmp(argv[i], "--log-level") == 0 && i + 1 < argc) {
+            if (log_level_parse(argv[++i], &config.log_level) != 0) {
+                fprintf(stderr, "Invalid log level: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--log-format") == 0 && i + 1 < argc) {
+            if (log_format_parse(argv[++i], &config.log_format) != 0) {
+                fprintf(stderr, "Invalid log format: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--metrics-port") == 0 && i + 1 < argc) {
+            config.metrics_port = atoi(argv[++i]);
+            if (config.metrics_port < 1 || config.metrics_port > 65535) {
+                fprintf(stderr, "Invalid metrics port: %s\n", argv[i]);
+                return 1;
+            }
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    start_server(&config);
     return 0;
 }
\ No newline at end of file
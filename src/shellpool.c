@@ -0,0 +1,243 @@
+// src/shellpool.c - Fast-path executor pool for shell commands
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "../include/shellpool.h"
+#include "../include/metrics.h"
+
+
+//one client's pending shell tasks; exists while the client has tasks queued or running
+typedef struct ShellClient {
+    int client_num;
+    Task* head;                       //oldest pending task, linked through Task.client_next
+    Task* tail;
+    int count;                        //pending tasks (bounded by SHELL_CLIENT_CAPACITY)
+    int running;                      //1 while an executor runs one of its tasks
+    int ready;                        //1 while on the ready list
+    struct ShellClient* next_ready;   //ready list link
+    struct ShellClient* next;         //hash bucket chain
+} ShellClient;
+
+static pthread_t* shell_threads = NULL;
+static int shell_thread_count = 0;
+static pthread_mutex_t shell_pool_mutex = PTHREAD_MUTEX_INITIALIZER;  //protects everything below
+static pthread_cond_t shell_pool_ready = PTHREAD_COND_INITIALIZER;    //signaled when a client becomes ready or the pool stops
+static ShellClient* shell_clients[SHELL_CLIENT_BUCKETS];
+static ShellClient* ready_head = NULL;   //clients with pending tasks and none running, oldest first
+static ShellClient* ready_tail = NULL;
+static int shell_pending = 0;
+static volatile int shell_pool_running = 0;
+
+
+//find a client's entry, optionally creating it; caller holds the mutex
+static ShellClient* shell_client(int client_num, int create) {
+    unsigned bucket = (unsigned)client_num & (SHELL_CLIENT_BUCKETS - 1);
+    for (ShellClient* client = shell_clients[bucket]; client != NULL; client = client->next) {
+        if (client->client_num == client_num) return client;
+    }
+    if (!create) return NULL;
+
+    ShellClient* client = (ShellClient*)calloc(1, sizeof(ShellClient));
+    if (client == NULL) return NULL;
+    client->client_num = client_num;
+    client->next = shell_clients[bucket];
+    shell_clients[bucket] = client;
+    return client;
+}
+
+//free a client's entry once it has nothing queued or running; caller holds the mutex
+static void release_if_idle(ShellClient* client) {
+    if (client->head != NULL || client->running || client->ready) return;
+    unsigned bucket = (unsigned)client->client_num & (SHELL_CLIENT_BUCKETS - 1);
+    ShellClient** link = &shell_clients[bucket];
+    while (*link != client) link = &(*link)->next;
+    *link = client->next;
+    free(client);
+}
+
+//queue a client with pending tasks for the next idle executor; caller holds the mutex
+static void push_ready(ShellClient* client) {
+    if (client->ready || client->running || client->head == NULL) return;
+    client->ready = 1;
+    client->next_ready = NULL;
+    if (ready_tail) ready_tail->next_ready = client;
+    else ready_head = client;
+    ready_tail = client;
+}
+
+//executor loop: take the oldest ready client and run its next command
+//a client runs one command at a time, so its commands finish in order, while a
+//slow command only holds up the client that sent it
+static void* shell_worker_main(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&shell_pool_mutex);
+    while (1) {
+        while (shell_pool_running && ready_head == NULL) {
+            pthread_cond_wait(&shell_pool_ready, &shell_pool_mutex);
+        }
+        if (!shell_pool_running) break;
+
+        ShellClient* client = ready_head;
+        ready_head = client->next_ready;
+        if (ready_head == NULL) ready_tail = NULL;
+        client->ready = 0;
+        client->next_ready = NULL;
+
+        Task* task = client->head;
+        client->head = task->client_next;
+        if (client->head == NULL) client->tail = NULL;
+        client->count--;
+        client->running = 1;
+        shell_pending--;
+        task->client_next = NULL;
+        pthread_mutex_unlock(&shell_pool_mutex);
+
+        run_shell_task(task);
+        destroy_task(task);
+
+        pthread_mutex_lock(&shell_pool_mutex);
+        client->running = 0;
+        //back at the tail of the ready list, behind clients that waited meanwhile
+        push_ready(client);
+        release_if_idle(client);
+    }
+    pthread_mutex_unlock(&shell_pool_mutex);
+    return NULL;
+}
+
+//start the executor threads
+int start_shell_pool(int worker_count) {
+    if (worker_count < 1) worker_count = 1;
+    if (worker_count > MAX_SHELL_WORKERS) worker_count = MAX_SHELL_WORKERS;
+
+    shell_threads = (pthread_t*)calloc(worker_count, sizeof(pthread_t));
+    if (shell_threads == NULL) return -1;
+
+    shell_pool_running = 1;
+    for (int i = 0; i < worker_count; i++) {
+        if (pthread_create(&shell_threads[i], NULL, shell_worker_main, NULL) != 0) {
+            perror("Failed to create shell executor thread");
+            return -1;
+        }
+        shell_thread_count++;
+    }
+    return 0;
+}
+
+//append a shell task to its client's queue
+int shell_pool_submit(Task* task) {
+    return shell_pool_submit_batch(&task, 1) == 1 ? 0 : -1;
+}
+
+//append shell tasks to their clients' queues under one lock
+int shell_pool_submit_batch(Task** tasks, int count) {
+    if (!shell_pool_running || shell_thread_count == 0) return 0;
+
+    int rejected = 0;
+    int woken = 0;
+    pthread_mutex_lock(&shell_pool_mutex);
+    ShellClient* client = NULL;
+    for (int i = 0; i < count; i++) {
+        Task* task = tasks[i];
+        if (client == NULL || client->client_num != task->client_num) {
+            client = shell_client(task->client_num, 1);
+        }
+        if (client == NULL || client->count >= SHELL_CLIENT_CAPACITY) {
+            tasks[rejected++] = task;
+            continue;
+        }
+
+        task->state = TASK_WAITING;
+        task->client_next = NULL;
+        if (client->tail) client->tail->client_next = task;
+        else client->head = task;
+        client->tail = task;
+        client->count++;
+        shell_pending++;
+
+        if (!client->ready && !client->running) {
+            push_ready(client);
+            woken++;
+        }
+    }
+    if (woken == 1) pthread_cond_signal(&shell_pool_ready);
+    else if (woken > 1) pthread_cond_broadcast(&shell_pool_ready);
+    pthread_mutex_unlock(&shell_pool_mutex);
+
+    atomic_fetch_add_explicit(&scheduler_metrics.submitted[TASK_TYPE_SHELL], (unsigned long long)(count - rejected),
+                              memory_order_relaxed);
+    if (rejected > 0) atomic_fetch_add_explicit(&scheduler_metrics.rejected, (unsigned long long)rejected,
+                                                memory_order_relaxed);
+    return count - rejected;
+}
+
+//shell tasks queued and not started
+int shell_pool_pending() {
+    pthread_mutex_lock(&shell_pool_mutex);
+    int pending = shell_pending;
+    pthread_mutex_unlock(&shell_pool_mutex);
+    return pending;
+}
+
+//free a client's pending shell tasks
+void shell_pool_remove_client(int client_num) {
+    pthread_mutex_lock(&shell_pool_mutex);
+    ShellClient* client = shell_client(client_num, 0);
+    if (client != NULL) {
+        while (client->head != NULL) {
+            Task* task = client->head;
+            client->head = task->client_next;
+            client->count--;
+            shell_pending--;
+            destroy_task(task);
+        }
+        client->tail = NULL;
+
+        //an executor finishing its running command finds nothing left and releases it
+        if (client->ready) {
+            ShellClient** link = &ready_head;
+            ShellClient* prev = NULL;
+            while (*link != client) {
+                prev = *link;
+                link = &(*link)->next_ready;
+            }
+            *link = client->next_ready;
+            if (ready_tail == client) ready_tail = prev;
+            client->ready = 0;
+        }
+        release_if_idle(client);
+    }
+    pthread_mutex_unlock(&shell_pool_mutex);
+}
+
+//stop the executor threads once their current command finishes
+void stop_shell_pool() {
+    pthread_mutex_lock(&shell_pool_mutex);
+    shell_pool_running = 0;
+    pthread_cond_broadcast(&shell_pool_ready);
+    pthread_mutex_unlock(&shell_pool_mutex);
+
+    for (int i = 0; i < shell_thread_count; i++) {
+        pthread_join(shell_threads[i], NULL);
+    }
+
+    for (int b = 0; b < SHELL_CLIENT_BUCKETS; b++) {
+        while (shell_clients[b] != NULL) {
+            ShellClient* client = shell_clients[b];
+            shell_clients[b] = client->next;
+            while (client->head != NULL) {
+                Task* task = client->head;
+                client->head = task->client_next;
+                destroy_task(task);
+            }
+            free(client);
+        }
+    }
+    ready_head = ready_tail = NULL;
+    shell_pending = 0;
+
+    free(shell_threads);
+    shell_threads = NULL;
+    shell_thread_count = 0;
+}
@@ -0,0 +1,105 @@
+// src/taskpool.c - Slab allocator for Task objects and size-classed command buffers
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../include/taskpool.h"
+#include "../include/scheduler.h"
+
+
+//a free object reuses its own first bytes as the free-list link
+typedef struct FreeNode {
+    struct FreeNode* next;
+} FreeNode;
+
+//free list of equally sized objects
+typedef struct {
+    FreeNode* free_list;           //objects ready to hand out
+    pthread_mutex_t mutex;         //guards free_list
+} FreeList;
+
+static FreeList task_pool = { NULL, PTHREAD_MUTEX_INITIALIZER };
+static FreeList command_pools[COMMAND_CLASS_COUNT] = {
+    { NULL, PTHREAD_MUTEX_INITIALIZER }, { NULL, PTHREAD_MUTEX_INITIALIZER },
+    { NULL, PTHREAD_MUTEX_INITIALIZER }, { NULL, PTHREAD_MUTEX_INITIALIZER },
+    { NULL, PTHREAD_MUTEX_INITIALIZER }, { NULL, PTHREAD_MUTEX_INITIALIZER },
+    { NULL, PTHREAD_MUTEX_INITIALIZER }, { NULL, PTHREAD_MUTEX_INITIALIZER },
+};
+
+
+//pop an object, first carving a fresh block into count objects of size bytes if the list is empty
+static void* pool_take(FreeList* pool, size_t size, int count) {
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->free_list == NULL) {
+        //blocks stay with the pool for the life of the server
+        char* block = (char*)malloc(size * (size_t)count);
+        if (block == NULL) {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        for (int i = count - 1; i >= 0; i--) {
+            FreeNode* node = (FreeNode*)(block + (size_t)i * size);
+            node->next = pool->free_list;
+            pool->free_list = node;
+        }
+    }
+    FreeNode* node = pool->free_list;
+    pool->free_list = node->next;
+    pthread_mutex_unlock(&pool->mutex);
+    return node;
+}
+
+//push an object back on its list
+static void pool_give(FreeList* pool, void* object) {
+    FreeNode* node = (FreeNode*)object;
+    pthread_mutex_lock(&pool->mutex);
+    node->next = pool->free_list;
+    pool->free_list = node;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+//bytes per buffer of a size class
+static size_t class_size(int size_class) {
+    return (size_t)1 << (COMMAND_MIN_CLASS_SHIFT + size_class);
+}
+
+
+Task* task_alloc() {
+    return (Task*)pool_take(&task_pool, sizeof(Task), TASK_SLAB_TASKS);
+}
+
+void task_free(Task* task) {
+    if (task == NULL) return;
+    pool_give(&task_pool, task);
+}
+
+char* command_dup(const char* command, int* size_class) {
+    size_t length = strlen(command);
+
+    //smallest class with room for the terminator
+    int chosen = 0;
+    while (chosen < COMMAND_CLASS_COUNT && class_size(chosen) < length + 1) chosen++;
+    if (chosen == COMMAND_HEAP_CLASS) {
+        char* buffer = (char*)malloc(length + 1);
+        if (buffer == NULL) return NULL;
+        memcpy(buffer, command, length + 1);
+        *size_class = COMMAND_HEAP_CLASS;
+        return buffer;
+    }
+
+    size_t size = class_size(chosen);
+    char* buffer = (char*)pool_take(&command_pools[chosen], size, (int)(COMMAND_CHUNK_SIZE / size));
+    if (buffer == NULL) return NULL;
+    memcpy(buffer, command, length);
+    buffer[length] = '\0';
+    *size_class = chosen;
+    return buffer;
+}
+
+void command_free(char* buffer, int size_class) {
+    if (buffer == NULL || size_class < 0) return;
+    if (size_class == COMMAND_HEAP_CLASS) {
+        free(buffer);
+        return;
+    }
+    pool_give(&command_pools[size_class], buffer);
+}
@@ -0,0 +1,167 @@
+// src/tokenize.c - Block scanning primitives for the command parser (scalar, SSE2, AVX2)
+#include <stdint.h>
+#include "../include/tokenize.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define TOKENIZE_X86 1
+#include <immintrin.h>
+#endif
+
+static TokenizerMode forced_mode = TOKENIZER_AUTO;
+
+//classes a scanner stops at
+#define STOP_SPACE 1  //whitespace and '|'
+#define STOP_QUOTE 2  //'"' and '\''
+
+
+static inline int is_stop(char c, int stops) {
+    if (is_space(c) || c == '|') return 1;
+    return (stops & STOP_QUOTE) && (c == '"' || c == '\'');
+}
+
+static size_t scan_scalar(const char *p, const char *end, int stops) {
+    const char *start = p;
+    while (p < end && !is_stop(*p, stops)) p++;
+    return (size_t)(p - start);
+}
+
+static void bounds_scalar(const char *p, const char *end, size_t *pipes, size_t *runs, int *in_run) {
+    for (; p < end; p++) {
+        if (*p == '|') { (*pipes)++; *in_run = 0; }
+        else if (is_space(*p)) *in_run = 0;
+        else if (!*in_run) { *in_run = 1; (*runs)++; }
+    }
+}
+
+
+#ifdef TOKENIZE_X86
+
+//bit i set when byte i of the block is a stop byte (whitespace, '|', quotes if asked); '|' bytes also go to pipe_mask
+static inline unsigned classify_sse2(const char *p, int stops, unsigned *pipe_mask) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    //unsigned (c - '\t') <= 4 via min: \t \n \v \f \r
+    __m128i shifted = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                 _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8('\r' - '\t')), shifted));
+    __m128i pipe = _mm_cmpeq_epi8(v, _mm_set1_epi8('|'));
+    __m128i stop = _mm_or_si128(space, pipe);
+    if (stops & STOP_QUOTE) {
+        stop = _mm_or_si128(stop, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                                               _mm_cmpeq_epi8(v, _mm_set1_epi8('\''))));
+    }
+    if (pipe_mask) *pipe_mask = (unsigned)_mm_movemask_epi8(pipe);
+    return (unsigned)_mm_movemask_epi8(stop);
+}
+
+static size_t scan_sse2(const char *p, const char *end, int stops) {
+    const char *start = p;
+    for (; end - p >= 16; p += 16) {
+        unsigned mask = classify_sse2(p, stops, NULL);
+        if (mask) return (size_t)(p - start) + (size_t)__builtin_ctz(mask);
+    }
+    return (size_t)(p - start) + scan_scalar(p, end, stops);
+}
+
+//a run starts at every non-separator byte whose predecessor is a separator
+static void bounds_sse2(const char *p, const char *end, size_t *pipes, size_t *runs, int *in_run) {
+    for (; end - p >= 16; p += 16) {
+        unsigned pipe_mask;
+        unsigned word = ~classify_sse2(p, STOP_SPACE, &pipe_mask) & 0xFFFFu;
+        unsigned before = ((word << 1) | (unsigned)*in_run) & 0xFFFFu;
+        *runs += (size_t)__builtin_popcount(word & ~before);
+        *pipes += (size_t)__builtin_popcount(pipe_mask);
+        *in_run = (int)(word >> 15);
+    }
+    bounds_scalar(p, end, pipes, runs, in_run);
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t classify_avx2(const char *p, int stops, uint32_t *pipe_mask) {
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i shifted = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                    _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8('\r' - '\t')), shifted));
+    __m256i pipe = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('|'));
+    __m256i stop = _mm256_or_si256(space, pipe);
+    if (stops & STOP_QUOTE) {
+        stop = _mm256_or_si256(stop, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                                                     _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\''))));
+    }
+    if (pipe_mask) *pipe_mask = (uint32_t)_mm256_movemask_epi8(pipe);
+    return (uint32_t)_mm256_movemask_epi8(stop);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_avx2(const char *p, const char *end, int stops) {
+    const char *start = p;
+    for (; end - p >= 32; p += 32) {
+        uint32_t mask = classify_avx2(p, stops, NULL);
+        if (mask) return (size_t)(p - start) + (size_t)__builtin_ctz(mask);
+    }
+    return (size_t)(p - start) + scan_sse2(p, end, stops);
+}
+
+__attribute__((target("avx2")))
+static void bounds_avx2(const char *p, const char *end, size_t *pipes, size_t *runs, int *in_run) {
+    for (; end - p >= 32; p += 32) {
+        uint32_t pipe_mask;
+        uint32_t word = ~classify_avx2(p, STOP_SPACE, &pipe_mask);
+        uint32_t before = (word << 1) | (uint32_t)*in_run;
+        *runs += (size_t)__builtin_popcount(word & ~before);
+        *pipes += (size_t)__builtin_popcount(pipe_mask);
+        *in_run = (int)(word >> 31);
+    }
+    bounds_sse2(p, end, pipes, runs, in_run);
+}
+
+#endif //TOKENIZE_X86
+
+
+void tokenizer_set_mode(TokenizerMode mode) {
+    forced_mode = mode;
+}
+
+TokenizerMode tokenizer_mode() {
+#ifdef TOKENIZE_X86
+    int has_avx2 = __builtin_cpu_supports("avx2");
+    if (forced_mode == TOKENIZER_AUTO) return has_avx2 ? TOKENIZER_AVX2 : TOKENIZER_SSE2;
+    if (forced_mode == TOKENIZER_AVX2 && !has_avx2) return TOKENIZER_SCALAR;
+    return forced_mode;
+#else
+    return TOKENIZER_SCALAR;
+#endif
+}
+
+//run one scanner with the implementation in use
+static size_t scan(const char *p, const char *end, int stops) {
+#ifdef TOKENIZE_X86
+    switch (tokenizer_mode()) {
+        case TOKENIZER_AVX2: return scan_avx2(p, end, stops);
+        case TOKENIZER_SSE2: return scan_sse2(p, end, stops);
+        default: break;
+    }
+#endif
+    return scan_scalar(p, end, stops);
+}
+
+size_t scan_word(const char *p, const char *end) {
+    return scan(p, end, STOP_SPACE | STOP_QUOTE);
+}
+
+size_t scan_field(const char *p, const char *end) {
+    return scan(p, end, STOP_SPACE);
+}
+
+void scan_bounds(const char *p, const char *end, size_t *pipes, size_t *runs) {
+    int in_run = 0;
+    *pipes = 0;
+    *runs = 0;
+#ifdef TOKENIZE_X86
+    switch (tokenizer_mode()) {
+        case TOKENIZER_AVX2: bounds_avx2(p, end, pipes, runs, &in_run); return;
+        case TOKENIZER_SSE2: bounds_sse2(p, end, pipes, runs, &in_run); return;
+        default: break;
+    }
+#endif
+    bounds_scalar(p, end, pipes, runs, &in_run);
+}
@@ -0,0 +1,356 @@
+// src/zygote.c - Pre-forked helper process that spawns commands for the server
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
+#include "../include/zygote.h"
+#include "../include/executor.h"
+#include "../include/cmdcache.h"
+
+
+//server end of the control socket, -1 until start_zygote
+static int zygote_fd = -1;
+static pid_t zygote_pid = -1;
+
+//a job the helper started and still has to report
+typedef struct {
+    pid_t pid;                        //process group leader
+    int exit_fd;                      //status pipe back to the server
+} ZygoteJob;
+
+static ZygoteJob* jobs = NULL;
+static int job_count = 0;
+static int job_capacity = 0;
+
+
+//write all bytes to a status pipe; the server may already have closed it
+static void write_status(int fd, const void* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return;
+        data = (const char*)data + written;
+        length -= (size_t)written;
+    }
+}
+
+//remember a started job so its exit can be reported
+static int track_job(pid_t pid, int exit_fd) {
+    if (job_count == job_capacity) {
+        int capacity = job_capacity ? job_capacity * 2 : 64;
+        ZygoteJob* grown = (ZygoteJob*)realloc(jobs, capacity * sizeof(ZygoteJob));
+        if (grown == NULL) return -1;
+        jobs = grown;
+        job_capacity = capacity;
+    }
+    jobs[job_count].pid = pid;
+    jobs[job_count].exit_fd = exit_fd;
+    job_count++;
+    return 0;
+}
+
+//index of the job led by pid, -1 if pid is some other pipeline stage
+static int find_job(pid_t pid) {
+    for (int i = 0; i < job_count; i++) {
+        if (jobs[i].pid == pid) return i;
+    }
+    return -1;
+}
+
+//read a whole command out of a memfd into a new NUL-terminated buffer
+static char* read_command_file(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) return NULL;
+    size_t length = (size_t)st.st_size;
+    char* command = (char*)malloc(length + 1);
+    if (command == NULL) return NULL;
+
+    size_t got = 0;
+    while (got < length) {
+        ssize_t n = pread(fd, command + got, length - got, (off_t)got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            free(command);
+            return NULL;
+        }
+        got += (size_t)n;
+    }
+    command[length] = '\0';
+    return command;
+}
+
+//start a command through the helper's parse cache, so a repeated line is neither re-checked
+//for shell syntax nor re-parsed; same fallbacks to sh as launch_command, which also takes
+//the lines the cache does not hold
+static pid_t launch_cached(const char* command, int out_fd) {
+    const ParsedCommand* parsed = command_cache_get(command);
+    if (parsed == NULL) return launch_command(command, out_fd);
+    pid_t pid = parsed->commands ? spawn_commands(parsed->commands, out_fd) : -1;
+    if (pid <= 0) pid = spawn_shell_command(command, out_fd);
+    command_cache_release(parsed);
+    return pid;
+}
+
+//handle one spawn request; 1 if one was served, 0 if none is queued, -1 once the server hung up
+static int serve_request(int control_fd) {
+    char command[ZYGOTE_INLINE_COMMAND + 1];
+    char control[CMSG_SPACE(3 * sizeof(int))];
+    struct iovec iov;
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    iov.iov_base = command;
+    iov.iov_len = ZYGOTE_INLINE_COMMAND;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    //received descriptors must not leak into other jobs
+    ssize_t length = recvmsg(control_fd, &msg, MSG_CMSG_CLOEXEC | MSG_DONTWAIT);
+    if (length < 0) return (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    if (length == 0) return -1;
+
+    //output pipe, status pipe and, for a long command, the memfd holding it
+    int fds[3] = { -1, -1, -1 };
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len >= CMSG_LEN(2 * sizeof(int)) && cmsg->cmsg_len <= CMSG_LEN(3 * sizeof(int))) {
+        memcpy(fds, CMSG_DATA(cmsg), cmsg->cmsg_len - CMSG_LEN(0));
+    }
+    int out_fd = fds[0], exit_fd = fds[1], command_fd = fds[2];
+    char* long_command = NULL;
+    command[length] = '\0';
+    if (command_fd >= 0) {
+        long_command = read_command_file(command_fd);
+        close(command_fd);
+    }
+    if (out_fd < 0 || exit_fd < 0 || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) ||
+        (command_fd >= 0 && long_command == NULL)) {
+        if (out_fd >= 0) close(out_fd);
+        if (exit_fd >= 0) close(exit_fd);
+        return 1;
+    }
+
+    pid_t pid = launch_cached(long_command ? long_command : command, out_fd);
+    free(long_command);
+    close(out_fd);
+
+    //the pid goes out first so the server can signal the group right away
+    write_status(exit_fd, &pid, sizeof(pid));
+    if (pid < 0 || track_job(pid, exit_fd) != 0) {
+        if (pid > 0) reap_process_group(pid);
+        close(exit_fd);
+    }
+    return 1;
+}
+
+//reap every exited child, reporting the ones that lead a job
+static void reap_children() {
+    while (1) {
+        //peek first: while the leader is a zombie its group id can't be reused
+        siginfo_t info;
+        memset(&info, 0, sizeof(info));
+        if (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) != 0 || info.si_pid == 0) return;
+
+        pid_t pid = info.si_pid;
+        int job = find_job(pid);
+        if (job >= 0) {
+            //the job ends with its leader (a pipeline's last stage); drop the other stages
+            kill(-pid, SIGKILL);
+        }
+
+        int status = 0;
+        if (waitpid(pid, &status, 0) < 0) continue;
+
+        if (job >= 0) {
+            write_status(jobs[job].exit_fd, &status, sizeof(status));
+            close(jobs[job].exit_fd);
+            jobs[job] = jobs[--job_count];
+        }
+    }
+}
+
+//helper main loop: spawn on request, report exits
+static void zygote_main(int control_fd) {
+    //SIGCHLD is read from a signalfd; spawned jobs get an empty signal mask back
+    sigset_t child_signals;
+    sigemptyset(&child_signals);
+    sigaddset(&child_signals, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &child_signals, NULL);
+    int child_fd = signalfd(-1, &child_signals, SFD_CLOEXEC | SFD_NONBLOCK);
+
+    //the server classifies commands; the helper only needs their parse
+    command_cache_set_content(COMMAND_CACHE_PARSE);
+
+    while (1) {
+        struct pollfd pfds[2];
+        pfds[0].fd = control_fd; pfds[0].events = POLLIN; pfds[0].revents = 0;
+        pfds[1].fd = child_fd; pfds[1].events = POLLIN; pfds[1].revents = 0;
+
+        //without a signalfd, check for exited children a few times per second
+        if (poll(pfds, child_fd >= 0 ? 2 : 1, child_fd >= 0 ? -1 : 100) < 0 && errno != EINTR) break;
+
+        if (child_fd >= 0 && pfds[1].revents != 0) {
+            struct signalfd_siginfo drained;
+            while (read(child_fd, &drained, sizeof(drained)) > 0) {}
+        }
+        reap_children();
+
+        //serve every queued request per wakeup: the helper is one process spawning for all workers
+        int served = 0;
+        if (pfds[0].revents != 0) {
+            while ((served = serve_request(control_fd)) > 0) {}
+        }
+        if (served < 0) break;
+    }
+
+    //the server is gone: nobody is left to read the jobs' output
+    for (int i = 0; i < job_count; i++) {
+        reap_process_group(jobs[i].pid);
+    }
+    _exit(0);
+}
+
+int start_zygote() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) < 0) {
+        perror("Failed to create zygote socket");
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("Failed to fork zygote");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        zygote_main(fds[1]);
+    }
+
+    close(fds[1]);
+    zygote_fd = fds[0];
+    zygote_pid = pid;
+    return 0;
+}
+
+//copy a long command into a memfd the helper can read
+static int command_file(const char* command, size_t length) {
+    int fd = memfd_create("zygote-command", MFD_CLOEXEC);
+    if (fd < 0) return -1;
+    size_t written = 0;
+    while (written < length) {
+        ssize_t n = write(fd, command + written, length - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        written += (size_t)n;
+    }
+    return fd;
+}
+
+pid_t zygote_spawn(const char* command, int out_fd, int* exit_fd) {
+    size_t length = strlen(command);
+    if (zygote_fd < 0 || length == 0) return -1;
+
+    //a long command goes in a memfd: a datagram can't exceed the socket buffer
+    int command_fd = -1;
+    if (length > ZYGOTE_INLINE_COMMAND) {
+        command_fd = command_file(command, length);
+        if (command_fd < 0) return -1;
+    }
+
+    int status_pipe[2];
+    if (pipe2(status_pipe, O_CLOEXEC) < 0) {
+        if (command_fd >= 0) close(command_fd);
+        return -1;
+    }
+
+    //command text (or a placeholder byte) plus the output pipe, the status pipe's write end
+    //and the memfd if there is one
+    int fds[3] = { out_fd, status_pipe[1], command_fd };
+    size_t fd_count = command_fd >= 0 ? 3 : 2;
+    char control[CMSG_SPACE(sizeof(fds))];
+    struct iovec iov;
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    iov.iov_base = (void*)command;
+    iov.iov_len = command_fd >= 0 ? 1 : length;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(fd_count * sizeof(int));
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(fd_count * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), fds, fd_count * sizeof(int));
+
+    //one datagram per request, so concurrent callers never interleave
+    ssize_t sent;
+    do {
+        sent = sendmsg(zygote_fd, &msg, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    close(status_pipe[1]);
+    if (command_fd >= 0) close(command_fd);
+    if (sent < 0) {
+        close(status_pipe[0]);
+        return -1;
+    }
+
+    //the helper answers with the leader's pid (or -1)
+    pid_t pid = -1;
+    ssize_t got;
+    do {
+        got = read(status_pipe[0], &pid, sizeof(pid));
+    } while (got < 0 && errno == EINTR);
+    if (got != (ssize_t)sizeof(pid) || pid <= 0) {
+        close(status_pipe[0]);
+        return -1;
+    }
+
+    *exit_fd = status_pipe[0];
+    return pid;
+}
+
+int zygote_wait(int exit_fd) {
+    int status = -1;
+    ssize_t got;
+    do {
+        got = read(exit_fd, &status, sizeof(status));
+    } while (got < 0 && errno == EINTR);
+    close(exit_fd);
+    return got == (ssize_t)sizeof(status) ? status : -1;
+}
+
+void zygote_kill(pid_t pid, int exit_fd) {
+    //SIGKILL also ends stopped processes
+    if (pid > 0) kill(-pid, SIGKILL);
+    if (exit_fd >= 0) zygote_wait(exit_fd);
+}
+
+void stop_zygote() {
+    if (zygote_fd < 0) return;
+    close(zygote_fd);
+    zygote_fd = -1;
+    waitpid(zygote_pid, NULL, 0);
+    zygote_pid = -1;
+}